@@ -13,10 +13,12 @@
 #include "data_structures.hpp"
 #include "dbus.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <memory>
-#include <regex>
 #include <set>
 #include <string>
+#include <string_view>
 #include <variant>
 
 #include <boost/container/flat_map.hpp>
@@ -29,17 +31,21 @@
 
 std::string getLogEntryIdFromObjectPath(std::string path)
 {
-    std::regex logEntryIdRegex("/xyz/openbmc_project/logging/entry/([0-9]+)");
-    std::smatch base_match;
-    if (std::regex_match(path, base_match, logEntryIdRegex))
+    // "/xyz/openbmc_project/logging/entry/<digits>", scanned without a regex
+    // as it is done for every InterfacesAdded signal
+    constexpr std::string_view prefix = "/xyz/openbmc_project/logging/entry/";
+    if (path.size() <= prefix.size() || path.compare(0, prefix.size(), prefix))
     {
-        // match 0 is the entire string, match 1 is the log entry ID
-        if (base_match.size() == 2)
-        {
-            return base_match[1].str();
-        }
+        return "";
+    }
+    auto id = path.substr(prefix.size());
+    if (!std::all_of(id.begin(), id.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c)) != 0;
+        }))
+    {
+        return "";
     }
-    return "";
+    return id;
 }
 
 void updateDeviceHealth(const std::string& deviceName)
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include "dbus_accessor.hpp"
+#include "property_variant.hpp"
+
+#include <sdbusplus/asio/connection.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/**
+ * Maximum number of asynchronous property reads waiting for their reply,
+ * process wide
+ */
+#ifndef DBUS_ASYNC_MAX_IN_FLIGHT
+#define DBUS_ASYNC_MAX_IN_FLIGHT 16
+#endif
+
+/**
+ * Default time a batch of asynchronous property reads may take
+ */
+#ifndef DBUS_ASYNC_READ_DEADLINE_MS
+#define DBUS_ASYNC_READ_DEADLINE_MS 5000
+#endif
+
+namespace dbus
+{
+
+/**
+ * @brief One org.freedesktop.DBus.Properties.Get to issue
+ */
+struct PropertyRequest
+{
+    std::string objectPath;
+    std::string interface;
+    std::string property;
+
+    bool operator<(const PropertyRequest& other) const
+    {
+        return std::tie(objectPath, interface, property) <
+               std::tie(other.objectPath, other.interface, other.property);
+    }
+};
+
+/**
+ * @brief One GpuMgr DeviceGetData to issue, see @sa deviceGetCoreAPI()
+ */
+struct CoreApiRequest
+{
+    int devId;
+    std::string property;
+
+    bool operator<(const CoreApiRequest& other) const
+    {
+        return std::tie(devId, property) <
+               std::tie(other.devId, other.property);
+    }
+};
+
+/**
+ * @brief Counters of @c AsyncReader, as seen by @c AsyncReader::stats()
+ */
+struct AsyncReadStats
+{
+    size_t issued;
+    size_t completed;
+    size_t failed;
+    /** reads without a reply when their batch's deadline expired */
+    size_t timedOut;
+    size_t maxInFlight;
+};
+
+/**
+ * @class AsyncReader
+ * @brief Concurrent property reads over the daemon's asio connection
+ *
+ *  readDbusProperty() costs a blocking round trip per property. readAll()
+ *  issues the Get calls of a whole batch with async_method_call_timed()
+ *  on the io_context thread and waits for all the replies at once, so N
+ *  reads cost about one round trip.
+ *
+ *  Every batch has a deadline, no later than the one of the current
+ *  @c DeadlineScope: what did not reply by then comes back empty.
+ *  At most @c DBUS_ASYNC_MAX_IN_FLIGHT reads wait for a reply at a time,
+ *  over all the batches; a batch waits for free slots. Every read also
+ *  takes a @c RateLimiter permit of its service, held until its reply.
+ *
+ *  Without a connection set, or called from the io_context thread itself
+ *  (which would never serve the replies it waits for), readAll() falls back
+ *  to synchronous readDbusProperty() calls.
+ */
+class AsyncReader
+{
+  public:
+    static AsyncReader& instance();
+
+    /**
+     * @brief Use @c conn for the reads, to be called from the thread
+     *        running its io_context
+     */
+    void setConnection(std::shared_ptr<sdbusplus::asio::connection> conn,
+                       size_t maxInFlight = DBUS_ASYNC_MAX_IN_FLIGHT);
+
+    /**
+     * @brief Read all the @c requests concurrently
+     *
+     * @return one value per request, an empty variant for the failed and
+     *         timed out ones
+     */
+    std::vector<PropertyVariant>
+        readAll(const std::vector<PropertyRequest>& requests,
+                std::chrono::milliseconds deadline =
+                    std::chrono::milliseconds(DBUS_ASYNC_READ_DEADLINE_MS));
+
+    /**
+     * @brief Read all the DeviceCoreAPI @c requests concurrently
+     *
+     *  GpuMgr has no method reading several devices or properties at once,
+     *  the DeviceGetData calls are fanned out.
+     *
+     * @return one result per request, nothing for the failed and timed out
+     *         ones
+     */
+    std::vector<std::optional<RetCoreApi>>
+        readCoreApi(const std::vector<CoreApiRequest>& requests,
+                    std::chrono::milliseconds deadline =
+                        std::chrono::milliseconds(DBUS_ASYNC_READ_DEADLINE_MS));
+
+    AsyncReadStats stats() const;
+
+  private:
+    AsyncReader() = default;
+
+    /**
+     * @brief The connection to use, nothing for synchronous reads
+     */
+    std::shared_ptr<sdbusplus::asio::connection> asyncConnection() const;
+
+    /**
+     * @brief Issue one call per entry of @c services
+     *
+     *  @c call(conn, i, service, timeoutUs, reply) sends the i-th call on
+     *  the io_context thread, its reply handler passes the value (nothing
+     *  on error) to @c reply.
+     */
+    template <typename Value, typename Call>
+    std::vector<std::optional<Value>>
+        fanOut(std::shared_ptr<sdbusplus::asio::connection> conn,
+               const std::vector<std::string>& services,
+               std::chrono::milliseconds deadline, Call call);
+
+    bool acquireSlot(std::chrono::steady_clock::time_point deadline);
+    void releaseSlot();
+
+    std::shared_ptr<sdbusplus::asio::connection> _conn;
+    std::thread::id _ioThread;
+    size_t _maxInFlight = DBUS_ASYNC_MAX_IN_FLIGHT;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _slotFree;
+    size_t _inFlight = 0;
+    AsyncReadStats _stats{};
+};
+
+/**
+ * @class PrefetchScope
+ * @brief Properties read ahead by @c AsyncReader for the synchronous code
+ *        of the current thread
+ *
+ *  While a scope exists readDbusProperty() and deviceGetCoreAPI() on the
+ *  same thread answer the prefetched properties from it. Code reading many
+ *  accessors one by one (selftest test points, telemetries, bootup checks,
+ *  DeviceCoreAPI device ranges) prefetches them all first and keeps its
+ *  sequential logic. Whatever failed to prefetch is
+ *  read synchronously as before.
+ *
+ *  Scopes nest, a scope does not read again what an enclosing one holds.
+ */
+class PrefetchScope
+{
+  public:
+    enum class Mode
+    {
+        /** one concurrent Properties.Get per property */
+        perProperty,
+        /** a @c PropertySnapshot first, Properties.Get for what it misses */
+        bulk
+    };
+
+    explicit PrefetchScope(
+        const std::vector<PropertyRequest>& requests,
+        Mode mode = Mode::perProperty,
+        std::chrono::milliseconds deadline =
+            std::chrono::milliseconds(DBUS_ASYNC_READ_DEADLINE_MS));
+
+    /**
+     * @brief Scope with values read elsewhere, for unit tests
+     */
+    PrefetchScope(const std::vector<PropertyRequest>& requests,
+                  const std::vector<PropertyVariant>& values);
+
+    /**
+     * @brief Scope of DeviceCoreAPI results, answering deviceGetCoreAPI()
+     */
+    explicit PrefetchScope(
+        const std::vector<CoreApiRequest>& requests,
+        std::chrono::milliseconds deadline =
+            std::chrono::milliseconds(DBUS_ASYNC_READ_DEADLINE_MS));
+
+    /**
+     * @brief Scope with DeviceCoreAPI results read elsewhere, for unit tests
+     */
+    PrefetchScope(const std::vector<CoreApiRequest>& requests,
+                  const std::vector<std::optional<RetCoreApi>>& values);
+
+    ~PrefetchScope();
+
+    PrefetchScope(const PrefetchScope&) = delete;
+    PrefetchScope& operator=(const PrefetchScope&) = delete;
+
+    /**
+     * @brief The value prefetched by one of the scopes of this thread
+     */
+    static std::optional<PropertyVariant>
+        find(const std::string& objectPath, const std::string& interface,
+             const std::string& property);
+
+    /**
+     * @brief The DeviceCoreAPI result prefetched by one of the scopes of
+     *        this thread
+     */
+    static std::optional<RetCoreApi> findCoreApi(int devId,
+                                                 const std::string& property);
+
+  private:
+    void fill(const std::vector<PropertyRequest>& requests,
+              const std::vector<PropertyVariant>& values);
+    void fill(const std::vector<CoreApiRequest>& requests,
+              const std::vector<std::optional<RetCoreApi>>& values);
+
+    std::map<PropertyRequest, PropertyVariant> _values;
+    std::map<CoreApiRequest, RetCoreApi> _coreApi;
+    PrefetchScope* _outer;
+};
+
+} // namespace dbus
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include "async_reader.hpp"
 #include "common.hpp"
 #include "dbus_accessor.hpp"
 #include "device_id.hpp"
@@ -18,22 +19,22 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <regex>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+/** Time a CMDLINE command has before its process group is killed */
 #ifndef SUBPROCESS_RUNNING_TIMEOUT_MS
 #define SUBPROCESS_RUNNING_TIMEOUT_MS 10000
 #endif
 
-#ifndef SUBPROCESS_RUNNING_POLL_MS
-#define SUBPROCESS_RUNNING_POLL_MS 50
-#endif
-
 namespace event_info
 {
 class EventNode;
@@ -59,6 +60,7 @@ constexpr auto deviceNameKey = "device_name";
 constexpr auto testValueKey = "test_value";
 constexpr auto deviceidKey = "device_id";
 constexpr auto valueKey = "value";
+constexpr auto invocationKey = "invocation";
 constexpr auto readFailedReturn = "Value_Not_Available";
 
 static std::map<std::string, std::vector<std::string>> accessorTypeKeys = {
@@ -69,24 +71,51 @@ static std::map<std::string, std::vector<std::string>> accessorTypeKeys = {
     {"DIRECT", {}},
     {"CONSTANT", {"value"}}};
 
+/**
+ * @brief Accessor types known by DataAccessor, "type" field of the json
+ */
+enum class AccessorType : uint8_t
+{
+    none,          // no "type" field, the accessor is not valid
+    dbus,          // "DBUS"
+    deviceCoreApi, // "DeviceCoreAPI"
+    device,        // "DEVICE"
+    cmdline,       // "CMDLINE"
+    constant,      // "CONSTANT"
+    direct,        // "DIRECT"
+    test,          // "TEST"
+    other          // any other "type" value
+};
+
 /**
  * @brief A class for Data Accessor
  *
+ *  The json given to the constructor (or assigned) is kept only as the
+ *  serialization format. The fields used at runtime (type, object path,
+ *  interface, property, executable, arguments, check definition) are parsed
+ *  once into typed members by parse(), together with the hash used by the
+ *  event views, so the hot path does not do string-keyed json lookups.
  */
 class DataAccessor
 {
   public:
     DataAccessor() : _dataValue(PropertyValue())
-    {}
+    {
+        parse();
+    }
 
     explicit DataAccessor(const nlohmann::json& acc,
                           const PropertyValue& value = PropertyValue()) :
         _acc(acc),
         _dataValue(value)
     {
-        std::stringstream ss;
-        ss << "Const.: _acc: " << _acc;
-        log_dbg("%s\n", ss.str().c_str());
+        parse();
+        if (getLogLevel(log_get_level()) >= LogLevel::debug)
+        {
+            std::stringstream ss;
+            ss << "Const.: _acc: " << _acc;
+            log_dbg("%s\n", ss.str().c_str());
+        }
     }
 
     /**
@@ -95,6 +124,7 @@ class DataAccessor
     explicit DataAccessor(const PropertyVariant& initialData) :
         _dataValue(PropertyValue())
     {
+        parse();
         setDataValueFromVariant(initialData);
     }
 
@@ -136,6 +166,7 @@ class DataAccessor
             return _acc;
         }
         _acc = acc;
+        parse();
         return _acc;
     }
 
@@ -148,70 +179,63 @@ class DataAccessor
      */
     bool operator==(const DataAccessor& other) const
     {
-        bool ret = isValid(_acc) && isValid(other._acc) &&
-                   _acc[typeKey] == other._acc[typeKey];
-        if (ret)
+        bool ret = _type != AccessorType::none && _type == other._type &&
+                   _typeName == other._typeName;
+        // cheap typed pre-checks, the loop below would compare these anyway
+        if (ret && _validDbus && other._validDbus)
+        {
+            ret = _property == other._property &&
+                  _interface == other._interface;
+        }
+        else if (ret && _type == AccessorType::cmdline)
+        {
+            ret = _acc.count(executableKey) == 0 ||
+                  (other._acc.count(executableKey) != 0 &&
+                   _executable == other._executable);
+        }
+        // every compared field of this one must be in the other one
+        for (auto field = _fields.begin(); ret && field != _fields.end();
+             ++field)
         {
-            std::string accType = _acc[typeKey];
-            for (auto& [key, val] : _acc.items())
+            const auto& [key, myVal] = *field;
+            auto other_field = std::lower_bound(
+                other._fields.begin(), other._fields.end(), *field,
+                [](const auto& l, const auto& r) { return l.first < r.first; });
+            if (other_field == other._fields.end() || other_field->first != key)
             {
-                if (key == nameKey || key == checkKey || key == deviceidKey)
-                {
-                    continue;
-                }
-                if (other._acc.count(key) == 0)
-                {
-                    ret = false;
-                    break;
-                }
-                if (key == objectKey || key == argumentsKey)
-                {
-                    std::string patPath = "";
-                    std::string otherPatPath = "";
-                    bool objPathMatches = true;
-                    if (accType == "DBUS")
-                    {
-                        patPath = _acc[objectKey];
-                        otherPatPath = other._acc[objectKey];
-                    }
-                    else if (accType == "CMDLINE")
-                    {
-                        patPath = _acc[argumentsKey];
-                        otherPatPath = other._acc[argumentsKey];
-                    }
-                    if (patPath != otherPatPath)
-                    {
-                        device_id::DeviceIdPattern pat1(patPath);
-                        device_id::DeviceIdPattern pat2(otherPatPath);
-                        objPathMatches =
-                            pat1.matches(otherPatPath) || pat2.matches(patPath);
-                    }
-                    if (!objPathMatches)
-                    {
-                        log_dbg(
-                            "The following accessor fields do not match: %s, %s\n",
-                            patPath.c_str(), otherPatPath.c_str());
-                        ret = false;
-                        break;
-                    }
-                    else
-                    {
-                        continue;
-                    }
-                }
-                auto otherVal = other._acc[key].get<std::string>();
-                auto myVal = val.get<std::string>();
-                if (otherVal != myVal)
+                ret = false;
+                break;
+            }
+            const auto& otherVal = other_field->second;
+            if (key == objectKey || key == argumentsKey)
+            {
+                // the object of DBUS and the arguments of CMDLINE may hold
+                // device ranges, the other type's one is not compared
+                bool holdsPattern =
+                    (key == objectKey && _type == AccessorType::dbus) ||
+                    (key == argumentsKey && _type == AccessorType::cmdline);
+                if (holdsPattern && myVal != otherVal &&
+                    !(device_id::hasBrackets(myVal) &&
+                      device_id::cachedPattern(myVal)->matches(otherVal)) &&
+                    !(device_id::hasBrackets(otherVal) &&
+                      device_id::cachedPattern(otherVal)->matches(myVal)))
                 {
+                    log_dbg(
+                        "The following accessor fields do not match: %s, %s\n",
+                        myVal.c_str(), otherVal.c_str());
                     ret = false;
-                    break;
                 }
+                continue;
             }
+            ret = otherVal == myVal;
+        }
+        if (getLogLevel(log_get_level()) >= LogLevel::debug)
+        {
+            std::stringstream ss;
+            ss << "\n\tThis: " << _acc << "\n\tOther: " << other._acc
+               << "\n\treturn: " << ret;
+            log_dbg("%s\n", ss.str().c_str());
         }
-        std::stringstream ss;
-        ss << "\n\tThis: " << _acc << "\n\tOther: " << other._acc
-           << "\n\treturn: " << ret;
-        log_dbg("%s\n", ss.str().c_str());
         return ret;
     }
 
@@ -219,47 +243,39 @@ class DataAccessor
      * @brief getType()
      * @return The Accessor type
      */
-    inline std::string getType() const
+    inline const std::string& getType() const
     {
-        if (isValid(_acc))
-        {
-            return _acc[typeKey].get<std::string>();
-        }
-        return std::string{""};
+        return _typeName;
+    }
+
+    /**
+     * @brief getAccessorType()
+     * @return The Accessor type as parsed from the "type" field
+     */
+    inline AccessorType getAccessorType() const
+    {
+        return _type;
     }
 
     /**
      * @brief getExecutable()
      * @return The executable if that exists
      */
-    inline std::string getExecutable() const
+    inline const std::string& getExecutable() const
     {
-        if (_acc.count(executableKey) != 0)
-        {
-            return _acc[executableKey].get<std::string>();
-        }
-        return std::string{""};
+        return _executable;
     }
 
+    /**
+     * @brief Hash for the event views, precomputed by parse() from the type
+     *        and the fields compared by operator== which do not hold device
+     *        ranges (so that accessors with and without range collide)
+     */
     struct Hash
     {
-        size_t operator()(DataAccessor accessor) const
+        size_t operator()(const DataAccessor& accessor) const
         {
-            std::string key = accessor.getType();
-            if (accessor.isValidDbusAccessor())
-            {
-                key += accessor.getDbusInterface() + accessor.getProperty();
-            }
-            else if (accessor.isTypeCmdline())
-            {
-                key += accessor.getExecutable();
-            }
-            else if (accessor.isTypeDeviceCoreApi())
-            {
-                key += accessor.getProperty();
-            }
-            std::hash<std::string> hashFn;
-            return hashFn(key);
+            return accessor._hash;
         }
     };
 
@@ -324,7 +340,7 @@ class DataAccessor
      */
     inline bool existsCheckKey() const
     {
-        return isEmpty() == false && _acc.count(checkKey) != 0;
+        return _hasCheck;
     }
 
     /**
@@ -333,7 +349,7 @@ class DataAccessor
      */
     bool existsCheckBitmap() const
     {
-        return existsCheckKey() && _acc[checkKey].count(bitmapKey) != 0;
+        return _hasCheck && _checkMap.count(bitmapKey) != 0;
     }
 
     /**
@@ -342,7 +358,22 @@ class DataAccessor
      */
     inline bool existsCheckLookup() const
     {
-        return existsCheckKey() && _acc[checkKey].count(lookupKey) != 0;
+        return _hasCheck && _checkMap.count(lookupKey) != 0;
+    }
+
+    /**
+     * @brief the "check" definition as parsed at construction
+     *
+     * @throw nlohmann::json::exception if "check" holds non string values
+     */
+    inline const CheckDefinitionMap& getCheckMap() const
+    {
+        if (!_checkMapValid)
+        {
+            // reproduce the conversion error for the caller
+            _acc[checkKey].get<CheckDefinitionMap>();
+        }
+        return _checkMap;
     }
 
     /**
@@ -358,7 +389,7 @@ class DataAccessor
      */
     inline bool isDeviceIdRange() const
     {
-        return _acc.count(deviceidKey) == 0 || _acc[deviceidKey] == "range";
+        return _deviceIdRange;
     }
 
     /**
@@ -439,42 +470,27 @@ class DataAccessor
      * @brief helper function to get the Dbus Object Path
      * @return
      */
-    inline std::string getDbusObjectPath() const
+    inline const std::string& getDbusObjectPath() const
     {
-        std::string ret{""};
-        if (isValidDbusAccessor() == true)
-        {
-            ret = _acc[objectKey].get<std::string>();
-        }
-        return ret;
+        return _object;
     }
 
     /**
      * @brief helper function to get the Property
      * @return
      */
-    inline std::string getProperty() const
+    inline const std::string& getProperty() const
     {
-        std::string ret{""};
-        if (isValid(_acc) == true && _acc.count(propertyKey) != 0)
-        {
-            ret = _acc[propertyKey].get<std::string>();
-        }
-        return ret;
+        return _property;
     }
 
     /**
      * @brief helper function to get the CMDLINE arguments
      * @return
      */
-    inline std::string getArguments() const
+    inline const std::string& getArguments() const
     {
-        std::string ret{""};
-        if (isTypeCmdline() == true && _acc.count(argumentsKey) != 0)
-        {
-            ret = _acc[argumentsKey].get<std::string>();
-        }
-        return ret;
+        return _arguments;
     }
 
     /**
@@ -499,14 +515,9 @@ class DataAccessor
      * @brief helper function to get the Dbus Interface
      * @return
      */
-    inline std::string getDbusInterface() const
+    inline const std::string& getDbusInterface() const
     {
-        std::string ret{""};
-        if (isValidDbusAccessor() == true)
-        {
-            ret = _acc[interfaceKey].get<std::string>();
-        }
-        return ret;
+        return _interface;
     }
 
     /**
@@ -525,7 +536,7 @@ class DataAccessor
      */
     inline bool isTypeDbus() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "DBUS";
+        return _type == AccessorType::dbus;
     }
 
     /**
@@ -535,7 +546,7 @@ class DataAccessor
      */
     inline bool isTypeDevice() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "DEVICE";
+        return _type == AccessorType::device;
     }
 
     /**
@@ -545,7 +556,7 @@ class DataAccessor
      */
     inline bool isTypeTest() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "TEST";
+        return _type == AccessorType::test;
     }
 
     /**
@@ -555,7 +566,7 @@ class DataAccessor
      */
     inline bool isTypeDeviceName() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "DIRECT";
+        return _type == AccessorType::direct;
     }
 
     /**
@@ -565,7 +576,7 @@ class DataAccessor
      */
     inline bool isTypeConst() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "CONSTANT";
+        return _type == AccessorType::constant;
     }
 
     /**
@@ -575,7 +586,7 @@ class DataAccessor
      */
     inline bool isTypeCmdline() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "CMDLINE";
+        return _type == AccessorType::cmdline;
     }
 
     /**
@@ -585,7 +596,7 @@ class DataAccessor
      */
     inline bool isTypeDeviceCoreApi() const
     {
-        return isValid(_acc) == true && _acc[typeKey] == "DeviceCoreAPI";
+        return _type == AccessorType::deviceCoreApi;
     }
 
     /**
@@ -631,8 +642,7 @@ class DataAccessor
      */
     inline bool isValidDbusAccessor() const
     {
-        return isTypeDbus() == true && _acc.count(objectKey) != 0 &&
-               _acc.count(interfaceKey) != 0 && _acc.count(propertyKey) != 0;
+        return _validDbus;
     }
 
     /**
@@ -654,7 +664,7 @@ class DataAccessor
      */
     inline bool isValidDeviceCoreApiAccessor() const
     {
-        return isTypeDeviceCoreApi() == true && _acc.count(propertyKey) != 0;
+        return _validCoreApi;
     }
 
     /**
@@ -710,7 +720,34 @@ class DataAccessor
      */  
     std::vector<DataAccessor> expand() const;
 
+    /**
+     * @brief The property read() would get for a valid DBUS accessor, to
+     *        prefetch it
+     *
+     * @param devIndex applied to an object path with range, as read() does
+     *
+     * @return nothing if not DBUS or the object path still has a range
+     */
+    std::optional<dbus::PropertyRequest> dbusReadRequest(
+        const device_id::PatternIndex* devIndex = nullptr) const;
+
+    /**
+     * @brief The DeviceGetData call read() would make for a valid
+     *        DeviceCoreAPI accessor on @c device, to prefetch it
+     *
+     * @return nothing if not DeviceCoreAPI or the device has no id
+     */
+    std::optional<dbus::CoreApiRequest>
+        coreApiReadRequest(const std::string& device) const;
+
   private:
+    /**
+     * @brief parse() fills the typed members below from _acc
+     *
+     *  Must be called every time _acc changes.
+     */
+    void parse();
+
     /**
      * @brief clearData() clear the _dataValue if it has a previous value
      */
@@ -722,7 +759,7 @@ class DataAccessor
     /**
      * @brief readDbus() reads the property contained in _acc
      *
-     *     _acc["object], _acc["interface"] and _acc["property"]
+     *     the parsed "object", "interface" and "property" fields
      *
      * @return true if the read operation was successful, false otherwise
      */
@@ -741,6 +778,26 @@ class DataAccessor
      */
     bool runCommandLine(const device_id::PatternIndex* devIndex = nullptr);
 
+    /**
+     * @brief The value of the device @c devIndex out of one run for the whole
+     *        range of the arguments, for an accessor with
+     *        "invocation": "range"
+     *
+     *  The range is expanded in place, "-c status GPU[0-3] -v" is run as
+     *  "-c status GPU0 GPU1 GPU2 GPU3 -v". The command prints the device
+     *  values in range order, each ended by an empty line (the last one may
+     *  omit it). The run goes through subprocess::Memo, the other devices of
+     *  the range read within its TTL are served by the same run.
+     *
+     * @return nothing if the arguments have no range holding @c devIndex, or
+     *         the run failed or did not print one value per device, to read
+     *         the device alone
+     *
+     * @throw std::runtime_error if the command could not be run or timed out
+     */
+    std::optional<std::string>
+        rangeCommandLineValue(const device_id::PatternIndex& devIndex);
+
     /**
      * @brief   just initializes the _dataValue creating a PropertyVariant
      *
@@ -764,6 +821,26 @@ class DataAccessor
      */
     nlohmann::json _acc;
 
+    /** typed copy of the _acc fields, see parse() */
+    AccessorType _type = AccessorType::none;
+    std::string _typeName;
+    std::string _object;
+    std::string _interface;
+    std::string _property;
+    std::string _executable;
+    std::string _arguments;
+    bool _validDbus = false;
+    bool _validCoreApi = false;
+    bool _deviceIdRange = true;
+    /** CMDLINE "invocation": "range", see rangeCommandLineValue() */
+    bool _rangeInvocation = false;
+    bool _hasCheck = false;
+    bool _checkMapValid = true;
+    CheckDefinitionMap _checkMap;
+    /** fields compared by operator==, sorted by key, non-strings dumped */
+    std::vector<std::pair<std::string, std::string>> _fields;
+    size_t _hash = 0;
+
     /**
      * @brief _dataValue stores the data value
      *
@@ -10,7 +10,9 @@
 
 #pragma once
 
+#include "dbus_connection.hpp"
 #include "log.hpp"
+#include "object_tree.hpp"
 #include "property_accessor.hpp"
 
 #include <boost/algorithm/string.hpp>
@@ -24,6 +26,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -37,6 +40,13 @@ constexpr auto freeDesktopInterface = "org.freedesktop.DBus.Properties";
 constexpr auto getCall = "Get";
 constexpr auto setCall = "Set";
 
+constexpr auto gpuMgrService = "xyz.openbmc_project.GpuMgr";
+constexpr auto gpuMgrObject = "/xyz/openbmc_project/GpuMgr";
+constexpr auto gpuMgrInterface = "xyz.openbmc_project.GpuMgr.Server";
+constexpr auto deviceGetDataCall = "DeviceGetData";
+/** DeviceGetData access mode: Passthrough, blocked call */
+constexpr auto deviceGetDataMode = 1;
+
 using DbusPropertyChangedHandler = std::unique_ptr<sdbusplus::bus::match_t>;
 using CallbackFunction = sdbusplus::bus::match::match::callback_t;
 using DbusAsioConnection = std::shared_ptr<sdbusplus::asio::connection>;
@@ -67,11 +77,37 @@ DbusPropertyChangedHandler registerServicePropertyChanged(
     sdbusplus::bus::bus& bus, const std::string& objectPath,
     const std::string& interface, CallbackFunction callback);
 
+/**
+ * @brief register a ready made match rule, as produced by
+ *        @sa subscription_plan::SubscriptionRule::matchRule()
+ *
+ * @param conn        connection std::shared_ptr<sdbusplus::asio::connection>
+ * @param matchRule   the D-Bus match rule string
+ * @param callback    the callback function
+ * @return the match_t register information which cannot be destroyed
+ *         while receiving these Dbus signals
+ */
+DbusPropertyChangedHandler registerMatchRule(DbusAsioConnection conn,
+                                             const std::string& matchRule,
+                                             CallbackFunction callback);
+
 /**
  *  @brief this is the return type for @sa deviceGetCoreAPI()
  */
 using RetCoreApi = std::tuple<int, std::string, uint64_t>; // int = return code
 
+/**
+ *  @brief the reply of GpuMgr DeviceGetData
+ */
+using DeviceGetDataReply = std::tuple<int, std::string, std::vector<uint32_t>>;
+
+/**
+ * @brief Converts a DeviceGetData reply of @c devId / @c property into the
+ *        return of @sa deviceGetCoreAPI(), logging a bad return code
+ */
+RetCoreApi coreApiResult(const int devId, const std::string& property,
+                         const DeviceGetDataReply& response);
+
 /**
  * @brief returns the service assigned with objectPath and interface
  * @param objectPath
@@ -155,7 +191,7 @@ class ObjectMapper
   public:
     // It's useful to have this field public for when a user wants to call a
     // method on some other service than ObjectMapper, but using the same bus.
-    sdbusplus::bus::bus bus;
+    BusPtr bus;
 
     /** @brief Manager -> Interface* */
     using ValueType = std::map<std::string, std::vector<std::string>>;
@@ -168,12 +204,19 @@ class ObjectMapper
      */
     using FullTreeType = std::map<std::string, ValueType>;
 
-    ObjectMapper() : bus(sdbusplus::bus::new_default_system())
+    /** @brief Use the system bus connection of the calling thread */
+    ObjectMapper() : bus(connection(BusType::systemBus))
     {}
 
-    ObjectMapper(sdbusplus::bus::bus&& bus) : bus(std::move(bus))
+    ObjectMapper(sdbusplus::bus::bus&& bus) :
+        bus(std::make_shared<sdbusplus::bus::bus>(std::move(bus)))
     {}
 
+    // the pooled connection belongs to the constructing thread, a copy
+    // could be used by another one
+    ObjectMapper(const ObjectMapper&) = delete;
+    ObjectMapper& operator=(const ObjectMapper&) = delete;
+
     /**
      * @brief Mimic the 'GetObject' method of 'ObjectMapper'
      * without actually using the dbus
@@ -358,7 +401,8 @@ class ObjectMapper
         getAllDevIdObjPaths(const std::string& devId,
                             const std::vector<std::string>& interfaces = {})
     {
-        return getDevIdPaths(interfaces, [&devId](const std::string& objPath) {
+        return getDevIdPaths(devId, interfaces,
+                             [&devId](const std::string& objPath) {
             return !(isObjPathPrimaryDevId(objPath, devId) ||
                      isObjPathDerivativeDevId(objPath, devId));
         });
@@ -385,7 +429,8 @@ class ObjectMapper
         getPrimaryDevIdPaths(const std::string& devId,
                              const std::vector<std::string>& interfaces = {})
     {
-        return getDevIdPaths(interfaces, [&devId](const std::string& objPath) {
+        return getDevIdPaths(devId, interfaces,
+                             [&devId](const std::string& objPath) {
             return !isObjPathPrimaryDevId(objPath, devId);
         });
     }
@@ -428,23 +473,54 @@ class ObjectMapper
         }
     }
 
+    /**
+     * @brief Paths of the objects whose last path element is one of
+     * @c names, implementing any of @c interfaces
+     *
+     * This default filters the whole tree, mappers keeping an index by name
+     * (@sa CachingObjectMapper) replace it.
+     */
+    std::vector<std::string>
+        getPathsNamedImpl(const std::vector<std::string>& names,
+                          const std::vector<std::string>& interfaces)
+    {
+        auto paths = this->getSubTreePaths(std::string("/"), 0, interfaces);
+        std::erase_if(paths, [&names](const std::string& objPath) {
+            auto name = objPath.substr(objPath.rfind('/') + 1);
+            return std::find(names.cbegin(), names.cend(), name) ==
+                   names.cend();
+        });
+        return paths;
+    }
+
     sdbusplus::message::message getMethod(const std::string& objectPath,
                                           const std::string& managerInterface,
                                           const std::string& callInterface,
                                           const std::string& method)
     {
-        return this->bus.new_method_call(
+        return this->bus->new_method_call(
             this->getManager(objectPath, managerInterface), objectPath,
             callInterface, method);
     }
 
   private:
+    /**
+     * Both the primary and the derivative paths of @c devId end with its
+     * last element (possibly prefixed by "HGX_"), so only the objects with
+     * these names are candidates.
+     */
     std::vector<std::string> getDevIdPaths(
-        const std::vector<std::string>& interfaces,
+        const std::string& devId, const std::vector<std::string>& interfaces,
         const std::function<bool(const std::string& objPath)>& antiPredicate)
     {
+        auto name = devId.substr(devId.rfind('/') + 1);
+        std::vector<std::string> names{name};
+        if (name == devId)
+        {
+            names.push_back("HGX_" + devId);
+        }
         return scopeObjectPathsDevId(
-            this->getSubTreePaths(std::string("/"), 0, interfaces),
+            static_cast<T*>(this)->getPathsNamedImpl(names, interfaces),
             antiPredicate);
     }
 
@@ -518,207 +594,111 @@ class DirectObjectMapper : public ObjectMapper<DirectObjectMapper>
     DirectObjectMapper(sdbusplus::bus::bus&& bus) : ObjectMapper(std::move(bus))
     {}
 
-    ValueType getObjectImpl(sdbusplus::bus::bus& bus,
+    ValueType getObjectImpl(const BusPtr& bus,
                             const std::string& objectPath,
                             const std::vector<std::string>& interfaces) const;
 
     std::vector<std::string>
-        getSubTreePathsImpl(sdbusplus::bus::bus& bus,
+        getSubTreePathsImpl(const BusPtr& bus,
                             const std::string& subtree, int depth,
                             const std::vector<std::string>& interfaces) const;
 
     FullTreeType
-        getSubtreeImpl(sdbusplus::bus::bus& bus, const std::string& subtree,
+        getSubtreeImpl(const BusPtr& bus, const std::string& subtree,
                        int depth,
                        const std::vector<std::string>& interfaces) const;
 };
 
+/**
+ * @class CachingObjectMapper
+ * @brief ObjectMapper answering from an @c ObjectTree mirror
+ *
+ * Once the daemon subscribed the shared @c ObjectTree to the D-Bus signals
+ * all the instances answer from it. Otherwise (tools, unit tests) each
+ * instance loads a tree of its own on the first query.
+ */
 class CachingObjectMapper : public ObjectMapper<CachingObjectMapper>
 {
 
   public:
-    CachingObjectMapper() : ObjectMapper(), isInitialized(false)
+    CachingObjectMapper() : ObjectMapper(), tree(defaultTree())
     {}
 
     CachingObjectMapper(sdbusplus::bus::bus&& bus) :
-        ObjectMapper(std::move(bus)), isInitialized(false)
+        ObjectMapper(std::move(bus)), tree(defaultTree())
     {}
 
-    ValueType getObjectImpl(sdbusplus::bus::bus& bus,
+    CachingObjectMapper(std::shared_ptr<ObjectTree> tree) :
+        ObjectMapper(), tree(std::move(tree))
+    {}
+
+    ValueType getObjectImpl(const BusPtr& bus,
                             const std::string& objectPath,
                             const std::vector<std::string>& interfaces);
 
     std::vector<std::string>
-        getSubTreePathsImpl(sdbusplus::bus::bus& bus,
+        getSubTreePathsImpl(const BusPtr& bus,
                             const std::string& subtree, int depth,
                             const std::vector<std::string>& interfaces);
     std::vector<std::string>
-        getSubTreePathsImpl(sdbusplus::bus::bus& bus,
+        getSubTreePathsImpl(const BusPtr& bus,
                             const std::vector<std::string>& interfaces);
 
-    // Not implemented for now
-    FullTreeType getSubtreeImpl(sdbusplus::bus::bus& bus,
+    FullTreeType getSubtreeImpl(const BusPtr& bus,
                                 const std::string& subtree, int depth,
                                 const std::vector<std::string>& interfaces);
 
-    /** @brief Synchronize the internal mirror data (@c
-     * objectsServicesMapping) with dbus **/
+    std::vector<std::string>
+        getPathsNamedImpl(const std::vector<std::string>& names,
+                          const std::vector<std::string>& interfaces)
+    {
+        return tree->getPathsNamed(names, interfaces);
+    }
+
+    /** @brief Reload the whole mirror from dbus */
     void refresh();
-    // void refresh(sdbusplus::bus::bus& bus);
 
     /**
      * @brief Given one of the values from the main dictionary return the set of
      * managers implementing a given interfaces (disjunction).
      */
     static ValueType scopeManagers(const ValueType& implementations,
-                                   const std::vector<std::string>& interfaces);
-
-  private:
-    bool isInitialized;
-    FullTreeType objectsServicesMapping;
-
-    void ensureIsInitialized();
-};
-
-// DbusDelayer ////////////////////////////////////////////////////////////////
-
-/**
- * @brief
- *
- * +---------------------+
- * |        idle         | <+
- * +---------------------+  |
- *   |                      |
- *   | callStartAttempt()   |
- *   v                      |
- * +---------------------+  |
- * |       waiting       |  | callFinished()
- * +---------------------+  |
- *   |                      |
- *   | callStartActual()    |
- *   v                      |
- * +---------------------+  |
- * |       calling       | -+
- * +---------------------+
- */
-
-class DbusDelayer
-{
-  public:
-    enum State
+                                   const std::vector<std::string>& interfaces)
     {
-        idle,
-        waiting,
-        calling
-    };
-
-    static const char* stateToStr(State state);
-
-    DbusDelayer() : mutex(), state(State::idle)
-    {}
-    virtual ~DbusDelayer() = default;
-
-    std::chrono::milliseconds callStartAttempt(const std::string& signature);
-    void callStartActual(const std::string& signature);
-    void callFinished(const std::string& signature);
-
-    State getState() const
-    {
-        return this->state;
+        return ObjectTree::scopeManagers(implementations, interfaces);
     }
 
-    std::mutex mutex;
-
-  protected:
-    virtual std::chrono::milliseconds callStartAttemptImpl(
-        const std::string& signature,
-        const std::chrono::time_point<std::chrono::steady_clock>& now);
-    virtual void callStartActualImpl(
-        const std::string& signature,
-        const std::chrono::time_point<std::chrono::steady_clock>& now);
-    virtual void callFinishedImpl(
-        const std::string& signature,
-        const std::chrono::time_point<std::chrono::steady_clock>& now);
-
   private:
-    State state;
-};
-
-class DbusDelayerConstLowerBound : public DbusDelayer
-{
-  public:
-    DbusDelayerConstLowerBound() :
-        _waitTimeLowerBound(std::chrono::milliseconds(0)),
-        _lastCallFinish(std::chrono::steady_clock::now())
-    {}
-    DbusDelayerConstLowerBound(
-        const std::chrono::milliseconds& waitTimeLowerBound) :
-        _waitTimeLowerBound(waitTimeLowerBound),
-        _lastCallFinish(std::chrono::steady_clock::now())
-    {}
+    std::shared_ptr<ObjectTree> tree;
 
-    void setDelayTime(const std::chrono::milliseconds& waitTimeLowerBound);
-
-  protected:
-    std::chrono::milliseconds callStartAttemptImpl(
-        const std::string& signature,
-        const std::chrono::time_point<std::chrono::steady_clock>& now);
-    void callFinishedImpl(
-        const std::string& signature,
-        const std::chrono::time_point<std::chrono::steady_clock>& now);
-
-  private:
-    std::chrono::milliseconds _waitTimeLowerBound;
-    std::chrono::time_point<std::chrono::steady_clock> _lastCallFinish;
+    static std::shared_ptr<ObjectTree> defaultTree()
+    {
+        auto shared = ObjectTree::shared();
+        return shared->isLive() ? shared : std::make_shared<ObjectTree>();
+    }
 };
 
-extern DbusDelayerConstLowerBound defaultDbusDelayer;
+// DelayedMethod //////////////////////////////////////////////////////////////
 
 /**
- * @brief Makes sure the underlying DbusDelayer object is in proper state
+ * @brief A method call waiting for a @c RateLimiter permit of its
+ *        destination service before it is sent
+ *
+ *  Under a @c DeadlineScope the call times out with the deadline, and
+ *  throws ETIMEDOUT without being sent once the deadline has passed.
  */
-
-class DbusDelayerStateGuard
-{
-  public:
-    DbusDelayerStateGuard(DbusDelayer* dbusDelayer, const std::string& repr) :
-        _dbusDelayer(dbusDelayer), _repr(repr)
-    {}
-
-    ~DbusDelayerStateGuard();
-
-  private:
-    DbusDelayer* _dbusDelayer;
-    const std::string& _repr;
-};
-
 class DelayedMethod
 {
 
   public:
-    DelayedMethod(DbusDelayer* dbusDelayer, sdbusplus::bus::bus& bus,
-                  const std::string& service, const std::string& object,
-                  const std::string& interface, const std::string& method) :
-        _dbusDelayer(dbusDelayer),
-        _repr(service + " " + object + " " + interface + " " + method),
-        _bus(bus),
-        _method(bus.new_method_call(service.c_str(), object.c_str(),
-                                    interface.c_str(), method.c_str()))
-    {
-        if (dbusDelayer == nullptr)
-        {
-            throw std::runtime_error("'dbusDelayer' argument must be non-null");
-        }
-    }
-
-    DelayedMethod(sdbusplus::bus::bus& bus, const std::string& service,
+    DelayedMethod(BusPtr bus, const std::string& service,
                   const std::string& object, const std::string& interface,
                   const std::string& method) :
-        _dbusDelayer(&defaultDbusDelayer),
+        _service(service),
         _repr(service + " " + object + " " + interface + " " + method),
-        _bus(bus),
-        _method(bus.new_method_call(service.c_str(), object.c_str(),
-                                    interface.c_str(), method.c_str()))
+        _bus(std::move(bus)),
+        _method(_bus->new_method_call(service.c_str(), object.c_str(),
+                                      interface.c_str(), method.c_str()))
     {}
 
     template <typename T>
@@ -731,9 +711,9 @@ class DelayedMethod
         call(std::optional<sdbusplus::SdBusDuration> timeout = std::nullopt);
 
   private:
-    DbusDelayer* _dbusDelayer;
+    std::string _service;
     std::string _repr;
-    sdbusplus::bus::bus& _bus;
+    BusPtr _bus;
     sdbusplus::message::message _method;
 };
 
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/exception.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace dbus
+{
+
+/**
+ * @brief Which bus sdbusplus opens, see sdbusplus::bus::new_default() and
+ *        sdbusplus::bus::new_default_system()
+ */
+enum class BusType
+{
+    defaultBus = 0,
+    systemBus = 1
+};
+
+using BusPtr = std::shared_ptr<sdbusplus::bus::bus>;
+
+/**
+ * @brief Counters of @c ConnectionPool, as seen by @c ConnectionPool::stats()
+ */
+struct ConnectionStats
+{
+    /** connections opened since start, including reconnects */
+    size_t opened;
+    /** get() calls served by an already open connection */
+    size_t reused;
+    /** connections given up by drop() or after a connection error */
+    size_t dropped;
+    /** connections currently served by the pool */
+    size_t open;
+};
+
+/**
+ * @class ConnectionPool
+ * @brief Persistent D-Bus connections for the synchronous reads and writes
+ *
+ *  An sd-bus connection must not be used by two threads at the same time,
+ *  so every thread gets its own connection of each bus type, opened on first
+ *  use and kept until the thread exits. An event costs at most one socket
+ *  setup per thread instead of one per D-Bus call.
+ *
+ *  A connection which failed with a connection error (see
+ *  isConnectionError()) is marked stale by failed(), the next get() of the
+ *  thread replaces it with a new one. Connections are shared, callers still
+ *  holding a stale one keep it alive until they let it go.
+ */
+class ConnectionPool
+{
+  public:
+    static ConnectionPool& instance();
+
+    /**
+     * @brief The connection of the calling thread, opened if needed or if
+     *        the previous one went stale
+     *
+     *  Hold on to the returned pointer for as long as the connection is
+     *  used, it may be replaced by the next get().
+     */
+    BusPtr get(BusType type = BusType::defaultBus);
+
+    /**
+     * @brief Mark the connection of the calling thread stale, the next get()
+     *        opens a new one
+     */
+    void drop(BusType type = BusType::defaultBus);
+
+    /**
+     * @brief Report a failed call on the connection of the calling thread,
+     *        drops the connection if @c e is a connection error
+     *
+     * @return true if the connection was dropped
+     */
+    bool failed(const sdbusplus::exception::exception& e,
+                BusType type = BusType::defaultBus);
+
+    /**
+     * @brief Whether @c error (an errno) means the connection itself is
+     *        broken rather than the call
+     */
+    static bool isConnectionError(int error);
+
+    ConnectionStats stats() const;
+
+  private:
+    ConnectionPool() = default;
+
+    /** the connections of one thread, closed when the thread exits */
+    struct ThreadConnections
+    {
+        ConnectionPool* pool = nullptr;
+        std::array<BusPtr, 2> buses;
+        /** set by drop(), buses[i] is replaced on the next get() */
+        std::array<bool, 2> stale{};
+        ~ThreadConnections();
+    };
+
+    static ThreadConnections& threadConnections();
+
+    std::atomic<size_t> _opened{0};
+    std::atomic<size_t> _reused{0};
+    std::atomic<size_t> _dropped{0};
+    std::atomic<size_t> _open{0};
+};
+
+/**
+ * @brief Shortcut for ConnectionPool::instance().get(type)
+ */
+inline BusPtr connection(BusType type = BusType::defaultBus)
+{
+    return ConnectionPool::instance().get(type);
+}
+
+} // namespace dbus
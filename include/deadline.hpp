@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Time an event has, from the arrival of its PropertiesChanged signal, for
+ * all its D-Bus calls: detection, accessor reads, telemetries and log
+ * creation; 0 for no deadline
+ */
+#ifndef EVENT_DEADLINE_MS
+#define EVENT_DEADLINE_MS 10000
+#endif
+
+/**
+ * Time the logging calls of an event (create, resolve) get at least, even
+ * when the earlier stages used up its deadline
+ */
+#ifndef EVENT_LOG_MIN_TIMEOUT_MS
+#define EVENT_LOG_MIN_TIMEOUT_MS 2000
+#endif
+
+namespace dbus
+{
+
+/**
+ * @brief Part of the event pipeline making a D-Bus call
+ */
+enum class Stage
+{
+    none,      // outside of an event (selftest, bootup, startup)
+    detection, // EventsDetection() and the accessor reads of the checks
+    handlers,  // event handlers, besides the stages below
+    telemetry, // reading the telemetries of the log
+    logging    // creating and resolving logs
+};
+
+constexpr size_t stageCount = 5;
+
+const char* stageName(Stage stage);
+
+/**
+ * @brief Counters of @c DeadlineScope, per @c Stage
+ */
+struct DeadlineStats
+{
+    /** calls not sent, the deadline had already passed */
+    std::array<size_t, stageCount> expired;
+    /** calls sent whose reply did not come in time */
+    std::array<size_t, stageCount> timedOut;
+};
+
+/**
+ * @class Deadline
+ * @brief A point in time the D-Bus calls of an event must be done by, or
+ *        none
+ */
+class Deadline
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief No deadline, the calls use the default D-Bus timeout */
+    Deadline() = default;
+
+    explicit Deadline(Clock::time_point at) : _at(at)
+    {}
+
+    static Deadline after(std::chrono::milliseconds budget,
+                          Clock::time_point start = Clock::now());
+
+    /**
+     * @brief The deadline of an event whose signal arrived at @c arrived,
+     *        none if the event budget is 0
+     */
+    static Deadline forEvent(Clock::time_point arrived);
+
+    static void setEventBudget(std::chrono::milliseconds budget);
+    static std::chrono::milliseconds eventBudget();
+
+    bool isSet() const
+    {
+        return _at.has_value();
+    }
+
+    std::optional<Clock::time_point> at() const
+    {
+        return _at;
+    }
+
+    bool expired() const;
+
+    /**
+     * @brief The timeout of a call made now: the earlier of @c timeout and
+     *        the time left, at least 1 us
+     */
+    std::optional<sdbusplus::SdBusDuration>
+        timeout(std::optional<sdbusplus::SdBusDuration> timeout =
+                    std::nullopt) const;
+
+    /**
+     * @brief This deadline, moved to @c minimum from now if it is earlier
+     */
+    Deadline atLeast(std::chrono::milliseconds minimum) const;
+
+  private:
+    std::optional<Clock::time_point> _at;
+};
+
+/**
+ * @class DeadlineScope
+ * @brief Deadline and stage of the D-Bus calls of the current thread
+ *
+ *  The event pipeline opens a scope when it takes a signal from the queue,
+ *  with the deadline counted from the signal arrival, and passes the
+ *  deadline along to the threads running the event handlers. Every
+ *  DelayedMethod::call() made meanwhile gets its timeout from the time left,
+ *  and fails at once with ETIMEDOUT once it is gone, so one hung provider
+ *  cannot hold a thread for the whole default D-Bus timeout.
+ *
+ *  Scopes nest, the previous deadline and stage are back when a scope ends.
+ */
+class DeadlineScope
+{
+  public:
+    DeadlineScope(Deadline deadline, Stage stage);
+
+    /**
+     * @brief Keep the current stage
+     */
+    explicit DeadlineScope(Deadline deadline);
+
+    /**
+     * @brief Keep the current deadline
+     */
+    explicit DeadlineScope(Stage stage);
+
+    ~DeadlineScope();
+
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+
+    static Deadline current();
+    static Stage stage();
+
+    /** @brief A call of the current stage was not sent, out of time */
+    static void countExpired();
+    /** @brief A call of the current stage got no reply in time */
+    static void countTimedOut();
+
+    static DeadlineStats stats();
+
+  private:
+    Deadline _previousDeadline;
+    Stage _previousStage;
+};
+
+} // namespace dbus
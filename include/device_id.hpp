@@ -16,16 +16,29 @@
 #include <boost/algorithm/string/split.hpp>
 
 #include <array>
+#include <atomic>
 #include <charconv>
+#include <cstdint>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <ranges>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <unordered_map>
 #include <vector>
 
+/**
+ * @brief Maximum number of distinct strings kept by the
+ * @c device_id::PatternCache
+ */
+#ifndef DEVICE_ID_PATTERN_CACHE_MAX_SIZE
+#define DEVICE_ID_PATTERN_CACHE_MAX_SIZE 4096
+#endif
+
 namespace device_id
 {
 
@@ -552,8 +565,140 @@ class DeviceIdPattern
      * allows for expressing shifted indexing.
      */
     std::vector<syntax::BracketMap> _bracketInputMappings;
+
+    /**
+     * @brief Inverse of @c _bracketInputMappings restricted to the input
+     * domains, compiled once for 'match()'
+     *
+     * For each bracket maps the value it evaluates to onto the sorted list of
+     * in-domain input arguments producing it. For "HSC_[0-1:8,2-3:9]" that
+     * would be
+     *
+     * _bracketOutputMappings = vector{
+     *     [0]: map{ [8]: vector{ 0, 1 }, [9]: vector{ 2, 3 } }
+     * }
+     */
+    std::vector<std::map<unsigned, std::vector<unsigned>>>
+        _bracketOutputMappings;
+
+    /**
+     * @brief Match the part of @c str starting at @c strPos against the
+     * pattern starting at bracket @c bracketPos
+     *
+     * Performs a single left-to-right scan, backtracking only over the
+     * candidate lengths of a bracket value (when the following text begins
+     * with a digit) and over the arguments of non-injective mappings.
+     *
+     * @param[in,out] args Input arguments fixed so far, unspecified where not
+     * fixed yet
+     *
+     * @param[out] res Every full match is appended here
+     *
+     * @param[in] firstOnly Stop after the first full match
+     *
+     * @return true if at least one full match was found
+     */
+    bool matchFrom(const std::string& str, unsigned bracketPos,
+                   std::size_t strPos, std::vector<int>& args,
+                   std::vector<PatternIndex>& res, bool firstOnly) const;
+};
+
+// PatternCache ///////////////////////////////////////////////////////////////
+
+/**
+ * @brief Counters of the @c PatternCache lookups
+ */
+struct PatternCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::size_t size = 0;
 };
 
+/**
+ * @class PatternCache
+ * @brief Process-wide intern table of compiled device id patterns
+ *
+ * Constructing a @c DeviceIdPattern parses the brackets and computes the
+ * input domains, which is a waste when the same handful of strings from
+ * event_info.json and the DAT are compiled on every signal. The cache keeps
+ * one immutable compiled pattern per distinct string.
+ *
+ * Lookups take a shared lock, only a miss takes the exclusive one. The table
+ * is pre-populated at startup, so normally nothing is inserted while signals
+ * are handled. Strings without brackets (eg. concrete object paths coming
+ * from signals) hold no range, they are compiled on every call and neither
+ * stored nor counted. Other strings not known up front are inserted until
+ * @c DEVICE_ID_PATTERN_CACHE_MAX_SIZE entries; past that limit misses are
+ * compiled and returned without being stored.
+ *
+ * Patterns are handed out as shared pointers so they stay valid across
+ * @c clear().
+ */
+class PatternCache
+{
+  public:
+    using PatternPtr = std::shared_ptr<const DeviceIdPattern>;
+
+    explicit PatternCache(
+        std::size_t maxSize = DEVICE_ID_PATTERN_CACHE_MAX_SIZE) :
+        _maxSize(maxSize)
+    {}
+
+    PatternCache(const PatternCache&) = delete;
+    PatternCache& operator=(const PatternCache&) = delete;
+
+    /**
+     * @brief The cache shared by the whole process
+     */
+    static PatternCache& instance();
+
+    /**
+     * @brief Return the compiled @c pattern, compiling it on a miss
+     *
+     * Throws the same exceptions as the @c DeviceIdPattern constructor.
+     * Invalid patterns are never stored.
+     */
+    PatternPtr get(const std::string& pattern);
+
+    /**
+     * @brief Compile and store @c pattern without counting a lookup
+     *
+     * @return false if @c pattern is not a valid device id pattern
+     */
+    bool preload(const std::string& pattern);
+
+    PatternCacheStats stats() const;
+
+    void clear();
+
+  private:
+    PatternPtr insert(const std::string& pattern);
+
+    const std::size_t _maxSize;
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<std::string, PatternPtr> _patterns;
+    std::atomic<uint64_t> _hits{0};
+    std::atomic<uint64_t> _misses{0};
+};
+
+/**
+ * @brief Whether @c str may hold a device range, ranges are always in
+ *        brackets
+ */
+inline bool hasBrackets(std::string_view str)
+{
+    return str.find('[') != std::string_view::npos;
+}
+
+/**
+ * @brief Shorthand for 'PatternCache::instance().get(pattern)'
+ */
+inline PatternCache::PatternPtr cachedPattern(const std::string& pattern)
+{
+    return PatternCache::instance().get(pattern);
+}
+
 // Helper functions ///////////////////////////////////////////////////////////
 
 PatternInputDomain
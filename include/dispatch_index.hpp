@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include "event_info.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dispatch_index
+{
+
+using EventNodeSharedList = std::vector<std::shared_ptr<event_info::EventNode>>;
+
+/**
+ * @brief The DBUS accessor a PropertiesChanged of @a property of
+ *        @a interface on @a objectPath is dispatched with
+ */
+data_accessor::DataAccessor dbusTrigger(const std::string& objectPath,
+                                        const std::string& interface,
+                                        const std::string& property);
+
+/**
+ * @class StringInterner
+ * @brief Maps strings to dense integer IDs, lookups do not allocate
+ */
+class StringInterner
+{
+  public:
+    using Id = uint32_t;
+    static constexpr Id invalidId = UINT32_MAX;
+
+    /**
+     * @brief Returns the ID of @a str, creating one if it is new
+     */
+    Id intern(std::string_view str);
+
+    /**
+     * @brief Returns the ID of @a str or @c invalidId if it was never interned
+     */
+    Id find(std::string_view str) const;
+
+    const std::string& str(Id id) const
+    {
+        return _strings.at(id);
+    }
+
+    size_t size() const
+    {
+        return _strings.size();
+    }
+
+  private:
+    struct TransparentHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    std::unordered_map<std::string, Id, TransparentHash, std::equal_to<>>
+        _ids;
+    std::vector<std::string> _strings;
+};
+
+/**
+ * @class DispatchIndex
+ * @brief Resolves a PropertiesChanged (object, interface, property) to the
+ *        events whose trigger or recovery accessor listens to it.
+ *
+ *  Built once at profile load from the EventTriggerView and
+ *  EventRecoveryView: DBUS accessor object paths are expanded to every
+ *  concrete path of their device range, and each (path, interface,
+ *  property) is interned into a key of three integer IDs, stored with the
+ *  trigger accessor of the key. Resolving a signal then costs one hash
+ *  probe per string plus one probe of the key, and the accessor is only
+ *  copied, no json is built.
+ *
+ *  The list returned for a key has the same contents as the Trigger View
+ *  lookup followed by the Recovery View lookup in eventDiscovery(): events
+ *  matched by their trigger first, then events matched only by their
+ *  recovery accessor.
+ *
+ *  Not thread safe for writing: build() must complete before signals are
+ *  dispatched; after that concurrent find() calls are fine.
+ */
+class DispatchIndex
+{
+  public:
+    /**
+     * @brief What a key resolves to
+     */
+    struct Entry
+    {
+        /** @sa dbusTrigger(), without a value */
+        data_accessor::DataAccessor trigger;
+        EventNodeSharedList events;
+    };
+
+    /**
+     * @brief (Re)builds the index from the views
+     *
+     * @return false if some DBUS accessor could not be compiled, in which
+     *         case the index stays unusable (isBuilt() returns false) and
+     *         the caller must keep using the views
+     */
+    bool build(const event_info::EventTriggerView& triggerView,
+               const event_info::EventRecoveryView& recoveryView);
+
+    /**
+     * @brief Returns the trigger and the events interested in the signal,
+     *        nullptr if none
+     */
+    const Entry* find(std::string_view objectPath,
+                                    std::string_view interface,
+                                    std::string_view property) const;
+
+    bool isBuilt() const
+    {
+        return _built;
+    }
+
+    /**
+     * @brief Number of distinct (path, interface, property) keys
+     */
+    size_t size() const
+    {
+        return _dispatch.size();
+    }
+
+    void clear();
+
+  private:
+    struct Key
+    {
+        StringInterner::Id path;
+        StringInterner::Id interface;
+        StringInterner::Id property;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            uint64_t h = key.path;
+            h = h * 0x9E3779B97F4A7C15ULL + key.interface;
+            h = h * 0x9E3779B97F4A7C15ULL + key.property;
+            return std::hash<uint64_t>{}(h);
+        }
+    };
+
+    /**
+     * @brief Adds all concrete keys of @a accessor pointing to @a event,
+     *        skipping events already present for a key
+     */
+    void add(const data_accessor::DataAccessor& accessor,
+             const std::shared_ptr<event_info::EventNode>& event);
+
+    StringInterner _paths;
+    StringInterner _interfaces;
+    StringInterner _properties;
+    std::unordered_map<Key, Entry, KeyHash> _dispatch;
+    bool _built = false;
+};
+
+} // namespace dispatch_index
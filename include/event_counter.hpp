@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Number of independently locked parts of the counter store
+ */
+#ifndef EVENT_COUNTER_SHARDS
+#define EVENT_COUNTER_SHARDS 16
+#endif
+
+namespace event_counter
+{
+
+/**
+ * @brief One (event, device) counter as seen by @c CounterStore::snapshot()
+ */
+struct CounterEntry
+{
+    std::string event;
+    std::string device;
+    double count;
+};
+
+/**
+ * @class CounterStore
+ * @brief Leaky bucket occurrence counters of the counted events
+ *
+ *  An event with "trigger_count" N is reported on its N-th occurrence on a
+ *  device, and on every occurrence after that as long as the bucket stays
+ *  full. With a decay window W the bucket leaks one occurrence per W, so
+ *  occurrences spread wider than that never add up to an event. A zero
+ *  window disables the leak and the counts only grow.
+ *
+ *  The counters are keyed by (event name, device name) and spread over
+ *  @c EVENT_COUNTER_SHARDS independently locked shards, so the worker and
+ *  bootup threads updating different events don't contend.
+ */
+class CounterStore
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Record one occurrence of @c event on @c device
+     *
+     * @param triggerCount occurrences needed to report the event, the
+     *        counter saturates at this value
+     * @param decayWindow time for one occurrence to leak out of the bucket,
+     *        zero for no leak
+     *
+     * @return true if the counter reached @c triggerCount
+     */
+    bool hit(const std::string& event, const std::string& device,
+             int triggerCount, std::chrono::milliseconds decayWindow,
+             Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Current count of @c event on @c device, 0 if never hit
+     *
+     * The value is the one stored by the last update, not leaked up to now.
+     */
+    double get(const std::string& event, const std::string& device) const;
+
+    /**
+     * @brief Overwrite the count of @c event on @c device
+     */
+    void set(const std::string& event, const std::string& device, double count,
+             Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Forget the count of @c event on @c device
+     */
+    void reset(const std::string& event, const std::string& device);
+
+    /**
+     * @brief Copy of all the counters, in no particular order
+     */
+    std::vector<CounterEntry> snapshot() const;
+
+    size_t size() const;
+
+    void clear();
+
+  private:
+    struct Bucket
+    {
+        std::string event;
+        std::string device;
+        double count = 0;
+        Clock::time_point updated;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Bucket> buckets;
+    };
+
+    static std::string key(const std::string& event, const std::string& device);
+
+    Shard& shard(const std::string& key);
+    const Shard& shard(const std::string& key) const;
+
+    std::array<Shard, EVENT_COUNTER_SHARDS> _shards;
+};
+
+} // namespace event_counter
@@ -14,12 +14,17 @@
 #include "check_accessor.hpp"
 #include "dat_traverse.hpp"
 #include "dbus_accessor.hpp"
+#include "deadline.hpp"
+#include "dispatch_index.hpp"
+#include "event_counter.hpp"
 #include "event_handler.hpp"
 #include "event_info.hpp"
 #include "object.hpp"
 #include "pc_event.hpp"
 #include "selftest.hpp"
+#include "subscription_plan.hpp"
 #include "threadpool_manager.hpp"
+#include "worker_pool.hpp"
 
 #include <boost/container/flat_map.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -28,6 +33,8 @@
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -39,16 +46,52 @@
 #define PROPERTIESCHANGED_QUEUE_SIZE 100
 #endif
 
+/**
+ * How long a push waits for free space under PcOverflowPolicy::block
+ */
+#ifndef PROPERTIESCHANGED_QUEUE_BLOCK_TIMEOUT_MS
+#define PROPERTIESCHANGED_QUEUE_BLOCK_TIMEOUT_MS 100
+#endif
+
+/**
+ * Maximum number of PropertiesChanged items the worker thread processes
+ * per wakeup before checking the queue again
+ */
+#ifndef PROPERTIESCHANGED_MAX_BATCH_SIZE
+#define PROPERTIESCHANGED_MAX_BATCH_SIZE 16
+#endif
+
+/**
+ * Time the worker thread blocks waiting for a push before waking up anyway
+ */
+#ifndef PROPERTIESCHANGED_WAIT_TIMEOUT_MS
+#define PROPERTIESCHANGED_WAIT_TIMEOUT_MS 1000
+#endif
+
 namespace event_detection
 {
 extern std::unique_ptr<PcQueueType> queue;
 
+/** maximum batch drained by the worker thread, see workerThreadProcessEvents */
+extern size_t queueMaxBatchSize;
+
 extern event_info::EventTriggerView eventTriggerView;
 extern event_info::EventAccessorView eventAccessorView;
 extern event_info::EventRecoveryView eventRecoveryView;
 
+/** compiled from eventTriggerView and eventRecoveryView, used by
+ *  dbusEventHandlerCallback() */
+extern dispatch_index::DispatchIndex dispatchIndex;
+
 extern std::unique_ptr<ThreadpoolManager> threadpoolManager;
 
+/** persistent threads running the event handlers, see RunEventHandlers() */
+extern std::unique_ptr<WorkerPool> workerPool;
+
+/** object:interface pairs subscribed by startEventDetection(), signals
+ *  delivered by a shared namespace rule for other objects are dropped */
+extern subscription_plan::SubscriptionPlan subscriptionPlan;
+
 /** check() from event.trigger against dbusAcc returned false */
 constexpr auto msgFalseCheckTriggerCriteria =
     "event.trigger check criteria does not match dbusAcc property value";
@@ -80,15 +123,6 @@ using EventCandidateList =
     std::vector<std::tuple<std::shared_ptr<event_info::EventNode>,
                            data_accessor::AssertedDeviceList, bool>>;
 
-/**
- *   A map to check if a pair object-path + interface has already been
- *    registered for receiving PropertyChange signal from dbus
- *
- *   if a object-path + interface is registred more than once, more than once
- *    message will arrive.
- */
-using RegisteredObjectInterfaceMap = std::map<const std::string, int>;
-
 /**
  *   Shared Pointers list of event_info::EventNode
  */
@@ -107,7 +141,8 @@ class EventDetection : public object::Object
                    event_handler::EventHandlerManager* hdlrMgr) :
         object::Object(name),
         _eventMap(eventMap), _propertyFilterSet(propertyFilterSet),
-        _hdlrMgr(hdlrMgr)
+        _hdlrMgr(hdlrMgr),
+        _eventCounters(std::make_shared<event_counter::CounterStore>())
     {}
     ~EventDetection() = default;
 
@@ -124,8 +159,23 @@ class EventDetection : public object::Object
     /**
      * @brief This is the loop which actually processes PropertiesChanged
      * messages
+     *
+     *  Blocks until pushToQueue() signals new data, then drains the queue
+     *  in batches of at most queueMaxBatchSize elements. Returns once
+     *  stopWorkerThread() was called.
      */
     static void workerThreadProcessEvents();
+
+    /**
+     * @brief Makes the worker thread return within
+     *        PROPERTIESCHANGED_WAIT_TIMEOUT_MS
+     */
+    static void stopWorkerThread();
+
+    /**
+     * @return true once stopWorkerThread() was called
+     */
+    static bool workerThreadStopped();
        
     /**
      * @brief bootUpEventsDetection() checks all events on BootUp
@@ -152,18 +202,34 @@ class EventDetection : public object::Object
      * @param pcTrigger the Accessor created from PropertyChange signal
      * 
      * @param eventPtrs The list of Events that match the @a pcTrigger
+     *
+     * @param arrived when the signal was received
      */
     static void pushToQueue(const data_accessor::DataAccessor& pcTrigger,
-                            EventNodeSharedList eventPtrs);
+                            EventNodeSharedList eventPtrs,
+                            std::chrono::steady_clock::time_point arrived =
+                                std::chrono::steady_clock::now());
     
     /**
      * @brief Checks if there is data in the queue data to detect events
      * 
-     *     If so calls EventsDetection() 
-     *     @sa EventsDetection() 
+     *     If so calls processQueueData()
+     *     @sa processQueueData()
+     *
+     * @return true if an element was popped from the queue
+     */
+    static bool popFromQueue();
+
+    /**
+     * @brief Runs EventsDetection() and processEventList() on a single
+     *        element taken from the queue
+     *
+     *     Under the deadline of the event, counted from the signal arrival
+     *
+     *     @sa EventsDetection()
      *     @sa processEventList()
      */
-    static void popFromQueue();   
+    static void processQueueData(const PcDataType& pc);
 
     /**
      * @brief This is the callback which handles DBUS properties changes
@@ -191,7 +257,7 @@ class EventDetection : public object::Object
 #ifdef EVENTING_SERVICE_NO_DEVICE_HEALTH
         logs_err("not setting device Health: Device Health service is enabled\n");
 #else
-        dbus::DirectObjectMapper om;
+        dbus::CachingObjectMapper om;
         const std::string healthInterface(
             "xyz.openbmc_project.State.Decorator.Health");
         std::vector<std::string> objPathsToAlter =
@@ -223,8 +289,12 @@ class EventDetection : public object::Object
      * @param bus
      */
     static void setLogEntryResolved(const std::string objPath,
-                                    sdbusplus::bus::bus& bus)
+                                    const dbus::BusPtr& bus)
     {
+        dbus::DeadlineScope logging(dbus::DeadlineScope::current().atLeast(
+                                        std::chrono::milliseconds(
+                                            EVENT_LOG_MIN_TIMEOUT_MS)),
+                                    dbus::Stage::logging);
         try
         {
             std::variant<bool> v = true;
@@ -253,7 +323,7 @@ class EventDetection : public object::Object
     static void recoverFromPowerCycleEvents(
         const std::string& devId,
         const dbus::utility::ManagedObjectType& result,
-        sdbusplus::bus::bus& bus)
+        const dbus::BusPtr& bus)
     {
         for (auto& objectPath : result)
         {
@@ -276,7 +346,11 @@ class EventDetection : public object::Object
     static void resolveDeviceLogs(const std::string& eventName,
                                   const std::string& fullDeviceName)
     {
-        auto bus = sdbusplus::bus::new_default_system();
+        dbus::DeadlineScope logging(dbus::DeadlineScope::current().atLeast(
+                                        std::chrono::milliseconds(
+                                            EVENT_LOG_MIN_TIMEOUT_MS)),
+                                    dbus::Stage::logging);
+        auto bus = dbus::connection(dbus::BusType::systemBus);
         dbus::utility::ManagedObjectType result;
         std::string devId{""};
         auto deviceNames = event_info::EventNode::separateFullDeviceName(
@@ -296,6 +370,8 @@ class EventDetection : public object::Object
         }
         catch (const sdbusplus::exception::exception& e)
         {
+            dbus::ConnectionPool::instance().failed(
+                e, dbus::BusType::systemBus);
             logs_err(" Dbus Error: %s\n", e.what());
             throw std::runtime_error(e.what());
         }
@@ -559,6 +635,10 @@ class EventDetection : public object::Object
     /**
      * @brief Check if the candidate is an event based on Leaky Bucket logic.
      *
+     * The occurrences are counted per device in @c eventCounters(), leaking
+     * with the event's counterDecayWindow. Events with "value_as_count"
+     * compare the read value instead and don't touch the counters.
+     *
      * @param candidate
      * @return true
      * @return false
@@ -567,11 +647,13 @@ class EventDetection : public object::Object
                  const std::string& device,
                  int compareCount = invalidIntParam)
     {
-        int count = candidate.count[device] + 1;
         if (candidate.valueAsCount)
         {
-            count = (compareCount == -1) ? std::stoi(candidate.accessor.read())
-                                         : compareCount;
+            int count = (compareCount == -1)
+                            ? std::stoi(candidate.accessor.read())
+                            : compareCount;
+            return candidate.triggerCount != -1 &&
+                   candidate.triggerCount - count <= 0;
         }
 
         if (candidate.triggerCount == -1)
@@ -579,22 +661,17 @@ class EventDetection : public object::Object
             return false;
         }
 
-        auto countDiff = candidate.triggerCount - count;
-
-        if (countDiff <= 0)
-        {
-            if (!candidate.valueAsCount)
-            {
-                candidate.count[device] = candidate.triggerCount;
-            }
-            return true;
-        }
+        return _eventCounters->hit(candidate.event, device,
+                                   candidate.triggerCount,
+                                   candidate.counterDecayWindow);
+    }
 
-        if (!candidate.valueAsCount)
-        {
-            candidate.count[device]++;
-        }
-        return false;
+    /**
+     * @brief The counters used by IsEvent(), for inspection
+     */
+    event_counter::CounterStore& eventCounters()
+    {
+        return *_eventCounters;
     }
     
     /**
@@ -609,44 +686,41 @@ class EventDetection : public object::Object
         ss << "calling hdlrMgr: " << this->_hdlrMgr->getName()
            << " event: " << event.event;
         log_dbg("%s\n", ss.str().c_str());
+        dbus::DeadlineScope stage(dbus::Stage::handlers);
         auto hdlrMgr = *this->_hdlrMgr;
         hdlrMgr.RunHandler(event, name);
     }
     
     /**
-     * @brief Throw out a thread to run a single event handle on the Event.
+     * @brief Queue a single event handler on the Event to the worker pool.
+     *
+     * Queued in the lane of the event's device, so handlers for one device
+     * run in order. Runs it in the calling thread if the pool was not
+     * created.
      *
      * @param event
+     * @param name
      */
     void RunEventHandler(event_info::EventNode& event, const std::string& name)
     {
-        log_err("entered RunEventHandler\n");
-        auto guard = std::make_shared<ThreadpoolGuard>(threadpoolManager.get());
-        if (!guard->was_successful())
+        if (workerPool == nullptr)
         {
-            log_err(
-                "Thread pool over maxTotal tasks limit, not creating thread\n");
-            log_err("finished RunEventHandlers\n");
+            runSingleEventHandler(event, name);
             return;
         }
-        auto thread =
-            std::make_unique<std::thread>([this, event, guard, name]() mutable {
-                log_err("started event thread\n");
-                runSingleEventHandler(event, name);               
-                log_err("finished event thread\n");
-            });
-
-        if (thread != nullptr)
+        // the handler keeps the deadline of the event
+        auto deadline = dbus::DeadlineScope::current();
+        if (!workerPool->submit(event.device,
+                                [this, event, name, deadline]() mutable {
+                                    dbus::DeadlineScope scope(deadline);
+                                    runSingleEventHandler(event, name);
+                                }))
         {
-            thread->detach(); // separate, this no longer owns this thread
+            log_err("Event '%s' handler %s for device '%s' not run\n",
+                    event.event.c_str(), name.c_str(), event.device.c_str());
         }
-        else
-        {
-            log_err("Create thread to process event failed!\n");
-        }
-        log_err("finished RunEventHandler\n");
     }
-    
+
     /**
      * @brief run all event handlers on the Event (does not start new thread)
      * @param event
@@ -657,48 +731,38 @@ class EventDetection : public object::Object
         ss << "calling hdlrMgr: " << this->_hdlrMgr->getName()
            << " event: " << event.event;
         log_dbg("%s\n", ss.str().c_str());
+        dbus::DeadlineScope stage(dbus::Stage::handlers);
         auto hdlrMgr = *this->_hdlrMgr;
         hdlrMgr.RunAllHandlers(event);
     }
     
     /**
-     * @brief Throw out a thread to run all event handlers on the Event.
+     * @brief Queue all event handlers on the Event to the worker pool.
+     *
+     * Queued in the lane of the event's device: the handlers of the events
+     * of one device run in detection order, different devices in parallel.
+     * Runs them in the calling thread if the pool was not created.
      *
      * @param event
      */
     void RunEventHandlers(event_info::EventNode& event)
     {
-        log_err("entered RunEventHandlers\n");
-        auto guard = std::make_shared<ThreadpoolGuard>(threadpoolManager.get());
-        if (!guard->was_successful())
+        if (workerPool == nullptr)
         {
-            // the threadpool has reached the max queued tasks limit,
-            // don't run this event thread
-            log_err(
-                "Thread pool over maxTotal tasks limit, not creating thread\n");
-            log_err("finished RunEventHandlers\n");
+            runAllEventHandlers(event);
             return;
         }
-        // capturing guard in the lambda is needed to extend the lifetime
-        // of the ThreadpoolGuard so that it only gets destructed
-        // (and the thread slot released) when both this trigger function
-        // and the thread have finished executing.
-        auto thread =
-            std::make_unique<std::thread>([this, event, guard]() mutable {
-                log_err("started event thread\n");
-                runAllEventHandlers(event);                
-                log_err("finished event thread\n");
-            });
-
-        if (thread != nullptr)
-        {
-            thread->detach(); // separate, this no longer owns this thread
-        }
-        else
+        // the handlers keep the deadline of the event
+        auto deadline = dbus::DeadlineScope::current();
+        if (!workerPool->submit(event.device,
+                                [this, event, deadline]() mutable {
+                                    dbus::DeadlineScope scope(deadline);
+                                    runAllEventHandlers(event);
+                                }))
         {
-            log_err("Create thread to process event failed!\n");
+            log_err("Event '%s' handlers for device '%s' not run\n",
+                    event.event.c_str(), event.device.c_str());
         }
-        log_err("finished RunEventHandlers\n");
     }
 
     /**
@@ -726,17 +790,14 @@ class EventDetection : public object::Object
 
   private:
     /**
-     * @brief  Subscribe Accessor Dbus objects to receive PropertyChanged signal
+     * @brief  Add the Accessor Dbus objects to the PropertyChanged
+     *         subscriptions, the match rules are registered once all the
+     *         events are added
      * @param  acc the DataAccessor
-     * @param  map a global map for all events to make sure unique subscribing
-     *           for a single object + interface
-     * @param  conn the current Dbus IO connection
-     * @param  The handler list of subscribing to be populated
+     * @param  plan collects the object + interface pairs of all events
      */
     void subscribeAcc(const data_accessor::DataAccessor& acc,
-                      RegisteredObjectInterfaceMap& map,
-                      std::shared_ptr<sdbusplus::asio::connection>& conn,
-                      DbusEventHandlerList& handlerList);
+                      subscription_plan::SubscriptionPlan& plan);
 
   private:
     /**
@@ -758,6 +819,12 @@ class EventDetection : public object::Object
      *
      */
     event_handler::EventHandlerManager* _hdlrMgr;
+
+    /**
+     * @brief Occurrence counters of the events with a trigger count, shared
+     * by the copies of this object (eg. the bootup thread's one)
+     */
+    std::shared_ptr<event_counter::CounterStore> _eventCounters;
 };
 
 } // namespace event_detection
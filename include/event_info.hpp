@@ -18,6 +18,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -395,15 +396,17 @@ class EventNode : public object::Object
     /** @brief Trigger accessor info **/
     data_accessor::DataAccessor trigger;
 
-    /** @brief Event count map: maps device name to count **/
-    std::map<std::string, int> count;
-
     /** @brief Count that will trigger event **/
     int triggerCount;
 
     /** @brief Struct containing type and metadata **/
     data_accessor::DataAccessor counterReset;
 
+    /** @brief Time for one occurrence to leak out of the event counter,
+     *  zero if the counter never decays. Set by an "event_counter_reset" of
+     *  type "decay", see event_counter::CounterStore **/
+    std::chrono::milliseconds counterDecayWindow{0};
+
     /** @brief List of the event's telemetries **/
     std::vector<data_accessor::DataAccessor> telemetries;
 
@@ -497,8 +500,8 @@ class EventNode : public object::Object
         {
             if (originOfCondition.has_value())
             {
-                return device_id::DeviceIdPattern(*originOfCondition)
-                    .eval(*deviceIndexTuple);
+                return device_id::cachedPattern(*originOfCondition)
+                    ->eval(*deviceIndexTuple);
             }
             else
             {
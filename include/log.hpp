@@ -28,12 +28,20 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 namespace logging
@@ -184,6 +192,209 @@ enum LogLevel
 #define DEF_DBG_LEVEL disabled
 #endif
 
+/**
+ * Messages a thread can have waiting for the log writer thread in async
+ * mode, past that they are dropped (and counted)
+ */
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 128
+#endif
+
+/**
+ * Bytes a message holds for its arguments, or for its text when they do not
+ * fit and it is formatted by the caller
+ */
+#ifndef LOG_RECORD_SIZE
+#define LOG_RECORD_SIZE 1024
+#endif
+
+/** How often the log writer thread formats and writes the messages */
+#ifndef LOG_FLUSH_INTERVAL_MS
+#define LOG_FLUSH_INTERVAL_MS 50
+#endif
+
+/**
+ * @brief A message as Log::log() captures it in async mode: the format, the
+ *        arguments and the time, formatted by the writer thread
+ */
+struct LogRecord
+{
+    enum class Arg : uint8_t
+    {
+        sint,
+        uint,
+        real,
+        longReal,
+        str,
+        ptr
+    };
+
+    uint64_t seq;
+    struct timespec time;
+    int level;
+    const char* fmt;
+    /** payload holds the formatted message instead of the arguments */
+    bool text;
+    uint16_t size;
+    /** per argument its Arg, then its value (length and chars for str) */
+    char payload[LOG_RECORD_SIZE];
+
+    template <typename T>
+    void put(Arg arg, const T& value)
+    {
+        payload[size++] = static_cast<char>(arg);
+        memcpy(payload + size, &value, sizeof(value));
+        size += sizeof(value);
+    }
+
+    /** @brief append the string @c str, false if it does not fit */
+    bool captureString(const char* str)
+    {
+        // the caller's string may be gone once the message is formatted
+        auto length = strlen(str);
+        if (size + 1 + sizeof(uint16_t) + length > sizeof(payload))
+        {
+            return false;
+        }
+        put(Arg::str, static_cast<uint16_t>(length));
+        memcpy(payload + size, str, length);
+        size += static_cast<uint16_t>(length);
+        return true;
+    }
+
+    /** @brief append the literal or array @c arg, never null */
+    template <size_t N>
+    bool capture(const char (&arg)[N])
+    {
+        return captureString(arg);
+    }
+
+    /** @brief append @c arg, false if it does not fit */
+    template <typename T>
+    bool capture(const T& arg)
+    {
+        using D = std::decay_t<T>;
+        if constexpr (std::is_same_v<D, const char*> ||
+                      std::is_same_v<D, char*>)
+        {
+            return captureString(arg != nullptr ? arg : "(null)");
+        }
+        else if constexpr (std::is_arithmetic_v<D> || std::is_enum_v<D> ||
+                           std::is_pointer_v<D> || std::is_null_pointer_v<D>)
+        {
+            if (size + 1 + sizeof(long double) > sizeof(payload))
+            {
+                return false;
+            }
+            if constexpr (std::is_same_v<D, long double>)
+            {
+                put(Arg::longReal, arg);
+            }
+            else if constexpr (std::is_floating_point_v<D>)
+            {
+                put(Arg::real, static_cast<double>(arg));
+            }
+            else if constexpr (std::is_pointer_v<D> ||
+                               std::is_null_pointer_v<D>)
+            {
+                put(Arg::ptr, reinterpret_cast<uintptr_t>(
+                                  static_cast<const void*>(arg)));
+            }
+            else
+            {
+                using Integer = typename std::conditional_t<
+                    std::is_enum_v<D>, std::underlying_type<D>,
+                    std::type_identity<D>>::type;
+                if constexpr (std::is_signed_v<Integer>)
+                {
+                    put(Arg::sint, static_cast<int64_t>(arg));
+                }
+                else
+                {
+                    put(Arg::uint, static_cast<uint64_t>(arg));
+                }
+            }
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+};
+
+/**
+ * @brief Single producer single consumer ring of LogRecord, one per thread
+ */
+class LogRing
+{
+  public:
+    explicit LogRing(size_t slots) : _records(slots)
+    {}
+
+    /** @brief producer: the slot to fill, nullptr when full */
+    LogRecord* reserve()
+    {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _records.size())
+        {
+            return nullptr;
+        }
+        return &_records[tail % _records.size()];
+    }
+
+    /** @brief producer: publish the slot reserve() returned */
+    void commit()
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    /** @brief consumer: the @c i th oldest record, i < size() */
+    const LogRecord& at(size_t i) const
+    {
+        return _records[(_head.load(std::memory_order_relaxed) + i) %
+                        _records.size()];
+    }
+
+    /** @brief consumer: release the @c count oldest records */
+    void pop(size_t count)
+    {
+        _head.store(_head.load(std::memory_order_relaxed) + count,
+                    std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return _tail.load(std::memory_order_acquire) -
+               _head.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+        return _records.size();
+    }
+
+    /** the ring created before this one, for walking them without a lock */
+    const LogRing* next = nullptr;
+
+  private:
+    std::vector<LogRecord> _records;
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+};
+
+/**
+ * @brief vsnprintf() wrapper, to format any arguments with a format string
+ *        not known at compile time
+ */
+int formatTo(char* buffer, size_t size, const char* fmt, ...);
+
+/**
+ * @brief The message of @c record as printf would have formatted it
+ */
+std::string formatRecord(const LogRecord& record);
+
 class Log
 {
     using CtrlType = int;
@@ -199,10 +410,54 @@ class Log
 
     ~Log()
     {
+        stopCrashFlush();
+        setAsync(false);
         smDeinit();
         closeLogFile();
     }
 
+    /**
+     * @brief In async mode log() only copies the format, the arguments and
+     *        the time into a ring of the calling thread, a writer thread
+     *        formats them every LOG_FLUSH_INTERVAL_MS (or sooner once a
+     *        ring is half full) and writes them in one go, in call order.
+     *
+     *  A message logged while the ring of its thread is full is dropped and
+     *  counted, the writer reports the drops. Disabling it writes what is
+     *  left before returning.
+     *
+     * @param ringSlots of the rings of the threads logging from now on
+     */
+    void setAsync(bool enable, size_t ringSlots = LOG_RING_SLOTS);
+
+    /**
+     * @brief Write what the async mode has captured so far
+     */
+    void flush();
+
+    /**
+     * @brief Write what the async mode has captured when the process
+     *        crashes (SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL), then let the
+     *        signal do what it did
+     *
+     *  The handler runs on an alternate stack and is async-signal-safe: it
+     *  writes the records as they were captured, the text or the format
+     *  followed by the arguments, without formatting them.
+     */
+    void flushOnCrash();
+
+    /**
+     * @brief The crash handler's flush: no locks, no allocation, records the
+     *        writer thread is writing may come twice
+     */
+    void crashFlush(int signal) const;
+
+    /** @brief messages dropped in async mode, their ring full */
+    uint64_t droppedMessages() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
     void setLevel(CtrlType desiredLevel = DEF_DBG_LEVEL)
     {
         setCtrlLevel(desiredLevel);
@@ -215,6 +470,8 @@ class Log
 
     void setLogFile(const std::string& file)
     {
+        // what was logged before goes to the former file
+        flush();
         std::lock_guard<std::mutex> logGuard(lMutex);
 
         closeLogFile();
@@ -222,7 +479,18 @@ class Log
         openLogFile();
     }
 
-    void log(int desiredLevel, const char* fmt, ...)
+    /**
+     * @brief Whether messages of @c desiredLevel are written, to skip
+     *        preparing their arguments otherwise
+     */
+    bool enabled(int desiredLevel)
+    {
+        return isReady &&
+               getLogLevel(getLevel()) >= getLogLevel(desiredLevel);
+    }
+
+    template <typename... Args>
+    void log(int desiredLevel, const char* fmt, Args&&... args)
     {
         if (!isReady
             || getLogLevel(getLevel()) < getLogLevel(desiredLevel))
@@ -230,45 +498,51 @@ class Log
             // Should not print anything as log is not ready anyways
             return;
         }
-
-        std::lock_guard<std::mutex> logGuard(lMutex);
-        std::stringstream ss;
-        if (!(getLogControl(desiredLevel) & LogLevel::dataonly))
+        if (getLogControl(desiredLevel) & LogLevel::dataonly)
         {
-            // Timestamp
-            ss << timestampString();
+            return;
+        }
 
-            // Severity
-            switch (getLogLevel(desiredLevel))
+        if (_async.load(std::memory_order_acquire))
+        {
+            auto& ring = threadRing();
+            auto* record = ring.reserve();
+            if (record == nullptr)
             {
-                case LogLevel::error:
-                    ss << "E";
-                    break;
-                case LogLevel::warning:
-                    ss << "W";
-                    break;
-                case LogLevel::debug:
-                    ss << "D";
-                    break;
-                case LogLevel::information:
-                    ss << "I";
-                    break;
-                default:
-                    ss << "O";
-                    break;
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
             }
+            record->seq = _seq.fetch_add(1, std::memory_order_relaxed);
+            clock_gettime(CLOCK_REALTIME, &record->time);
+            record->level = desiredLevel;
+            record->fmt = fmt;
+            record->text = false;
+            record->size = 0;
+            if (!(record->capture(args) && ...))
+            {
+                // formatted now, while the arguments are still there
+                record->text = true;
+                auto length = formatTo(record->payload,
+                                       sizeof(record->payload), fmt, args...);
+                record->size = static_cast<uint16_t>(std::clamp<int>(
+                    length, 0, sizeof(record->payload) - 1));
+            }
+            ring.commit();
+            if (ring.size() == ring.capacity() / 2)
+            {
+                _wake.notify_one();
+            }
+            return;
+        }
 
-            // Message
-            char msg[1024] = {0};
-            va_list args;
-            va_start(args, fmt);
-            vsnprintf(msg, sizeof(msg), fmt, args);
-            va_end(args);
-
-            ss << msg;
+        // Message
+        char msg[1024] = {0};
+        formatTo(msg, sizeof(msg), fmt, args...);
 
-            outputLog(ss.str());
-        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        std::lock_guard<std::mutex> logGuard(lMutex);
+        outputLog(prefix(desiredLevel, ts) + msg);
     }
 
     void log_raw(int desiredLevel, const char* msg,
@@ -281,6 +555,8 @@ class Log
             return;
         }
 
+        // after what was logged before
+        flush();
         std::lock_guard<std::mutex> logGuard(lMutex);
         std::stringstream ss;
         // Timestamp
@@ -316,6 +592,8 @@ class Log
             return;
         }
 
+        // after what was logged before
+        flush();
         std::lock_guard<std::mutex> logGuard(lMutex);
         std::stringstream ss;
         // Timestamp
@@ -358,6 +636,40 @@ class Log
   private:
     std::mutex lMutex;
 
+    /** async mode, see setAsync() */
+    const uint64_t _id = nextId();
+    std::atomic<bool> _async{false};
+    size_t _ringSlots = LOG_RING_SLOTS;
+    std::atomic<uint64_t> _seq{0};
+    std::atomic<uint64_t> _dropped{0};
+    uint64_t _droppedReported = 0;
+    std::mutex _ringsMutex;
+    std::map<std::thread::id, std::shared_ptr<LogRing>> _rings;
+    /** the newest of _rings, linked through LogRing::next */
+    std::atomic<const LogRing*> _lastRing{nullptr};
+    /** where crashFlush() writes, the log file or stdout */
+    std::atomic<int> _crashFd{STDOUT_FILENO};
+    /** one flush() at a time */
+    std::mutex _flushMutex;
+    std::thread _writer;
+    std::mutex _writerMutex;
+    std::condition_variable _wake;
+    bool _stop = false;
+
+    static uint64_t nextId();
+
+    /** @brief no more crashFlush() of this Log */
+    void stopCrashFlush();
+
+    /** @brief the ring of the calling thread, created on its first message */
+    LogRing& threadRing();
+
+    /** @brief timestamp and severity letter */
+    std::string prefix(int level, const struct timespec& ts) const;
+
+    /** @brief the severity letter of @c level */
+    static char severity(int level);
+
     std::string logFile;
     std::string logCtrlName;
     std::fstream logStream;
@@ -393,6 +705,12 @@ class Log
         {
             throw std::runtime_error("Log file (" + logFile + ") open failed!");
         }
+        // after what logStream wrote, crashFlush() cannot use the stream
+        auto fd = ::open(logFile.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (fd != -1)
+        {
+            _crashFd = fd;
+        }
     }
 
     void closeLogFile()
@@ -404,6 +722,11 @@ class Log
             logStream.flush();
             logStream.close();
         }
+        auto fd = _crashFd.exchange(STDOUT_FILENO);
+        if (fd != STDOUT_FILENO)
+        {
+            ::close(fd);
+        }
     }
 
     void outputLog(const std::string& msg)
@@ -528,6 +851,11 @@ extern Log logger;
  **/
 #define log_get_level() logger.getLevel()
 
+/**
+ * log_enabled() tells whether a level is logged, eg. log_enabled(debug)
+ **/
+#define log_enabled(dl) logger.enabled(LogLevel::dl)
+
 /**
  * Use any following log functions for debug logs.
  * log_* for using in class non-static member functions
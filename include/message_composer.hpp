@@ -10,10 +10,12 @@
 
 #pragma once
 
+#include "async_reader.hpp"
 #include "common.hpp"
 #include "dat_traverse.hpp"
 #include "data_accessor.hpp"
 #include "dbus_accessor.hpp"
+#include "deadline.hpp"
 #include "event_handler.hpp"
 #include "event_info.hpp"
 
@@ -23,6 +25,7 @@
 #include <sdbusplus/exception.hpp>
 
 #include <string>
+#include <vector>
 
 namespace message_composer
 {
@@ -72,7 +75,7 @@ class MessageComposer : public event_handler::EventHandler
      *
      * If no associated object path could be found return an empty string.
      */
-    template <typename ObjectMapperType = dbus::DirectObjectMapper>
+    template <typename ObjectMapperType = dbus::CachingObjectMapper>
     std::string getOriginOfConditionObjectPath(const std::string& deviceId) const
     {
         ObjectMapperType om;
@@ -103,7 +106,7 @@ class MessageComposer : public event_handler::EventHandler
      * @param event
      * @return string representation of OOC
      */
-    template <typename ObjectMapperType = dbus::DirectObjectMapper>
+    template <typename ObjectMapperType = dbus::CachingObjectMapper>
     std::string getOriginOfCondition(event_info::EventNode& event)
     {
         std::string oocDevice{""};
@@ -192,6 +195,19 @@ class MessageComposer : public event_handler::EventHandler
             output["accessor"] = "empty";
         }
 
+        dbus::DeadlineScope stage(dbus::Stage::telemetry);
+        // read the DBUS telemetries concurrently up front
+        std::vector<dbus::PropertyRequest> requests;
+        util::DeviceIdData devIdData = event.getDataDeviceType();
+        for (const auto& telemetry : event.telemetries)
+        {
+            if (auto request = telemetry.dbusReadRequest(&devIdData.index))
+            {
+                requests.push_back(*request);
+            }
+        }
+        dbus::PrefetchScope prefetched(requests);
+
         for (auto telemetry : event.telemetries)
         {
             std::string telemetryName = telemetry[data_accessor::nameKey];
@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dbus
+{
+
+/**
+ * @brief Counters of @c ObjectTree, as seen by @c ObjectTree::stats()
+ */
+struct ObjectTreeStats
+{
+    /** full GetSubTree("/") reloads */
+    size_t refreshes;
+    /** signals applied to the tree without a reload */
+    size_t updates;
+    /** queries answered */
+    size_t queries;
+    /** objects in the tree */
+    size_t objects;
+};
+
+/**
+ * @class ObjectTree
+ * @brief In-memory mirror of the xyz.openbmc_project.ObjectMapper tree
+ *
+ *  The tree is loaded by one GetSubTree("/") and answers GetObject,
+ *  GetSubTree and GetSubTreePaths queries for any subtree, depth and
+ *  interfaces without a D-Bus round trip.
+ *
+ *  A tree registered with subscribe() stays current:
+ *
+ *  - InterfacesAdded/InterfacesRemoved add and remove the interfaces of
+ *    the sending service on the object,
+ *  - NameOwnerChanged drops all the objects of a service going away.
+ *
+ *  The same signals invalidate the ServiceCache of getService(), which is
+ *  enabled by subscribe().
+ *
+ *  Whatever can not be applied incrementally (a sender whose well known
+ *  name is unknown, a service appearing with objects it created before
+ *  requesting its name, unreadable signal payload) marks the tree stale and
+ *  the next query reloads it.
+ */
+class ObjectTree
+{
+  public:
+    /** @brief Manager -> Interface* */
+    using ValueType = std::map<std::string, std::vector<std::string>>;
+    /** @brief Object -> (Manager -> Interface*) */
+    using FullTreeType = std::map<std::string, ValueType>;
+
+    /**
+     * @brief The process wide tree, kept current once subscribe()d
+     */
+    static std::shared_ptr<ObjectTree> shared();
+
+    /**
+     * @brief Register the update signals on @c conn, the tree is
+     *        considered current from now on
+     *
+     * @return the matches, to be kept as long as the tree is used
+     */
+    std::vector<std::unique_ptr<sdbusplus::bus::match_t>>
+        subscribe(std::shared_ptr<sdbusplus::asio::connection> conn);
+
+    /**
+     * @brief Whether signals keep the tree current
+     */
+    bool isLive() const
+    {
+        return _live.load();
+    }
+
+    /**
+     * @brief Reload the whole tree from the ObjectMapper, one reload at a
+     *        time
+     */
+    void refresh();
+
+    /**
+     * @brief Replace the tree, @c owners maps the unique names to the well
+     *        known names of the services
+     */
+    void load(FullTreeType tree,
+              std::map<std::string, std::set<std::string>> owners = {});
+
+    /**
+     * @brief Services of @c objectPath implementing any of @c interfaces
+     *        (all services if empty), empty if the object is unknown
+     */
+    ValueType getObject(const std::string& objectPath,
+                        const std::vector<std::string>& interfaces = {});
+
+    /**
+     * @brief Objects under @c subtree (excluded) at most @c depth levels
+     *        deep (0 for any depth) implementing any of @c interfaces
+     */
+    FullTreeType getSubTree(const std::string& subtree, int depth,
+                            const std::vector<std::string>& interfaces = {});
+
+    /**
+     * @brief Paths of @sa getSubTree()
+     */
+    std::vector<std::string>
+        getSubTreePaths(const std::string& subtree, int depth,
+                        const std::vector<std::string>& interfaces = {});
+
+    /**
+     * @brief Sorted paths of the objects whose last path element is one of
+     *        @c names, implementing any of @c interfaces
+     *
+     * Looked up in an index by name, kept along with the tree.
+     */
+    std::vector<std::string>
+        getPathsNamed(const std::vector<std::string>& names,
+                      const std::vector<std::string>& interfaces = {});
+
+    /**
+     * @brief Apply InterfacesAdded sent by the unique name @c sender
+     */
+    void interfacesAdded(const std::string& objectPath,
+                         const std::string& sender,
+                         const std::vector<std::string>& interfaces);
+
+    /**
+     * @brief Apply InterfacesRemoved sent by the unique name @c sender
+     */
+    void interfacesRemoved(const std::string& objectPath,
+                           const std::string& sender,
+                           const std::vector<std::string>& interfaces);
+
+    /**
+     * @brief Apply NameOwnerChanged
+     */
+    void nameOwnerChanged(const std::string& name, const std::string& oldOwner,
+                          const std::string& newOwner);
+
+    /**
+     * @brief Reload on the next query
+     */
+    void markStale();
+
+    ObjectTreeStats stats() const;
+
+    /**
+     * @brief Given one of the values of the tree return the managers
+     *        implementing any of @c interfaces (all if empty)
+     */
+    static ValueType scopeManagers(const ValueType& implementations,
+                                   const std::vector<std::string>& interfaces);
+
+  private:
+    void ensureLoaded();
+    void reload();
+    /** @return true if the service had any object in the tree */
+    bool removeService(const std::string& service);
+    void rebuildIndex();
+    void indexPath(const std::string& objectPath);
+    void unindexPath(const std::string& objectPath);
+    static std::string nameOf(const std::string& objectPath);
+
+    mutable std::shared_mutex _mutex;
+    /** held while reloading, the queries finding the tree stale wait on it
+     *  instead of reloading too */
+    std::mutex _refreshMutex;
+    FullTreeType _tree;
+    /** last path element -> paths */
+    std::unordered_map<std::string, std::set<std::string>> _byName;
+    /** unique name -> well known names */
+    std::map<std::string, std::set<std::string>> _owners;
+    bool _loaded = false;
+    bool _stale = false;
+    /** a reload is fetching the tree, changes to objects not mirrored yet
+     *  may still be part of it */
+    bool _reloading = false;
+    /** bumped by every change to tracked objects or owners, a reload
+     *  racing with one stays stale */
+    size_t _generation = 0;
+    std::atomic<bool> _live{false};
+    std::atomic<size_t> _refreshes{0};
+    std::atomic<size_t> _updates{0};
+    std::atomic<size_t> _queries{0};
+};
+
+} // namespace dbus
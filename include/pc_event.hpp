@@ -12,10 +12,17 @@
 
 #include "data_accessor.hpp"
 
-#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/lockfree/queue.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 struct PcCompare;
 
@@ -23,35 +30,301 @@ struct PcDataType
 {
     data_accessor::DataAccessor accessor;
     std::vector<std::shared_ptr<event_info::EventNode>> eventPtrs;
+    /** when the signal was received, the event deadline counts from it */
+    std::chrono::steady_clock::time_point arrived =
+        std::chrono::steady_clock::now();
 };
 
+/**
+ * @brief What PcQueueType::push() does when the queue is full
+ */
+enum class PcOverflowPolicy
+{
+    dropNewest, // reject the element being pushed (default)
+    dropOldest, // discard the oldest queued element to make room
+    block       // wait for the consumer to free space, up to a timeout
+};
+
+/**
+ * @brief Converts "drop-newest", "drop-oldest" or "block" into the policy
+ *
+ * @throw std::runtime_error for any other string
+ */
+inline PcOverflowPolicy pcOverflowPolicyFromString(const std::string& str)
+{
+    if (str == "drop-newest")
+    {
+        return PcOverflowPolicy::dropNewest;
+    }
+    if (str == "drop-oldest")
+    {
+        return PcOverflowPolicy::dropOldest;
+    }
+    if (str == "block")
+    {
+        return PcOverflowPolicy::block;
+    }
+    throw std::runtime_error("Invalid queue overflow policy '" + str + "'");
+}
+
+/**
+ * @brief Elements lost (or pushes delayed) per overflow policy
+ */
+struct PcQueueStats
+{
+    size_t droppedNewest = 0;
+    size_t droppedOldest = 0;
+    size_t blockTimeouts = 0;
+    size_t blockedPushes = 0;
+};
+
+/**
+ * @class PcQueueType
+ * @brief Bounded multi-producer queue of PropertiesChanged data
+ *
+ *  Pushes and pops are lock-free. The mutex is only taken to block (either
+ *  the consumer in waitForData() or a producer under the block policy) and
+ *  by the other side when it sees someone waiting, so the common path never
+ *  contends on it.
+ */
 class PcQueueType
 {
   public:
-    PcQueueType(size_t queueSize) : _queue(queueSize), _mutex{}
+    PcQueueType(size_t queueSize,
+                PcOverflowPolicy policy = PcOverflowPolicy::dropNewest,
+                std::chrono::milliseconds blockTimeout =
+                    std::chrono::milliseconds(100)) :
+        _queue(queueSize),
+        _capacity(queueSize), _policy(policy), _blockTimeout(blockTimeout)
     {}
 
+    ~PcQueueType()
+    {
+        PcDataType* d = nullptr;
+        while (_queue.pop(d))
+        {
+            delete d;
+        }
+    }
+
+    PcQueueType(const PcQueueType&) = delete;
+    PcQueueType& operator=(const PcQueueType&) = delete;
+
     bool push(PcDataType const& d)
     {
-        std::scoped_lock lock(_mutex);
-        return _queue.push(d);
+        // claim the slot first so a dropped element is never copied
+        if (!reserveSlot())
+        {
+            switch (_policy)
+            {
+                case PcOverflowPolicy::dropNewest:
+                    _droppedNewest++;
+                    return false;
+                case PcOverflowPolicy::dropOldest:
+                    if (!makeRoomDroppingOldest())
+                    {
+                        _droppedNewest++;
+                        return false;
+                    }
+                    break;
+                case PcOverflowPolicy::block:
+                    if (!waitForSpace())
+                    {
+                        _blockTimeouts++;
+                        return false;
+                    }
+                    break;
+            }
+        }
+        std::unique_ptr<PcDataType> elem;
+        try
+        {
+            elem = std::make_unique<PcDataType>(d);
+        }
+        catch (...)
+        {
+            _size--;
+            throw;
+        }
+        if (!_queue.bounded_push(elem.get()))
+        {
+            // cannot happen while _size is honored, keep the count sane anyway
+            _size--;
+            _droppedNewest++;
+            return false;
+        }
+        elem.release();
+        _pushed++;
+        notifyWaiters(_consumerWaiting, _dataAvailable);
+        return true;
     }
 
     bool pop(PcDataType& d)
     {
-        std::scoped_lock lock(_mutex);
-        return _queue.pop(d);
+        PcDataType* elem = nullptr;
+        if (!_queue.pop(elem))
+        {
+            return false;
+        }
+        std::unique_ptr<PcDataType> owner(elem);
+        _pushed--;
+        _size--;
+        notifyWaiters(_producersWaiting, _spaceAvailable);
+        d = std::move(*owner);
+        return true;
     }
 
-    size_t write_available()
+    /**
+     * @brief Pops up to @a maxItems elements appending them to @a out
+     *
+     * @return the number of elements popped
+     */
+    size_t popBatch(std::vector<PcDataType>& out, size_t maxItems)
     {
-        std::scoped_lock lock(_mutex); // TODO: is this necessary?
-        return _queue.write_available();
+        size_t popped = 0;
+        PcDataType d;
+        while (popped < maxItems && pop(d))
+        {
+            out.push_back(std::move(d));
+            popped++;
+        }
+        return popped;
+    }
+
+    /**
+     * @brief Blocks until the queue has data or @a timeout expires
+     *
+     * @return true if there is data to be popped
+     */
+    bool waitForData(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock(_mutex);
+        _consumerWaiting++;
+        bool ready = _dataAvailable.wait_for(
+            lock, timeout, [this]() { return _pushed.load() > 0; });
+        _consumerWaiting--;
+        return ready;
+    }
+
+    size_t write_available() const
+    {
+        size_t size = _size.load();
+        return size < _capacity ? _capacity - size : 0;
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    PcOverflowPolicy policy() const
+    {
+        return _policy;
+    }
+
+    PcQueueStats stats() const
+    {
+        return PcQueueStats{_droppedNewest.load(), _droppedOldest.load(),
+                            _blockTimeouts.load(), _blockedPushes.load()};
     }
 
   private:
-    boost::lockfree::spsc_queue<PcDataType> _queue;
+    /**
+     * @brief Claims one of the @a _capacity slots
+     * @return false if the queue is full
+     */
+    bool reserveSlot()
+    {
+        size_t size = _size.load();
+        while (size < _capacity)
+        {
+            if (_size.compare_exchange_weak(size, size + 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Discards queued elements until a slot can be claimed
+     *
+     *  Slots reserved by producers that have not pushed yet cannot be
+     *  popped, so give up once the queue holds nothing to discard instead
+     *  of spinning until those producers catch up.
+     *
+     * @return false if no slot could be claimed
+     */
+    bool makeRoomDroppingOldest()
+    {
+        PcDataType* oldest = nullptr;
+        for (size_t attempt = 0; attempt < _capacity; attempt++)
+        {
+            if (!_queue.pop(oldest))
+            {
+                // the consumer may have emptied the queue meanwhile
+                return reserveSlot();
+            }
+            delete oldest;
+            _pushed--;
+            _size--;
+            _droppedOldest++;
+            if (reserveSlot())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool waitForSpace()
+    {
+        _blockedPushes++;
+        std::unique_lock lock(_mutex);
+        _producersWaiting++;
+        bool reserved = _spaceAvailable.wait_for(
+            lock, _blockTimeout, [this]() { return reserveSlot(); });
+        _producersWaiting--;
+        return reserved;
+    }
+
+    /**
+     * @brief Wakes up the other side only if it is (about to be) waiting.
+     *  Taking the mutex orders the notification after the waiter's
+     *  predicate check, so the wakeup cannot be lost.
+     */
+    void notifyWaiters(const std::atomic<int>& waiting,
+                       std::condition_variable& cv)
+    {
+        if (waiting.load() > 0)
+        {
+            {
+                std::scoped_lock lock(_mutex);
+            }
+            cv.notify_all();
+        }
+    }
+
+    boost::lockfree::queue<PcDataType*> _queue;
+    const size_t _capacity;
+    const PcOverflowPolicy _policy;
+    const std::chrono::milliseconds _blockTimeout;
+    /** slots claimed by producers, pushed or about to be */
+    std::atomic<size_t> _size{0};
+    /** elements actually in @a _queue, briefly negative when a pop races
+     *  ahead of the increment in push() */
+    std::atomic<std::ptrdiff_t> _pushed{0};
+
     std::mutex _mutex;
+    std::condition_variable _dataAvailable;
+    std::condition_variable _spaceAvailable;
+    std::atomic<int> _consumerWaiting{0};
+    std::atomic<int> _producersWaiting{0};
+
+    std::atomic<size_t> _droppedNewest{0};
+    std::atomic<size_t> _droppedOldest{0};
+    std::atomic<size_t> _blockTimeouts{0};
+    std::atomic<size_t> _blockedPushes{0};
 };
 
 /*
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include "async_reader.hpp"
+#include "property_variant.hpp"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimum number of requested objects under one ObjectManager for
+ * GetManagedObjects to be used instead of a GetAll per object
+ */
+#ifndef SNAPSHOT_MIN_MANAGED_OBJECTS
+#define SNAPSHOT_MIN_MANAGED_OBJECTS 4
+#endif
+
+/**
+ * Minimum share, in percent, of the objects a service exports under an
+ * ObjectManager that have to be requested for GetManagedObjects to be used:
+ * the reply carries all of them, with all their interfaces
+ */
+#ifndef SNAPSHOT_MIN_MANAGED_OBJECTS_PERCENT
+#define SNAPSHOT_MIN_MANAGED_OBJECTS_PERCENT 25
+#endif
+
+namespace dbus
+{
+
+/**
+ * @brief Counters of all the snapshots taken, as seen by
+ *        @c PropertySnapshot::stats()
+ */
+struct SnapshotStats
+{
+    size_t snapshots;
+    size_t managedObjectsCalls;
+    size_t getAllCalls;
+    /** properties asked for */
+    size_t requested;
+    /** properties found in the bulk replies */
+    size_t served;
+
+    /** Properties.Get calls not made, net of the bulk calls */
+    size_t callsAvoided() const
+    {
+        auto calls = managedObjectsCalls + getAllCalls;
+        return served > calls ? served - calls : 0;
+    }
+};
+
+/**
+ * @class PropertySnapshot
+ * @brief Properties of a scan fetched in bulk
+ *
+ *  take() groups the requested properties by service and by object:
+ *
+ *  - objects under an ObjectManager of their service come from one
+ *    GetManagedObjects of that manager, when it covers at least
+ *    @c SNAPSHOT_MIN_MANAGED_OBJECTS requested objects making up at least
+ *    @c SNAPSHOT_MIN_MANAGED_OBJECTS_PERCENT of the objects it returns,
+ *  - the other ones come from one GetAll per object and interface.
+ *
+ *  A bulk call failing leaves its properties out of the snapshot, they are
+ *  read one by one as before.
+ */
+class PropertySnapshot
+{
+  public:
+    /** @brief path -> interface -> property -> value */
+    using ManagedObjects = std::map<
+        std::string,
+        std::map<std::string, std::map<std::string, PropertyVariant>>>;
+
+    /**
+     * @brief Fetch the services and objects of @c requests
+     */
+    static PropertySnapshot take(const std::vector<PropertyRequest>& requests);
+
+    /**
+     * @brief Fetch all the properties of the (object path, interface)
+     *        pairs of @c objects
+     */
+    static PropertySnapshot takeObjects(
+        const std::vector<std::pair<std::string, std::string>>& objects);
+
+    /**
+     * @brief Add the properties of @c interface of @c objectPath
+     */
+    void add(const std::string& objectPath, const std::string& interface,
+             const std::map<std::string, PropertyVariant>& properties);
+
+    /**
+     * @brief Add all the objects of a GetManagedObjects reply
+     */
+    void add(const ManagedObjects& objects);
+
+    std::optional<PropertyVariant> find(const PropertyRequest& request) const;
+
+    /**
+     * @brief One value per request, empty for the ones not in the snapshot
+     */
+    std::vector<PropertyVariant>
+        values(const std::vector<PropertyRequest>& requests) const;
+
+    size_t size() const
+    {
+        return _values.size();
+    }
+
+    const std::map<PropertyRequest, PropertyVariant>& all() const
+    {
+        return _values;
+    }
+
+    static SnapshotStats stats();
+
+    /**
+     * @brief The ObjectManager path of @c managers closest above
+     *        @c objectPath, empty if none
+     */
+    static std::string
+        managerOf(const std::string& objectPath,
+                  const std::vector<std::string>& managers);
+
+    /**
+     * @brief Whether a GetManagedObjects returning @c exported objects is
+     *        worth it for @c requested of them
+     */
+    static bool worthManagedObjects(size_t requested, size_t exported);
+
+  private:
+    std::map<PropertyRequest, PropertyVariant> _values;
+};
+
+} // namespace dbus
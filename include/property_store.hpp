@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include "property_variant.hpp"
+
+#include <boost/container/flat_map.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+/**
+ * Age after which a stored property is read from D-Bus again, in case a
+ * PropertiesChanged got lost or its service restarted; 0 for no limit
+ */
+#ifndef PROPERTY_STORE_MAX_AGE_MS
+#define PROPERTY_STORE_MAX_AGE_MS 30000
+#endif
+
+namespace dbus
+{
+
+/**
+ * @brief One property of @c PropertyStore
+ */
+struct StoredProperty
+{
+    PropertyVariant value;
+    /** incremented by every change of the value */
+    uint64_t version;
+    /** when the value was last received (signal, seed or read) */
+    std::chrono::steady_clock::time_point updated;
+    /** a PropertiesChanged carried it at least once, so the signals keep it
+     *  current */
+    bool signalFed;
+};
+
+/**
+ * @brief Counters of @c PropertyStore, as seen by @c PropertyStore::stats()
+ */
+struct PropertyStoreStats
+{
+    /** reads answered from the store */
+    size_t hits;
+    /** reads of tracked properties not in the store, or never carried by a
+     *  signal */
+    size_t misses;
+    /** reads of tracked properties older than the maximum age */
+    size_t stale;
+    /** values received from PropertiesChanged */
+    size_t updates;
+    size_t size;
+};
+
+/**
+ * @class PropertyStore
+ * @brief In-process mirror of the subscribed D-Bus properties
+ *
+ *  The daemon subscribes to PropertiesChanged for the object and interface
+ *  pairs of the events, track()ed here. The store keeps the values of
+ *  their properties:
+ *
+ *  - seed() fetches them all once in bulk,
+ *  - update() applies every PropertiesChanged received,
+ *  - refresh() keeps what a D-Bus read of a missing or stale property got.
+ *
+ *  find() answers a tracked property received less than
+ *  @c PROPERTY_STORE_MAX_AGE_MS ago, and only once a PropertiesChanged
+ *  carried it: a property which does not emit its changes is only known to
+ *  be current when read, it is read from D-Bus every time. Until something
+ *  is tracked the store holds nothing and every find() misses.
+ */
+class PropertyStore
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static PropertyStore& instance();
+
+    /**
+     * @brief Keep the properties of @c interface of @c objectPath
+     */
+    void track(const std::string& objectPath, const std::string& interface);
+
+    bool isTracked(const std::string& objectPath,
+                   const std::string& interface) const;
+
+    /**
+     * @brief Fetch all the tracked properties, keeping the ones a signal
+     *        updated meanwhile
+     */
+    void seed();
+
+    /**
+     * @brief Apply a PropertiesChanged of @c interface of @c objectPath
+     */
+    void update(const std::string& objectPath, const std::string& interface,
+                const boost::container::flat_map<std::string, PropertyVariant>&
+                    properties);
+
+    /**
+     * @brief Keep @c value read from D-Bus at @c readStart, unless a
+     *        signal updated the property since
+     */
+    void refresh(const std::string& objectPath, const std::string& interface,
+                 const std::string& property, const PropertyVariant& value,
+                 Clock::time_point readStart);
+
+    /**
+     * @brief The fresh stored value of a property
+     */
+    std::optional<StoredProperty> find(const std::string& objectPath,
+                                       const std::string& interface,
+                                       const std::string& property);
+
+    void setMaxAge(std::chrono::milliseconds maxAge);
+
+    PropertyStoreStats stats() const;
+
+    /**
+     * @brief Forget the tracked pairs and the properties, for unit tests
+     */
+    void clear();
+
+  private:
+    PropertyStore() = default;
+
+    /** @brief (object path, interface) */
+    using Object = std::pair<std::string, std::string>;
+    /** @brief (object path, interface, property) */
+    using Key = std::tuple<std::string, std::string, std::string>;
+
+    /**
+     * @brief Set the value, bump the version if it changed, @c signal when
+     *        a PropertiesChanged carried it
+     */
+    void store(const Key& key, const PropertyVariant& value,
+               Clock::time_point when, bool signal);
+
+    mutable std::shared_mutex _mutex;
+    std::set<Object> _tracked;
+    std::map<Key, StoredProperty> _properties;
+    std::chrono::milliseconds _maxAge{PROPERTY_STORE_MAX_AGE_MS};
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+    std::atomic<size_t> _stale{0};
+    std::atomic<size_t> _updates{0};
+};
+
+} // namespace dbus
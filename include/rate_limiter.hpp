@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace dbus
+{
+
+/**
+ * @brief How fast D-Bus calls may go to one service
+ */
+struct RateLimit
+{
+    /** calls per second, 0 for no rate limit */
+    double rate = 0.0;
+    /** calls which may start back to back after an idle time */
+    size_t burst = 1;
+    /** calls waiting for their reply at a time, 0 for no limit */
+    size_t maxConcurrent = 0;
+
+    bool isUnlimited() const
+    {
+        return rate <= 0.0 && maxConcurrent == 0;
+    }
+};
+
+/**
+ * @brief Counters of one service, as seen by @c RateLimiter::stats()
+ */
+struct RateLimiterStats
+{
+    size_t calls;
+    /** calls which had to wait for a token or a free slot */
+    size_t waited;
+    uint64_t waitUs;
+    uint64_t maxWaitUs;
+    /** calls given up because their deadline expired while waiting */
+    size_t timedOut;
+    size_t inFlight;
+};
+
+/**
+ * @class RateLimiter
+ * @brief Token bucket per destination service, with a concurrency limit
+ *
+ *  Every D-Bus method call takes a @c Permit for its destination service
+ *  first. The permit needs a token of the service's bucket, refilled at
+ *  @c RateLimit::rate up to @c RateLimit::burst tokens, and one of its
+ *  @c RateLimit::maxConcurrent slots, given back when the permit is
+ *  destroyed. Calls to different services never wait for each other, so
+ *  a slow service can be throttled without slowing down the others.
+ *
+ *  Services without a limit of their own use the default limit, which is
+ *  no limit at all unless setDefaultLimit() says otherwise.
+ */
+class RateLimiter
+{
+    struct Bucket;
+
+  public:
+    /**
+     * @brief The right to make one call, holds a concurrency slot
+     */
+    class Permit
+    {
+      public:
+        Permit(RateLimiter* limiter, Bucket* bucket) :
+            _limiter(limiter), _bucket(bucket)
+        {}
+
+        Permit(Permit&& other) noexcept :
+            _limiter(other._limiter), _bucket(other._bucket)
+        {
+            other._bucket = nullptr;
+        }
+
+        Permit& operator=(Permit&& other) noexcept;
+
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+        ~Permit();
+
+      private:
+        RateLimiter* _limiter;
+        Bucket* _bucket;
+    };
+
+    static RateLimiter& instance();
+
+    /**
+     * @brief Limit the calls to @c service
+     */
+    void setLimit(const std::string& service, const RateLimit& limit);
+
+    /**
+     * @brief Limit the calls to the services without a limit of their own
+     */
+    void setDefaultLimit(const RateLimit& limit);
+
+    /**
+     * @brief Wait as long as needed for a permit to call @c service
+     */
+    Permit acquire(const std::string& service);
+
+    /**
+     * @brief Wait until @c deadline at most for a permit to call @c service
+     *
+     * @return nothing if the deadline expired first
+     */
+    std::optional<Permit>
+        acquire(const std::string& service,
+                std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Counters per service called so far
+     */
+    std::map<std::string, RateLimiterStats> stats() const;
+
+    /**
+     * @brief Forget all the limits and counters, for unit tests only
+     *
+     *  No permit may be alive.
+     */
+    void clear();
+
+    /**
+     * @brief Parse "<service>=<rate>[:<burst>[:<max concurrent>]]"
+     *
+     *  The service "*" stands for the default limit.
+     *
+     * @throw std::invalid_argument on a malformed @c spec
+     */
+    static std::pair<std::string, RateLimit> parse(const std::string& spec);
+
+  private:
+    struct Bucket
+    {
+        RateLimit limit;
+        /** whether limit comes from setLimit() */
+        bool ownLimit = false;
+        double tokens = 0.0;
+        std::chrono::steady_clock::time_point refilled;
+        size_t inFlight = 0;
+        std::condition_variable changed;
+        RateLimiterStats stats{};
+    };
+
+    RateLimiter() = default;
+
+    Bucket& bucket(const std::string& service);
+    void refill(Bucket& bucket, std::chrono::steady_clock::time_point now);
+    void release(Bucket* bucket);
+
+    mutable std::mutex _mutex;
+    RateLimit _defaultLimit;
+    std::map<std::string, std::unique_ptr<Bucket>> _buckets;
+};
+
+} // namespace dbus
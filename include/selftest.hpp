@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include "async_reader.hpp"
 #include "common.hpp"
 #include "dat_traverse.hpp"
 #include "event_handler.hpp"
@@ -310,6 +311,22 @@ class Selftest : public event_handler::EventHandler
         return dev.getType() == dat_traverse::DeviceType::types::REGULAR;
     }
 
+    /**
+     * @brief The D-Bus properties read by the test points of @c dev, out of
+     *        the layers in @c layersToIgnore
+     */
+    static std::vector<dbus::PropertyRequest>
+        testPointReads(const dat_traverse::Device& dev,
+                       const std::vector<std::string>& layersToIgnore);
+
+    /**
+     * @brief The DeviceGetData calls of the DeviceCoreAPI test points of
+     *        @c dev, out of the layers in @c layersToIgnore
+     */
+    static std::vector<dbus::CoreApiRequest>
+        testPointCoreApiReads(const dat_traverse::Device& dev,
+                              const std::vector<std::string>& layersToIgnore);
+
     /** @brief Internal DAT reference. **/
     const std::map<std::string, dat_traverse::Device>& _dat;
 };
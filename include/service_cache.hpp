@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace dbus
+{
+
+/**
+ * @brief Counters of @c ServiceCache, as seen by @c ServiceCache::stats()
+ */
+struct ServiceCacheStats
+{
+    size_t hits;
+    size_t misses;
+    /** entries removed by NameOwnerChanged, InterfacesAdded/Removed */
+    size_t invalidations;
+    size_t size;
+
+    double hitRatio() const
+    {
+        auto lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+};
+
+/**
+ * @class ServiceCache
+ * @brief (object path, interface) -> service cache of getService()
+ *
+ *  getService() asks the ObjectMapper for every readDbusProperty() and
+ *  setDbusProperty(), though the answer changes only when a service
+ *  restarts or objects come and go. The cache keeps the answers and
+ *  forgets them on the signals telling so, as ObjectTree receives them:
+ *
+ *  - NameOwnerChanged of a service drops every entry of that service,
+ *  - InterfacesAdded/InterfacesRemoved of an object drops its entries.
+ *
+ *  The cache is used only once ObjectTree::subscribe() registered these
+ *  signals, before that (and in tools without an event loop) every lookup
+ *  misses. Only found services are stored, a failed lookup is retried next
+ *  time.
+ */
+class ServiceCache
+{
+  public:
+    using Generation = uint64_t;
+
+    static ServiceCache& instance();
+
+    /**
+     * @brief The cached service of @c objectPath + @c interface
+     */
+    std::optional<std::string> find(const std::string& objectPath,
+                                    const std::string& interface);
+
+    /**
+     * @brief Current invalidation generation, to be passed to insert()
+     *
+     * Taken before asking the ObjectMapper, so an answer which raced with
+     * an invalidation signal is not stored.
+     */
+    Generation generation() const
+    {
+        return _generation.load();
+    }
+
+    /**
+     * @brief Store @c service, unless disabled or invalidated since
+     *        @c generation
+     */
+    void insert(const std::string& objectPath, const std::string& interface,
+                const std::string& service, Generation generation);
+
+    /**
+     * @brief Forget the entries of @c service (well known or unique name)
+     *
+     * A unique name no entry was resolved to, as the ones of the short
+     * lived clients, changes nothing and does not invalidate the answers
+     * being fetched.
+     */
+    void invalidateService(const std::string& service);
+
+    /**
+     * @brief Forget the entries of @c objectPath
+     */
+    void invalidatePath(const std::string& objectPath);
+
+    bool enabled() const
+    {
+        return _enabled.load();
+    }
+
+    /**
+     * @brief Use the cache, once something calls the invalidate methods on
+     *        the signals (ObjectTree::subscribe()), or in unit tests
+     */
+    void setEnabled(bool enabled);
+
+    ServiceCacheStats stats() const;
+
+    void clear();
+
+  private:
+    ServiceCache() = default;
+
+    /** @brief account for an entry of @c service going away */
+    void erased(const std::string& service);
+
+    /** path -> interface -> service */
+    using Entries = std::unordered_map<
+        std::string, std::unordered_map<std::string, std::string>>;
+
+    mutable std::shared_mutex _mutex;
+    Entries _entries;
+    /** service -> entries resolved to it */
+    std::unordered_map<std::string, size_t> _services;
+    size_t _size = 0;
+    std::atomic<bool> _enabled{false};
+    std::atomic<Generation> _generation{0};
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+    std::atomic<size_t> _invalidations{0};
+};
+
+} // namespace dbus
@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * How often the child is checked for exit when the kernel has no pidfd
+ * (before 5.3); with a pidfd the exit wakes the runner up at once
+ */
+#ifndef SUBPROCESS_EXIT_POLL_MS
+#define SUBPROCESS_EXIT_POLL_MS 5
+#endif
+
+/** Time a co-process has to print its handshake line once started */
+#ifndef COPROCESS_START_TIMEOUT_MS
+#define COPROCESS_START_TIMEOUT_MS 2000
+#endif
+
+/** A co-process idle for longer is health checked before its next request */
+#ifndef COPROCESS_IDLE_CHECK_MS
+#define COPROCESS_IDLE_CHECK_MS 30000
+#endif
+
+/** After a failed start, time the executable is run by fork/exec only */
+#ifndef COPROCESS_RETRY_MS
+#define COPROCESS_RETRY_MS 60000
+#endif
+
+/** How long Memo reuses the result of a command line, 0 never */
+#ifndef CMDLINE_MEMO_TTL_MS
+#define CMDLINE_MEMO_TTL_MS 1000
+#endif
+
+namespace subprocess
+{
+
+/**
+ * @brief What a command printed and how it exited
+ */
+struct Result
+{
+    int exitCode;
+    /** stdout, as received */
+    std::string output;
+};
+
+/**
+ * @brief Counters of the runs of one executable, as seen by
+ *        @c Runner::stats()
+ */
+struct ExecutableStats
+{
+    size_t spawns;
+    /** could not be started */
+    size_t failures;
+    /** killed at the timeout */
+    size_t timeouts;
+    /** runs served by the co-process instead of a spawn */
+    size_t coprocessRequests;
+    /** co-process (re)starts */
+    size_t coprocessStarts;
+    /** wakeups of a spawned run with nothing to read, polling for the
+     *  exit without a pidfd */
+    size_t exitPolls;
+    /** from the request to the result, over all the runs */
+    uint64_t totalUs;
+    uint64_t maxUs;
+
+    uint64_t averageUs() const
+    {
+        auto runs = spawns + coprocessRequests;
+        return runs ? totalUs / runs : 0;
+    }
+};
+
+/**
+ * @class Coprocess
+ * @brief A long-lived instance of a wrapper serving runs over pipes
+ *
+ *  The protocol, line based on the wrapper's stdin and stdout:
+ *
+ *  - started as "<executable> -coprocess", the wrapper prints
+ *    "COPROCESS 1" once ready,
+ *  - a request is one line: the arguments of a run, each single-quoted
+ *    for the shell, separated by blanks; runs with an argument holding a
+ *    newline are not sent,
+ *  - the response is the output of the run followed by the record
+ *    separator (0x1e), the exit code and a newline, e.g. printf
+ *    '\036%d\n' $rc; the separator ends the output even if the output
+ *    did not end with a newline,
+ *  - an empty request is a health check, answered by the separator line
+ *    alone.
+ *
+ *  The shell wrappers source tools/wrapper-coprocess.sh for it.
+ *
+ *  A wrapper not printing the handshake in time does not support the
+ *  protocol. A co-process dying, replying garbage or timing out is killed
+ *  and started again on the next request.
+ */
+class Coprocess
+{
+  public:
+    explicit Coprocess(std::string executable) :
+        _executable(std::move(executable))
+    {}
+
+    ~Coprocess();
+
+    Coprocess(const Coprocess&) = delete;
+    Coprocess& operator=(const Coprocess&) = delete;
+
+    enum class Status
+    {
+        served,
+        /** busy with another request, or not running: use fork/exec */
+        unavailable
+    };
+
+    /**
+     * @brief Run the wrapper with @c args on the co-process
+     *
+     * @throw std::runtime_error if the request timed out, the co-process
+     *        is killed
+     */
+    Status request(const std::vector<std::string>& args,
+                   std::chrono::milliseconds timeout, Result& result);
+
+    /** @brief (re)starts so far */
+    size_t starts() const
+    {
+        return _starts.load();
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    bool start();
+    void stop();
+    bool writeLine(const std::string& line);
+    /** false at end of file, on error or at @c until */
+    bool readLine(std::string& line, Clock::time_point until);
+    /** false if the co-process did not answer properly by @c until */
+    bool exchange(const std::string& request, Clock::time_point until,
+                  Result& result);
+
+    std::string _executable;
+    std::mutex _mutex;
+    int _pid = -1;
+    int _stdin = -1;
+    int _stdout = -1;
+    /** read but not yet returned by readLine() */
+    std::string _buffer;
+    Clock::time_point _lastUsed;
+    Clock::time_point _retryAfter;
+    std::atomic<size_t> _starts{0};
+};
+
+/**
+ * @class Runner
+ * @brief Runs the commands of the CMDLINE accessors
+ *
+ *  A command is spawned in a process group of its own, its stdout in a
+ *  non-blocking pipe. One epoll waits on the pipe and on a pidfd of the
+ *  child together:
+ *
+ *  - the output is read as it comes, a chatty child never blocks on a
+ *    full pipe,
+ *  - the exit is seen as soon as it happens, no polling tick,
+ *  - the timeout is the epoll_wait() timeout, at expiry the whole group is
+ *    killed.
+ *
+ *  Once the child exited what is left of its group is killed as well, like
+ *  the daemons a wrapper could leave behind.
+ *
+ *  The executables enableCoprocess()ed are run on their @c Coprocess
+ *  instead, when it is up and not busy with another run; otherwise, and
+ *  for the wrappers not supporting the protocol, by fork/exec as above.
+ */
+class Runner
+{
+  public:
+    static Runner& instance();
+
+    /**
+     * @brief Run @c commandLine, split as a shell would without expanding
+     *        anything, the executable searched in PATH
+     *
+     * @throw std::runtime_error if it could not be started, or was killed
+     *        at @c timeout
+     */
+    Result run(const std::string& commandLine,
+               std::chrono::milliseconds timeout);
+
+    std::map<std::string, ExecutableStats> stats() const;
+
+    /**
+     * @brief Run @c executable on a @c Coprocess when it supports it
+     */
+    void enableCoprocess(const std::string& executable);
+
+    /**
+     * @brief The arguments of @c commandLine: split on blanks, single and
+     *        double quotes group, backslash escapes the next character
+     */
+    static std::vector<std::string> split(const std::string& commandLine);
+
+  private:
+    Runner() = default;
+
+    void record(const std::string& executable,
+                std::chrono::steady_clock::duration elapsed, bool failed,
+                bool timedOut, bool coprocess = false, size_t exitPolls = 0);
+
+    Coprocess* coprocess(const std::string& executable) const;
+
+    mutable std::mutex _mutex;
+    std::map<std::string, ExecutableStats> _stats;
+    std::map<std::string, std::unique_ptr<Coprocess>> _coprocesses;
+};
+
+/**
+ * @brief Counters of @c Memo::run()
+ */
+struct MemoStats
+{
+    /** given to the Runner */
+    size_t runs;
+    /** served by a kept result or by an identical run in progress */
+    size_t hits;
+};
+
+/**
+ * @class Memo
+ * @brief Runs a command line once for all the identical reads of a short
+ *        period, like the devices of one selftest or the events of one burst
+ *
+ *  Results are kept for the TTL after the run returned, keyed by the
+ *  command line as run, so with every range already expanded. A read
+ *  arriving while an identical run is in progress waits for its result
+ *  rather than starting another one. A run that threw is not kept.
+ */
+class Memo
+{
+  public:
+    static Memo& instance();
+
+    /**
+     * @brief Runner::run() @c commandLine, unless it was run less than the
+     *        TTL ago
+     *
+     * @throw std::runtime_error as Runner::run(), or if the identical run in
+     *        progress did not finish within @c timeout
+     */
+    Result run(const std::string& commandLine,
+               std::chrono::milliseconds timeout);
+
+    /** @brief 0 disables the memoization */
+    void setTtl(std::chrono::milliseconds ttl);
+
+    std::chrono::milliseconds ttl() const;
+
+    MemoStats stats() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        std::shared_future<Result> result;
+        /** max() while the run is in progress */
+        Clock::time_point expires;
+    };
+
+    Memo() = default;
+
+    mutable std::mutex _mutex;
+    std::map<std::string, Entry> _entries;
+    std::chrono::milliseconds _ttl{CMDLINE_MEMO_TTL_MS};
+    MemoStats _stats{};
+};
+
+} // namespace subprocess
@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Minimum number of subscribed sibling objects (same parent path, same
+ * interface) replaced by one path_namespace match rule on their parent
+ */
+#ifndef SUBSCRIPTION_MIN_NAMESPACE_GROUP
+#define SUBSCRIPTION_MIN_NAMESPACE_GROUP 2
+#endif
+
+/**
+ * Minimum share (percent) the subscribed siblings have to be of the
+ * parent's descendants implementing the interface to be grouped, the
+ * others' signals would wake the daemon up for nothing
+ */
+#ifndef SUBSCRIPTION_MIN_NAMESPACE_SHARE
+#define SUBSCRIPTION_MIN_NAMESPACE_SHARE 50
+#endif
+
+namespace subscription_plan
+{
+
+/**
+ * @brief One PropertiesChanged match rule to register
+ */
+struct SubscriptionRule
+{
+    /** the object path, or the parent of the grouped objects */
+    std::string path;
+    /** the interface the signal has to carry as arg0 */
+    std::string interface;
+    /** true: match the whole 'path' namespace, false: exactly 'path' */
+    bool isNamespace = false;
+    /** subscribed objects covered by this rule */
+    std::vector<std::string> objects;
+
+    /**
+     * @brief The D-Bus match rule string
+     */
+    std::string matchRule() const;
+};
+
+/**
+ * @class SubscriptionPlan
+ * @brief Groups the PropertiesChanged subscriptions of expanded accessor
+ *        object paths into few match rules
+ *
+ *  Ranged object paths expand to many siblings, eg. ".../GPU_SXM_[1-8]" to
+ *  eight objects under ".../processors". Registering a match rule per
+ *  object:interface puts all of them into dbus-daemon. Instead, siblings
+ *  subscribed with the same interface share one rule with path_namespace
+ *  set to their parent and arg0 to the interface.
+ *
+ *  A namespace rule also delivers the signals of objects nobody subscribed
+ *  (other children of the parent, deeper descendants), so the callback has
+ *  to drop the signals for which wants() is false. Each of them costs a
+ *  wakeup and a parse, so siblings are grouped only when they are a large
+ *  enough share of the parent's descendants with that interface, as
+ *  counted by the @c Descendants function given to plan(). wants()
+ *  counts the signals it drops.
+ */
+class SubscriptionPlan
+{
+  public:
+    /** @brief objects under a parent path (excluded) implementing an
+     *         interface, at any depth */
+    using Descendants =
+        std::function<size_t(const std::string& parent,
+                             const std::string& interface)>;
+
+    /**
+     * @brief Request PropertiesChanged signals of @c interface on
+     *        @c objectPath, duplicates are ignored
+     */
+    void add(const std::string& objectPath, const std::string& interface);
+
+    /**
+     * @brief Compute the rules for everything added so far
+     *
+     * @param minGroupSize siblings needed to use a namespace rule
+     * @param descendants to group only siblings making up at least
+     *        SUBSCRIPTION_MIN_NAMESPACE_SHARE percent of the descendants,
+     *        all groups are made without it
+     */
+    const std::vector<SubscriptionRule>&
+        plan(size_t minGroupSize = SUBSCRIPTION_MIN_NAMESPACE_GROUP,
+             const Descendants& descendants = {});
+
+    const std::vector<SubscriptionRule>& rules() const
+    {
+        return _rules;
+    }
+
+    /**
+     * @brief Whether the signal of @c interface on @c objectPath was
+     *        requested by add(), the unwanted ones are counted
+     */
+    bool wants(std::string_view objectPath, std::string_view interface) const;
+
+    /**
+     * @brief Signals wants() dropped, delivered by a namespace rule for an
+     *        object nobody subscribed
+     */
+    size_t unwanted() const
+    {
+        return _unwanted.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of distinct object:interface pairs added, that is the
+     *        number of rules needed without grouping
+     */
+    size_t subscriptions() const
+    {
+        return _wanted.size();
+    }
+
+    /**
+     * @brief How many match rules the grouping saved
+     */
+    size_t savedRules() const
+    {
+        return subscriptions() - _rules.size();
+    }
+
+    void clear();
+
+  private:
+    static std::string key(std::string_view objectPath,
+                           std::string_view interface);
+
+    /** interface -> parent path -> objects */
+    std::map<std::string, std::map<std::string, std::set<std::string>>>
+        _byParent;
+    std::unordered_set<std::string> _wanted;
+    std::vector<SubscriptionRule> _rules;
+    mutable std::atomic<size_t> _unwanted{0};
+};
+
+} // namespace subscription_plan
@@ -13,12 +13,17 @@
 #include "device_util.hpp"
 #include "log.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <regex>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -66,6 +71,14 @@
 /** @brief Log using @c logs_info macro **/
 #define shortlogs_info(expr) shortlog(expr, logs_info)
 
+/**
+ * @brief Maximum number of distinct regular expressions kept by the
+ * @c util::RegexCache
+ */
+#ifndef REGEX_CACHE_MAX_SIZE
+#define REGEX_CACHE_MAX_SIZE 1024
+#endif
+
 namespace util
 {
 
@@ -82,14 +95,14 @@ struct DeviceIdData
     DeviceIdData() = default;
 
     explicit DeviceIdData(const std::string& deviceType)
-        : pattern{device_id::DeviceIdPattern(deviceType)}
+        : pattern{*device_id::cachedPattern(deviceType)}
     {
         // Empty
     }
 
     explicit DeviceIdData(const std::string& deviceType,
                           const device_id::PatternIndex& idx)
-        : pattern{device_id::DeviceIdPattern(deviceType)}, index(idx)
+        : pattern{*device_id::cachedPattern(deviceType)}, index(idx)
     {
       // Empty
     }
@@ -124,6 +137,103 @@ RangeInformation getRangeInformation(const std::string& str);
 
 void printThreadId(const char* funcName);
 
+/**
+ * @brief Hit/miss counters of a @c RegexCache
+ */
+struct RegexCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::size_t size = 0;
+};
+
+/**
+ * @class RegexCache
+ * @brief Process-wide table of compiled regular expressions, keyed by their
+ *        text
+ *
+ * Compiling a @c std::regex is far more expensive than running it, and the
+ * same expressions from event_info.json are matched on every signal. Works
+ * like @c device_id::PatternCache: shared lock on lookups, exclusive one on
+ * a miss, pre-populated from the profiles at startup, misses past
+ * @c REGEX_CACHE_MAX_SIZE entries compiled but not stored.
+ */
+class RegexCache
+{
+  public:
+    using RegexPtr = std::shared_ptr<const std::regex>;
+
+    explicit RegexCache(std::size_t maxSize = REGEX_CACHE_MAX_SIZE) :
+        _maxSize(maxSize)
+    {}
+
+    RegexCache(const RegexCache&) = delete;
+    RegexCache& operator=(const RegexCache&) = delete;
+
+    /**
+     * @brief The cache shared by the whole process
+     */
+    static RegexCache& instance();
+
+    /**
+     * @brief Return the compiled @c regex, compiling it on a miss
+     *
+     * Throws std::regex_error as the std::regex constructor. Invalid
+     * expressions are never stored.
+     */
+    RegexPtr get(const std::string& regex);
+
+    /**
+     * @brief Compile and store @c regex without counting a lookup
+     *
+     * @return false if @c regex is not a valid regular expression
+     */
+    bool preload(const std::string& regex);
+
+    RegexCacheStats stats() const;
+
+    void clear();
+
+  private:
+    RegexPtr insert(const std::string& regex);
+
+    const std::size_t _maxSize;
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<std::string, RegexPtr> _regexes;
+    std::atomic<uint64_t> _hits{0};
+    std::atomic<uint64_t> _misses{0};
+};
+
+/**
+ * @brief Shorthand for 'RegexCache::instance().get(regex)'
+ */
+inline RegexCache::RegexPtr cachedRegex(const std::string& regex)
+{
+    return RegexCache::instance().get(regex);
+}
+
+/**
+ * @brief The last range specification of @c str, as in "[1-8]" or "[]":
+ *        '[', digits, dashes, digits, ']'
+ *
+ *  What a regex_search of ".*(\\[[0-9]*\\-*[0-9]*\\]).*" matches, without
+ *  the regex.
+ *
+ * @return an empty string if there is none
+ */
+std::string lastRangeSpecification(const std::string& str);
+
+/**
+ * @brief The digit ending a device name such as "GPU2", or the one before
+ *        its last "<digit>-" as in "GPU5-ERoT"
+ *
+ *  What a regex_search of ".*([0-9]+)$|.*([0-9]+)\\-.*" matches, without the
+ *  regex.
+ *
+ * @return an empty string if there is none
+ */
+std::string deviceRangeDigit(const std::string& str);
+
 /**
  * @brief  performs std::regex_search(str, rgx)
  *
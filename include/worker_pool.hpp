@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Maximum number of event handling tasks waiting for a free worker
+ */
+#ifndef WORKER_POOL_QUEUE_SIZE
+#define WORKER_POOL_QUEUE_SIZE 64
+#endif
+
+/**
+ * How long submit() waits for space in a full queue before rejecting a task
+ */
+#ifndef WORKER_POOL_SUBMIT_TIMEOUT_MS
+#define WORKER_POOL_SUBMIT_TIMEOUT_MS 1000
+#endif
+
+/**
+ * @brief Snapshot of the @c WorkerPool counters
+ */
+struct WorkerPoolStats
+{
+    size_t workers = 0;
+    /** tasks waiting for a worker right now */
+    size_t queueDepth = 0;
+    /** highest queueDepth seen */
+    size_t maxQueueDepth = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    /** tasks refused because the queue stayed full or the pool stopped */
+    uint64_t rejected = 0;
+    /** tasks a worker took from another worker's queue */
+    uint64_t stolen = 0;
+    /** time the completed tasks spent queued, in microseconds */
+    uint64_t totalWaitUs = 0;
+    uint64_t maxWaitUs = 0;
+    /** lanes with a task running or queued */
+    size_t lanes = 0;
+    /** tasks waiting behind an earlier task of their lane */
+    size_t laneQueueDepth = 0;
+};
+
+/**
+ * @class WorkerPool
+ * @brief Fixed set of persistent threads running event handling tasks
+ *
+ *  Every worker owns a task queue. Tasks submitted from outside the pool
+ *  are spread over the queues round-robin, tasks submitted by a worker go
+ *  to its own queue. A worker takes tasks from the front of its queue and,
+ *  when it runs dry, steals from the back of the others.
+ *
+ *  The number of queued tasks is bounded: submit() waits up to the submit
+ *  timeout for a slot and then rejects the task, counting it and logging an
+ *  error, instead of parking a thread per task.
+ *
+ *  Tasks submitted with a lane key (eg. the device name) run one at a time
+ *  and in submission order within the lane, different lanes run in
+ *  parallel. Only the head task of a lane sits in the worker queues, the
+ *  worker running it continues with the rest of the lane; the tasks queued
+ *  behind it are bounded by the same capacity.
+ *
+ *  shutdown() stops accepting tasks, lets the workers finish the queued ones
+ *  (or drops them) and joins the threads. The destructor drains.
+ */
+class WorkerPool
+{
+  public:
+    using Task = std::function<void()>;
+
+    WorkerPool(size_t workers, size_t queueCapacity,
+               std::chrono::milliseconds submitTimeout =
+                   std::chrono::milliseconds(WORKER_POOL_SUBMIT_TIMEOUT_MS));
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * @brief Queue @c task for execution by one of the workers
+     *
+     * @return false if the task was rejected (queue full for longer than the
+     *         submit timeout, or the pool is shut down)
+     */
+    bool submit(Task task);
+
+    /**
+     * @brief Queue @c task in the lane @c key
+     *
+     * The task starts only after all the tasks submitted earlier to the same
+     * lane have finished.
+     *
+     * @return false if the task was rejected, as for submit(Task)
+     */
+    bool submit(const std::string& key, Task task);
+
+    /**
+     * @brief Stop accepting tasks and join the workers
+     *
+     * @param drain run the tasks already queued before stopping, otherwise
+     *        drop them (they are counted as rejected)
+     */
+    void shutdown(bool drain = true);
+
+    WorkerPoolStats stats() const;
+
+    size_t workers() const
+    {
+        return _threads.size();
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+  private:
+    struct Item
+    {
+        Task task;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Item> items;
+    };
+
+    void workerLoop(size_t id);
+
+    /**
+     * @brief Take a task from the worker's own queue, else steal one
+     *
+     * Called after the worker claimed one of the pending tasks, so some
+     * queue is guaranteed to hold it.
+     */
+    Item take(size_t id);
+
+    void run(Item& item);
+
+    /**
+     * @brief Run @c task and then the tasks queued in its lane until the
+     *        lane is empty
+     */
+    void runLane(const std::string& key, Task& task);
+
+    void runTask(Task& task);
+
+    struct Lane
+    {
+        bool running = false;
+        std::deque<Task> tasks;
+    };
+
+    const size_t _capacity;
+    const std::chrono::milliseconds _submitTimeout;
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::vector<std::thread> _threads;
+
+    /** guards _pending and _stopping, pairs with the condition variables */
+    mutable std::mutex _mutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _spaceAvailable;
+    /** queued tasks not yet claimed by a worker */
+    size_t _pending = 0;
+    bool _stopping = false;
+
+    std::atomic<size_t> _nextQueue{0};
+
+    /** guards _lanes and _laneQueued */
+    mutable std::mutex _laneMutex;
+    std::condition_variable _laneSpaceAvailable;
+    std::unordered_map<std::string, Lane> _lanes;
+    size_t _laneQueued = 0;
+
+    size_t _maxQueueDepth = 0;
+    std::atomic<uint64_t> _submitted{0};
+    std::atomic<uint64_t> _completed{0};
+    std::atomic<uint64_t> _rejected{0};
+    std::atomic<uint64_t> _stolen{0};
+    std::atomic<uint64_t> _totalWaitUs{0};
+    std::atomic<uint64_t> _maxWaitUs{0};
+};
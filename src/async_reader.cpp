@@ -0,0 +1,396 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "async_reader.hpp"
+
+#include "dbus_accessor.hpp"
+#include "deadline.hpp"
+#include "log.hpp"
+#include "property_snapshot.hpp"
+#include "rate_limiter.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <algorithm>
+
+namespace dbus
+{
+
+namespace
+{
+
+/** the replies of one fanOut() call, outlives it if replies come late */
+template <typename Value>
+struct Batch
+{
+    std::mutex mutex;
+    std::condition_variable allDone;
+    std::vector<std::optional<Value>> values;
+    size_t pending = 0;
+};
+
+thread_local PrefetchScope* innermostScope = nullptr;
+
+} // namespace
+
+AsyncReader& AsyncReader::instance()
+{
+    static AsyncReader reader;
+    return reader;
+}
+
+void AsyncReader::setConnection(
+    std::shared_ptr<sdbusplus::asio::connection> conn, size_t maxInFlight)
+{
+    std::lock_guard lock(_mutex);
+    _conn = std::move(conn);
+    _ioThread = std::this_thread::get_id();
+    _maxInFlight = std::max<size_t>(maxInFlight, 1);
+}
+
+bool AsyncReader::acquireSlot(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock lock(_mutex);
+    if (!_slotFree.wait_until(lock, deadline,
+                              [this]() { return _inFlight < _maxInFlight; }))
+    {
+        return false;
+    }
+    _inFlight++;
+    _stats.issued++;
+    _stats.maxInFlight = std::max(_stats.maxInFlight, _inFlight);
+    return true;
+}
+
+void AsyncReader::releaseSlot()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _inFlight--;
+    }
+    _slotFree.notify_one();
+}
+
+std::shared_ptr<sdbusplus::asio::connection>
+    AsyncReader::asyncConnection() const
+{
+    std::lock_guard lock(_mutex);
+    if (_ioThread == std::this_thread::get_id())
+    {
+        return nullptr;
+    }
+    return _conn;
+}
+
+template <typename Value, typename Call>
+std::vector<std::optional<Value>>
+    AsyncReader::fanOut(std::shared_ptr<sdbusplus::asio::connection> conn,
+                        const std::vector<std::string>& services,
+                        std::chrono::milliseconds deadline, Call call)
+{
+    auto until = std::chrono::steady_clock::now() + deadline;
+    // not past the deadline of the event being handled
+    if (auto at = DeadlineScope::current().at())
+    {
+        until = std::min(until, *at);
+    }
+    auto batch = std::make_shared<Batch<Value>>();
+    batch->values.resize(services.size());
+
+    size_t i = 0;
+    for (; i < services.size(); ++i)
+    {
+        const auto& service = services[i];
+        if (service.empty())
+        {
+            std::lock_guard lock(_mutex);
+            _stats.failed++;
+            continue;
+        }
+        auto permit = RateLimiter::instance().acquire(service, until);
+        if (!permit)
+        {
+            break;
+        }
+        if (!acquireSlot(until))
+        {
+            break;
+        }
+        // given back with the reply
+        auto held = std::make_shared<RateLimiter::Permit>(std::move(*permit));
+        auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+            until - std::chrono::steady_clock::now());
+        {
+            std::lock_guard lock(batch->mutex);
+            batch->pending++;
+        }
+        auto reply = [this, batch, i,
+                      held](std::optional<Value> value) mutable {
+            held.reset();
+            releaseSlot();
+            {
+                std::lock_guard lock(_mutex);
+                value ? _stats.completed++ : _stats.failed++;
+            }
+            std::lock_guard lock(batch->mutex);
+            batch->values[i] = std::move(value);
+            batch->pending--;
+            batch->allDone.notify_all();
+        };
+        boost::asio::post(conn->get_io_context(),
+                          [conn, call, i, service, left, reply]() mutable {
+            call(*conn, i, service,
+                 static_cast<uint64_t>(std::max<int64_t>(left.count(), 1)),
+                 std::move(reply));
+        });
+    }
+
+    std::unique_lock lock(batch->mutex);
+    batch->allDone.wait_until(lock, until,
+                              [&batch]() { return batch->pending == 0; });
+    // not issued (no slot in time) plus issued without a reply
+    size_t timedOut = services.size() - i + batch->pending;
+    auto values = batch->values;
+    lock.unlock();
+    if (timedOut > 0)
+    {
+        std::lock_guard statsLock(_mutex);
+        _stats.timedOut += timedOut;
+        logs_wrn("%zu of %zu D-Bus reads timed out\n", timedOut,
+                 services.size());
+    }
+    return values;
+}
+
+std::vector<PropertyVariant>
+    AsyncReader::readAll(const std::vector<PropertyRequest>& requests,
+                         std::chrono::milliseconds deadline)
+{
+    std::vector<PropertyVariant> values;
+    auto conn = asyncConnection();
+    if (!conn)
+    {
+        for (const auto& request : requests)
+        {
+            values.push_back(readDbusProperty(
+                request.objectPath, request.interface, request.property));
+        }
+        return values;
+    }
+
+    std::vector<std::string> services;
+    for (const auto& request : requests)
+    {
+        // answered by the service cache most of the time
+        services.push_back(getService(request.objectPath, request.interface));
+    }
+    // the calls may be sent after this returns
+    auto shared = std::make_shared<std::vector<PropertyRequest>>(requests);
+    auto replies = fanOut<PropertyVariant>(
+        conn, services, deadline,
+        [shared](sdbusplus::asio::connection& conn, size_t i,
+                 const std::string& service, uint64_t timeoutUs,
+                 auto reply) {
+        const auto& request = (*shared)[i];
+        conn.async_method_call_timed(
+            [reply](const boost::system::error_code& ec,
+                    const PropertyVariant& value) mutable {
+            reply(ec ? std::nullopt : std::optional<PropertyVariant>(value));
+        },
+            service, request.objectPath, freeDesktopInterface, getCall,
+            timeoutUs, request.interface, request.property);
+    });
+    for (auto& reply : replies)
+    {
+        values.push_back(reply.value_or(PropertyVariant{}));
+    }
+    return values;
+}
+
+std::vector<std::optional<RetCoreApi>>
+    AsyncReader::readCoreApi(const std::vector<CoreApiRequest>& requests,
+                             std::chrono::milliseconds deadline)
+{
+    auto conn = asyncConnection();
+    if (!conn)
+    {
+        std::vector<std::optional<RetCoreApi>> values;
+        for (const auto& request : requests)
+        {
+            values.push_back(deviceGetCoreAPI(request.devId, request.property));
+        }
+        return values;
+    }
+
+    std::vector<std::string> services(requests.size(), gpuMgrService);
+    auto shared = std::make_shared<std::vector<CoreApiRequest>>(requests);
+    return fanOut<RetCoreApi>(
+        conn, services, deadline,
+        [shared](sdbusplus::asio::connection& conn, size_t i,
+                 const std::string& service, uint64_t timeoutUs,
+                 auto reply) {
+        const auto& request = (*shared)[i];
+        conn.async_method_call_timed(
+            [reply, request](const boost::system::error_code& ec,
+                             const DeviceGetDataReply& response) mutable {
+            if (ec)
+            {
+                reply(std::nullopt);
+                return;
+            }
+            reply(coreApiResult(request.devId, request.property, response));
+        },
+            service, gpuMgrObject, gpuMgrInterface, deviceGetDataCall,
+            timeoutUs, request.devId, request.property, deviceGetDataMode);
+    });
+}
+
+AsyncReadStats AsyncReader::stats() const
+{
+    std::lock_guard lock(_mutex);
+    return _stats;
+}
+
+PrefetchScope::PrefetchScope(const std::vector<PropertyRequest>& requests,
+                             Mode mode, std::chrono::milliseconds deadline) :
+    _outer(innermostScope)
+{
+    std::vector<PropertyRequest> missing;
+    for (const auto& request : requests)
+    {
+        if (!find(request.objectPath, request.interface, request.property))
+        {
+            missing.push_back(request);
+        }
+    }
+    if (mode == Mode::bulk && !missing.empty())
+    {
+        auto snapshot = PropertySnapshot::take(missing);
+        fill(missing, snapshot.values(missing));
+        std::erase_if(missing, [this](const PropertyRequest& request) {
+            return _values.count(request) != 0;
+        });
+    }
+    if (!missing.empty())
+    {
+        fill(missing, AsyncReader::instance().readAll(missing, deadline));
+    }
+    innermostScope = this;
+}
+
+PrefetchScope::PrefetchScope(const std::vector<PropertyRequest>& requests,
+                             const std::vector<PropertyVariant>& values) :
+    _outer(innermostScope)
+{
+    fill(requests, values);
+    innermostScope = this;
+}
+
+PrefetchScope::PrefetchScope(const std::vector<CoreApiRequest>& requests,
+                             std::chrono::milliseconds deadline) :
+    _outer(innermostScope)
+{
+    std::vector<CoreApiRequest> missing;
+    for (const auto& request : requests)
+    {
+        if (!findCoreApi(request.devId, request.property))
+        {
+            missing.push_back(request);
+        }
+    }
+    if (!missing.empty())
+    {
+        fill(missing, AsyncReader::instance().readCoreApi(missing, deadline));
+    }
+    innermostScope = this;
+}
+
+PrefetchScope::PrefetchScope(
+    const std::vector<CoreApiRequest>& requests,
+    const std::vector<std::optional<RetCoreApi>>& values) :
+    _outer(innermostScope)
+{
+    fill(requests, values);
+    innermostScope = this;
+}
+
+PrefetchScope::~PrefetchScope()
+{
+    innermostScope = _outer;
+}
+
+void PrefetchScope::fill(const std::vector<PropertyRequest>& requests,
+                         const std::vector<PropertyVariant>& values)
+{
+    for (size_t i = 0; i < requests.size() && i < values.size(); ++i)
+    {
+        // failed reads are left to the synchronous path and its logging
+        if (isValidVariant(values[i]))
+        {
+            _values.emplace(requests[i], values[i]);
+        }
+    }
+}
+
+void PrefetchScope::fill(const std::vector<CoreApiRequest>& requests,
+                         const std::vector<std::optional<RetCoreApi>>& values)
+{
+    for (size_t i = 0; i < requests.size() && i < values.size(); ++i)
+    {
+        // bad return codes are left to the synchronous path as well
+        if (values[i] && std::get<int>(*values[i]) == 0)
+        {
+            _coreApi.emplace(requests[i], *values[i]);
+        }
+    }
+}
+
+std::optional<PropertyVariant>
+    PrefetchScope::find(const std::string& objectPath,
+                        const std::string& interface,
+                        const std::string& property)
+{
+    if (innermostScope == nullptr)
+    {
+        return std::nullopt;
+    }
+    PropertyRequest key{objectPath, interface, property};
+    for (auto* scope = innermostScope; scope != nullptr; scope = scope->_outer)
+    {
+        auto it = scope->_values.find(key);
+        if (it != scope->_values.end())
+        {
+            return it->second;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<RetCoreApi>
+    PrefetchScope::findCoreApi(int devId, const std::string& property)
+{
+    if (innermostScope == nullptr)
+    {
+        return std::nullopt;
+    }
+    CoreApiRequest key{devId, property};
+    for (auto* scope = innermostScope; scope != nullptr; scope = scope->_outer)
+    {
+        auto it = scope->_coreApi.find(key);
+        if (it != scope->_coreApi.end())
+        {
+            return it->second;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace dbus
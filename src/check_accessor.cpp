@@ -10,6 +10,8 @@
 
 #include "check_accessor.hpp"
 
+#include "async_reader.hpp"
+
 namespace data_accessor
 {
 
@@ -66,6 +68,21 @@ bool CheckAccessor::loopDevices(const DeviceIndexesList& deviceIndexes,
                                 DataAccessor& dataAcc)
 {
     bool ret = false;
+    // all the devices in one round of concurrent DeviceGetData calls
+    std::vector<dbus::CoreApiRequest> requests;
+    if (jsonAcc.isTypeDeviceCoreApi())
+    {
+        for (auto& index : deviceIndexes)
+        {
+            auto request = dataAcc.coreApiReadRequest(
+                this->_devIdData.pattern.eval(index));
+            if (request)
+            {
+                requests.push_back(*request);
+            }
+        }
+    }
+    dbus::PrefetchScope prefetched(requests);
     for (auto& index : deviceIndexes)
     {
         auto deviceName = this->_devIdData.pattern.eval(index);
@@ -94,21 +111,21 @@ bool CheckAccessor::check(const DataAccessor& jsonAcc, // template Accessor
             auto triggerAccessorObj = dataAcc.getDbusObjectPath();
             if (!templateAccessorObj.empty() && !triggerAccessorObj.empty())
             {
-                device_id::DeviceIdPattern jsonObjPattern(templateAccessorObj);
-                _devIdData.index =
-                 util::determineDeviceIndex(jsonObjPattern, triggerAccessorObj);
+                auto jsonObjPattern =
+                    device_id::cachedPattern(templateAccessorObj);
+                _devIdData.index = util::determineDeviceIndex(
+                    *jsonObjPattern, triggerAccessorObj);
             }
         }
     }
     else if (jsonAcc.isTypeCmdline())
     {
-        device_id::DeviceIdPattern jsonArgPattern(jsonAcc.getArguments());
-        device_id::DeviceIdPattern dataArgPattern(dataAcc.getArguments());
-        if (util::existsRange(jsonArgPattern) &&
-            false == util::existsRange(dataArgPattern))
+        auto jsonArgPattern = device_id::cachedPattern(jsonAcc.getArguments());
+        if (util::existsRange(*jsonArgPattern) &&
+            false == util::existsRange(dataAcc.getArguments()))
         {
             _devIdData.index = util::determineDeviceIndex(
-                              jsonArgPattern, dataAcc.getArguments());
+                              *jsonArgPattern, dataAcc.getArguments());
             if (dataAcc.hasData())
             {
                 auto device = util::determineDeviceName(_devIdData.pattern,
@@ -281,7 +298,7 @@ bool CheckAccessor::subCheck(const DataAccessor& jsonAcc, DataAccessor& dataAcc,
         return false; // without data nothing to do
     }
     bool ret = false;
-    auto checkMap = jsonAcc[checkKey].get<CheckDefinitionMap>();
+    const auto& checkMap = jsonAcc.getCheckMap();
     /**
      * special logic for bitmap
      * --------------------------
@@ -292,8 +309,7 @@ bool CheckAccessor::subCheck(const DataAccessor& jsonAcc, DataAccessor& dataAcc,
     if (jsonAcc.existsCheckBitmap() == true)
     {
         PropertyValue bitmapValue;
-        auto jsonBitmapValue = jsonAcc[checkKey][bitmapKey].get<std::string>();
-        bitmapValue = PropertyValue(jsonBitmapValue);
+        bitmapValue = PropertyValue(checkMap.at(bitmapKey));
         if (bitmapValue.isValidInteger() == true)
         {
             auto devRange = _devIdData.pattern.domainVec();
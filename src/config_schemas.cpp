@@ -69,6 +69,7 @@ std::shared_ptr<json_schema::JsonSchema> dataAccessorSchema()
                properties(literal(false), property("type", values("CMDLINE")),
                           property("executable", types(json::value_t::string)),
                           property("arguments", types(json::value_t::string)),
+                          property("invocation", values("range")),
                           property("check", checkerSchema),
                           property("name", types(json::value_t::string))));
     auto directAccessorProperties =
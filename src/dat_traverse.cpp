@@ -640,7 +640,7 @@ std::vector<std::tuple<std::string, std::string, std::string>>
 
     using namespace sdbusplus;
     std::variant<PropertyType> dbusResult;
-    auto theBus = bus::new_default_system();
+    auto theBus = dbus::connection(dbus::BusType::systemBus);
     try
     {
         dbus::DelayedMethod method(theBus, manager, devicePath,
@@ -652,6 +652,7 @@ std::vector<std::tuple<std::string, std::string, std::string>>
     }
     catch (const sdbusplus::exception::exception& e)
     {
+        dbus::ConnectionPool::instance().failed(e, dbus::BusType::systemBus);
         logs_err(" Dbus Error: %s\n", e.what());
         throw std::runtime_error(e.what());
     }
@@ -682,7 +683,7 @@ void dbusSetDeviceAssociations(
 {
     using namespace sdbusplus;
     using namespace std;
-    auto theBus = bus::new_default_system();
+    auto theBus = dbus::connection(dbus::BusType::systemBus);
     try
     {
         dbus::DelayedMethod method(theBus, manager, devicePath,
@@ -695,6 +696,7 @@ void dbusSetDeviceAssociations(
     }
     catch (const sdbusplus::exception::exception& e)
     {
+        dbus::ConnectionPool::instance().failed(e, dbus::BusType::systemBus);
         logs_err(" Dbus Error: %s\n", e.what());
         throw std::runtime_error(e.what());
     }
@@ -12,16 +12,151 @@
 
 #include "event_info.hpp"
 #include "log.hpp"
+#include "property_store.hpp"
+#include "deadline.hpp"
+#include "subprocess.hpp"
 
-#include <boost/process.hpp>
-
+#include <algorithm>
+#include <chrono>
 #include <regex>
+#include <sstream>
 #include <string>
 #include <vector>
 
 namespace data_accessor
 {
 
+/**
+ * @brief returns _acc[key] as a string if it exists and is a string,
+ *        otherwise an empty string
+ */
+static std::string stringField(const nlohmann::json& acc, const char* key)
+{
+    auto it = acc.find(key);
+    if (it != acc.end() && it->is_string())
+    {
+        return it->get<std::string>();
+    }
+    return std::string{""};
+}
+
+/**
+ * @brief the time a CMDLINE command has, not past the deadline of the event
+ *        being handled
+ */
+static std::chrono::milliseconds commandLineTimeout()
+{
+    auto timeout = std::chrono::milliseconds(SUBPROCESS_RUNNING_TIMEOUT_MS);
+    if (auto at = dbus::DeadlineScope::current().at())
+    {
+        timeout = std::clamp(std::chrono::ceil<std::chrono::milliseconds>(
+                                 *at - std::chrono::steady_clock::now()),
+                             std::chrono::milliseconds(1), timeout);
+    }
+    return timeout;
+}
+
+static AccessorType accessorTypeFromString(const std::string& type)
+{
+    static const std::map<std::string, AccessorType> types = {
+        {"DBUS", AccessorType::dbus},
+        {"DeviceCoreAPI", AccessorType::deviceCoreApi},
+        {"DEVICE", AccessorType::device},
+        {"CMDLINE", AccessorType::cmdline},
+        {"CONSTANT", AccessorType::constant},
+        {"DIRECT", AccessorType::direct},
+        {"TEST", AccessorType::test}};
+    auto it = types.find(type);
+    return it != types.end() ? it->second : AccessorType::other;
+}
+
+void DataAccessor::parse()
+{
+    _type = AccessorType::none;
+    _typeName.clear();
+    _object.clear();
+    _interface.clear();
+    _property.clear();
+    _executable.clear();
+    _arguments.clear();
+    _validDbus = false;
+    _validCoreApi = false;
+    _deviceIdRange = true;
+    _rangeInvocation = false;
+    _hasCheck = false;
+    _checkMapValid = true;
+    _checkMap.clear();
+    _fields.clear();
+
+    if (_acc.is_object() && isValid(_acc))
+    {
+        const auto& type = _acc[typeKey];
+        _typeName = type.is_string() ? type.get<std::string>() : type.dump();
+        _type = accessorTypeFromString(_typeName);
+
+        _validDbus = _type == AccessorType::dbus && _acc.count(objectKey) &&
+                     _acc.count(interfaceKey) && _acc.count(propertyKey);
+        if (_validDbus)
+        {
+            _object = stringField(_acc, objectKey);
+            _interface = stringField(_acc, interfaceKey);
+        }
+        _property = stringField(_acc, propertyKey);
+        _validCoreApi =
+            _type == AccessorType::deviceCoreApi && _acc.count(propertyKey);
+        if (_type == AccessorType::cmdline)
+        {
+            _arguments = stringField(_acc, argumentsKey);
+            _rangeInvocation = stringField(_acc, invocationKey) == "range";
+        }
+        _deviceIdRange =
+            _acc.count(deviceidKey) == 0 || _acc[deviceidKey] == "range";
+        // json objects iterate in key order, _fields comes out sorted
+        for (const auto& [key, val] : _acc.items())
+        {
+            if (key == nameKey || key == checkKey || key == deviceidKey)
+            {
+                continue;
+            }
+            _fields.emplace_back(key, val.is_string()
+                                          ? val.get<std::string>()
+                                          : val.dump());
+        }
+    }
+    if (_acc.is_object())
+    {
+        _executable = stringField(_acc, executableKey);
+        _hasCheck = _acc.count(checkKey) != 0;
+    }
+    if (_hasCheck)
+    {
+        try
+        {
+            _checkMap = _acc[checkKey].get<CheckDefinitionMap>();
+        }
+        catch (const std::exception&)
+        {
+            // getCheckMap() will report it if the check is ever evaluated
+            _checkMapValid = false;
+        }
+    }
+
+    std::string key = _typeName;
+    if (_validDbus)
+    {
+        key += _interface + _property;
+    }
+    else if (_type == AccessorType::cmdline)
+    {
+        key += _executable;
+    }
+    else if (_type == AccessorType::deviceCoreApi)
+    {
+        key += _property;
+    }
+    _hash = std::hash<std::string>{}(key);
+}
+
 bool DataAccessor::contains(const DataAccessor& other) const
 {
     bool ret = isValid(other._acc);
@@ -40,8 +175,8 @@ bool DataAccessor::contains(const DataAccessor& other) const
             // this may have
             auto regex_string = _acc[key].get<std::string>();
             auto val_string = val.get<std::string>();
-            const std::regex reg_value{regex_string};
-            auto values_match = std::regex_match(val_string, reg_value);
+            auto reg_value = util::cachedRegex(regex_string);
+            auto values_match = std::regex_match(val_string, *reg_value);
             if (values_match == false)
             {
                 ss.str(std::string()); // Clearing the stream first
@@ -76,6 +211,49 @@ InterfaceObjectsMap DataAccessor::getDbusInterfaceObjectsMap() const
     return ret;
 }
 
+std::optional<dbus::PropertyRequest> DataAccessor::dbusReadRequest(
+    const device_id::PatternIndex* devIndex) const
+{
+    if (isValidDbusAccessor() == false)
+    {
+        return std::nullopt;
+    }
+    std::string objPath = _object;
+    if (util::existsRange(objPath) == true)
+    {
+        if (devIndex == nullptr)
+        {
+            return std::nullopt;
+        }
+        // apply the device into the "object" to replace the range
+        objPath = util::introduceDeviceInObjectpath(objPath, *devIndex);
+        if (util::existsRange(objPath) == true)
+        {
+            return std::nullopt;
+        }
+    }
+    return dbus::PropertyRequest{objPath, _interface, _property};
+}
+
+std::optional<dbus::CoreApiRequest>
+    DataAccessor::coreApiReadRequest(const std::string& device) const
+{
+    if (isValidDeviceCoreApiAccessor() == false)
+    {
+        return std::nullopt;
+    }
+    auto deviceId = util::getMappedDeviceId(device);
+    if (deviceId == util::InvalidDeviceId)
+    {
+        deviceId = util::getDeviceId(device);
+    }
+    if (deviceId == util::InvalidDeviceId)
+    {
+        return std::nullopt;
+    }
+    return dbus::CoreApiRequest{deviceId, _property};
+}
+
 bool DataAccessor::readDbus(const device_id::PatternIndex* devIndex)
 {
     log_elapsed();
@@ -89,15 +267,22 @@ bool DataAccessor::readDbus(const device_id::PatternIndex* devIndex)
          *     2. object path with range specification
          * readDbusProperty() forwards an exception when receives it from Dbus
          */
-        std::string objPath = _acc[objectKey].get<std::string>();
+        std::string objPath = _object;
         if (util::existsRange(objPath) == true && devIndex != nullptr)
         {
             // apply the device into the "object" to replace the range
             objPath =
                 util::introduceDeviceInObjectpath(objPath, *devIndex);
         }
-        auto propVariant = dbus::readDbusProperty(
-            objPath, _acc[interfaceKey], _acc[propertyKey]);
+        auto& store = dbus::PropertyStore::instance();
+        if (auto stored = store.find(objPath, _interface, _property))
+        {
+            return setDataValueFromVariant(stored->value);
+        }
+        auto readStart = dbus::PropertyStore::Clock::now();
+        auto propVariant =
+            dbus::readDbusProperty(objPath, _interface, _property);
+        store.refresh(objPath, _interface, _property, propVariant, readStart);
         // setDataValueFromVariant returns false in case variant is invalid
         ret = setDataValueFromVariant(propVariant);
     }
@@ -115,16 +300,30 @@ bool DataAccessor::runCommandLine(const device_id::PatternIndex* devIndex)
         if (_acc.count(argumentsKey) != 0)
         {
             auto args = getArguments();
+            if (devIndex != nullptr && _rangeInvocation)
+            {
+                try
+                {
+                    if (auto value = rangeCommandLineValue(*devIndex))
+                    {
+                        _dataValue = PropertyValue(*value);
+                        return true;
+                    }
+                }
+                catch (const std::exception& error)
+                {
+                    // one by one would not do better
+                    log_err("Error running the command for the range '%s' "
+                            "%s\n",
+                            args.c_str(), error.what());
+                    return false;
+                }
+            }
             if (devIndex != nullptr)
             {
                 // if args does not have range, it does nothing
                 args = util::introduceDeviceInObjectpath(args, *devIndex);
             }
-            else // expand the range inside args
-            {
-                // TODO: "before A[0-3] after" => "before A0 A1 A2 A3 after"
-                // args = expandRangeFromString(args);
-            }
             cmd += ' ' + args;
         }
         std::stringstream ss;
@@ -132,44 +331,10 @@ bool DataAccessor::runCommandLine(const device_id::PatternIndex* devIndex)
         uint64_t processExitCode = 0;
         try
         {
-            std::string line{""};
             log_elapsed("running cmd: %s", cmd.c_str());
-            boost::process::ipstream pipe_stream;
-            boost::process::group g;
-            boost::process::child process(cmd, g, boost::process::std_out > pipe_stream);
-            int waits_remaining = (SUBPROCESS_RUNNING_TIMEOUT_MS / SUBPROCESS_RUNNING_POLL_MS);
-            while (process.running() && waits_remaining > 0)
-            {
-                //std::cerr << "process still running, " << waits_remaining << " waits remaining" << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(SUBPROCESS_RUNNING_POLL_MS));
-                waits_remaining--;
-            }
-            std::error_code ec;
-            if (process.running())
-            {
-                log_err("process still running, going to terminate group\n");
-                // terminate process and any subprocesses it launched as well
-                g.terminate(ec);
-                // prevent direct child becoming zombie (grandchildren are reparented
-                // to init which reaps them)
-                process.wait();
-                if (ec && ec.value() != ESRCH)
-                {
-                    throw std::runtime_error("error terminating subprocess group: " + ec.message());
-                }
-                throw std::runtime_error("child process timed out and was terminated!");
-            }
-            // store main process's exit code now, before cleanup
-            process.wait();
-            // make sure children (if any) are cleaned up once the main process exits
-            // since these are indirect children, they will be reparented to init
-            // which reaps them.
-            g.terminate(ec);
-            if (ec && ec.value() != ESRCH)
-            {
-                throw std::runtime_error("error terminating subprocess group: " + ec.message());
-            }
-            processExitCode = static_cast<uint64_t>(process.exit_code());
+            auto process =
+                subprocess::Memo::instance().run(cmd, commandLineTimeout());
+            processExitCode = static_cast<uint64_t>(process.exitCode);
             log_dbg("returnCode=%llu cmd='%s'\n", processExitCode, cmd.c_str());
             if (processExitCode != 0)
             {
@@ -181,8 +346,10 @@ bool DataAccessor::runCommandLine(const device_id::PatternIndex* devIndex)
                 log_err("%s\n", ss.str().c_str());
                 return ret;
             }
-            while (pipe_stream && std::getline(pipe_stream, line) &&
-                   line.empty() == false)
+            // the lines up to the first empty one, joined
+            std::istringstream output(process.output);
+            std::string line{""};
+            while (std::getline(output, line) && line.empty() == false)
             {
                 result += line;
             }
@@ -204,6 +371,80 @@ bool DataAccessor::runCommandLine(const device_id::PatternIndex* devIndex)
     return ret;
 }
 
+std::optional<std::string>
+    DataAccessor::rangeCommandLineValue(const device_id::PatternIndex& devIndex)
+{
+    auto pattern = device_id::cachedPattern(_arguments);
+    if (pattern->dim() == 0)
+    {
+        return std::nullopt;
+    }
+    auto domain = pattern->domainVec();
+    auto position = std::find(domain.begin(), domain.end(), devIndex);
+    if (position == domain.end())
+    {
+        return std::nullopt;
+    }
+
+    // "before A[0-3] after" => "before A0 A1 A2 A3 after"
+    auto cmd = getExecutable();
+    std::istringstream args(_arguments);
+    std::string arg;
+    while (args >> arg)
+    {
+        auto argPattern = device_id::cachedPattern(arg);
+        if (argPattern->dim() == 0)
+        {
+            cmd += ' ' + arg;
+            continue;
+        }
+        if (argPattern->dim() != pattern->dim())
+        {
+            return std::nullopt;
+        }
+        for (const auto& index : domain)
+        {
+            cmd += ' ' + argPattern->eval(index);
+        }
+    }
+
+    log_elapsed("running range cmd: %s", cmd.c_str());
+    auto process = subprocess::Memo::instance().run(cmd, commandLineTimeout());
+    if (process.exitCode != 0)
+    {
+        log_err("Error running the command '%s' return code = %d, reading the "
+                "devices one by one\n",
+                cmd.c_str(), process.exitCode);
+        return std::nullopt;
+    }
+    std::vector<std::string> values;
+    std::istringstream output(process.output);
+    std::string line{""};
+    std::optional<std::string> value;
+    while (std::getline(output, line))
+    {
+        if (line.empty())
+        {
+            values.push_back(value.value_or(""));
+            value.reset();
+            continue;
+        }
+        value = value.value_or("") + line;
+    }
+    if (value)
+    {
+        values.push_back(*value);
+    }
+    if (values.size() != domain.size())
+    {
+        log_err("Command '%s' printed %zu values for %zu devices, reading the "
+                "devices one by one\n",
+                cmd.c_str(), values.size(), domain.size());
+        return std::nullopt;
+    }
+    return values[static_cast<size_t>(position - domain.begin())];
+}
+
 bool DataAccessor::setDataValueFromVariant(const PropertyVariant& propVariant)
 {
     clearData();
@@ -229,7 +470,7 @@ bool DataAccessor::readDeviceCoreApi(const std::string& device)
             deviceId = util::getDeviceId(device);
         }
         log_elapsed("deviceId=%d api='%s'", deviceId, device.c_str());
-        auto tuple = dbus::deviceGetCoreAPI(deviceId, _acc[propertyKey]);
+        auto tuple = dbus::deviceGetCoreAPI(deviceId, _property);
         auto rc = std::get<int>(tuple);
         if (rc != 0)
         {
@@ -319,10 +560,10 @@ std::vector<DataAccessor> DataAccessor::expand() const
                                                  data_accessor::argumentsKey;
         std::string jValue = expansionType == 1 ? this->getDbusObjectPath() :
                                                   this->getArguments();
-        device_id::DeviceIdPattern pattern(jValue);
-        for (auto& domainItemIndex : pattern.domainVec())
+        auto pattern = device_id::cachedPattern(jValue);
+        for (auto& domainItemIndex : pattern->domainVec())
         {
-            json[jKey] = pattern.eval(domainItemIndex);           
+            json[jKey] = pattern->eval(domainItemIndex);           
             accessorList.push_back(DataAccessor(json, this->getDataValue()));         
         }
     }
@@ -10,18 +10,22 @@
 
 #include "dbus_accessor.hpp"
 
+#include "async_reader.hpp"
+#include "deadline.hpp"
 #include "log.hpp"
+#include "rate_limiter.hpp"
+#include "service_cache.hpp"
 #include "util.hpp"
 
 #include <boost/algorithm/string.hpp>
 #include <phosphor-logging/elog.hpp>
 #include <sdbusplus/exception.hpp>
 
+#include <cerrno>
+
 namespace dbus
 {
 
-DbusDelayerConstLowerBound defaultDbusDelayer;
-
 using namespace phosphor::logging;
 
 static std::string errorMsg(const std::string& description,
@@ -71,13 +75,20 @@ std::string getService(const std::string& objectPath,
     }
 #endif
 
+    auto& cache = ServiceCache::instance();
+    if (auto cached = cache.find(objectPath, interface))
+    {
+        return *cached;
+    }
+    auto generation = cache.generation();
+
     std::string ret{""};
     std::vector<std::pair<std::string, std::vector<std::string>>> response;
-    auto bus = sdbusplus::bus::new_default();
+    auto bus = connection();
     try
     {
-        DelayedMethod method(&defaultDbusDelayer, bus, mapperBusBame,
-                             mapperObjectPath, mapperInterface, "GetObject");
+        DelayedMethod method(bus, mapperBusBame, mapperObjectPath,
+                             mapperInterface, "GetObject");
         method.append(std::string(objectPath));
         method.append(std::vector<std::string>({interface}));
         auto reply = method.call();
@@ -86,6 +97,7 @@ std::string getService(const std::string& objectPath,
         if (response.empty() == false)
         {
             ret = response.begin()->first;
+            cache.insert(objectPath, interface, ret, generation);
         }
         else
         {
@@ -96,6 +108,7 @@ std::string getService(const std::string& objectPath,
     }
     catch (const sdbusplus::exception::exception& e)
     {
+        ConnectionPool::instance().failed(e);
         std::string tmp = errorMsg("getService(): DBus error for", objectPath,
                                    interface, e.what());
         logs_err("%s\n", tmp.c_str());
@@ -103,39 +116,11 @@ std::string getService(const std::string& objectPath,
     return ret;
 }
 
-RetCoreApi deviceGetCoreAPI(const int devId, const std::string& property)
+RetCoreApi coreApiResult(const int devId, const std::string& property,
+                         const DeviceGetDataReply& response)
 {
-    log_elapsed();
-    constexpr auto service = "xyz.openbmc_project.GpuMgr";
-    constexpr auto object = "/xyz/openbmc_project/GpuMgr";
-    constexpr auto interface = "xyz.openbmc_project.GpuMgr.Server";
-    constexpr auto callName = "DeviceGetData";
-    constexpr auto accMode = 1; // Calling in Passthrough Mode. Blocked call.
-
     uint64_t value = 0;
     std::string valueStr = "";
-    std::tuple<int, std::string, std::vector<uint32_t>> response;
-    auto bus = sdbusplus::bus::new_default();
-    try
-    {
-        DelayedMethod method(&defaultDbusDelayer, bus, service, object,
-                             interface, callName);
-        method.append(devId);
-        method.append(property);
-        method.append(accMode);
-        auto reply = method.call();
-        reply.read(response);
-    }
-    catch (const sdbusplus::exception::SdBusError& e)
-    {
-        std::string tmp =
-            errorMsg("deviceGetCoreAPI(): DBus error for", std::string{""},
-                     std::string{""}, property, e.what());
-        logs_err("%s\n", tmp.c_str());
-
-        return std::make_tuple(-1, valueStr, value);
-    }
-
     // response example:
     // (isau) 0 "Baseboard GPU over temperature info : 0001" 2 1 0
     auto rc = std::get<int>(response);
@@ -164,21 +149,51 @@ RetCoreApi deviceGetCoreAPI(const int devId, const std::string& property)
     return std::make_tuple(rc, valueStr, value);
 }
 
+RetCoreApi deviceGetCoreAPI(const int devId, const std::string& property)
+{
+    log_elapsed();
+    if (auto prefetched = PrefetchScope::findCoreApi(devId, property))
+    {
+        return *prefetched;
+    }
+
+    DeviceGetDataReply response;
+    auto bus = connection();
+    try
+    {
+        DelayedMethod method(bus, gpuMgrService, gpuMgrObject, gpuMgrInterface,
+                             deviceGetDataCall);
+        method.append(devId);
+        method.append(property);
+        method.append(deviceGetDataMode);
+        auto reply = method.call();
+        reply.read(response);
+    }
+    catch (const sdbusplus::exception::SdBusError& e)
+    {
+        ConnectionPool::instance().failed(e);
+        std::string tmp =
+            errorMsg("deviceGetCoreAPI(): DBus error for", std::string{""},
+                     std::string{""}, property, e.what());
+        logs_err("%s\n", tmp.c_str());
+
+        return std::make_tuple(-1, std::string{""}, uint64_t(0));
+    }
+    return coreApiResult(devId, property, response);
+}
+
 int deviceClearCoreAPI(const int devId, const std::string& property)
 {
     log_elapsed();
-    constexpr auto service = "xyz.openbmc_project.GpuMgr";
-    constexpr auto object = "/xyz/openbmc_project/GpuMgr";
-    constexpr auto interface = "xyz.openbmc_project.GpuMgr.Server";
     constexpr auto callName = "DeviceClearData";
 
     int rc = -1;
     std::string dbusError{""};
-    auto bus = sdbusplus::bus::new_default();
+    auto bus = connection();
     try
     {
-        DelayedMethod method(&defaultDbusDelayer, bus, service, object,
-                             interface, callName);
+        DelayedMethod method(bus, gpuMgrService, gpuMgrObject,
+                             gpuMgrInterface, callName);
         method.append(devId);
         method.append(property);
         auto reply = method.call();
@@ -186,6 +201,7 @@ int deviceClearCoreAPI(const int devId, const std::string& property)
     }
     catch (const sdbusplus::exception::SdBusError& error)
     {
+        ConnectionPool::instance().failed(error);
         if (rc == 0)
         {
             rc = -1; // just in case reply.read() failed but set rc = 0
@@ -219,6 +235,10 @@ PropertyVariant readDbusProperty(const std::string& objPath,
         logs_err("%s\n", tmp.c_str());
         return value;
     }
+    if (auto prefetched = PrefetchScope::find(objPath, interface, property))
+    {
+        return *prefetched;
+    }
 
     auto service = getService(objPath, interface);
     if (service.empty() == true)
@@ -226,11 +246,11 @@ PropertyVariant readDbusProperty(const std::string& objPath,
         // getService() already printed error message
         return value;
     }
-    auto bus = sdbusplus::bus::new_default();
+    auto bus = connection();
     try
     {
-        DelayedMethod method(&defaultDbusDelayer, bus, service.c_str(),
-                             objPath.c_str(), freeDesktopInterface, getCall);
+        DelayedMethod method(bus, service.c_str(), objPath.c_str(),
+                             freeDesktopInterface, getCall);
         method.append(interface);
         method.append(property);
         auto reply = method.call();
@@ -243,6 +263,7 @@ PropertyVariant readDbusProperty(const std::string& objPath,
     }
     catch (const sdbusplus::exception::exception& e)
     {
+        ConnectionPool::instance().failed(e);
         std::string tmp = errorMsg("readDbusProperty() Failed to get property",
                                    objPath, interface, property, e.what());
         logs_err("%s\n", tmp.c_str());
@@ -283,6 +304,26 @@ DbusPropertyChangedHandler registerServicePropertyChanged(
     return propertyHandler;
 }
 
+DbusPropertyChangedHandler registerMatchRule(DbusAsioConnection conn,
+                                             const std::string& matchRule,
+                                             CallbackFunction callback)
+{
+    DbusPropertyChangedHandler propertyHandler;
+    try
+    {
+        logs_dbg("subscribeStr: %s\n", matchRule.c_str());
+        propertyHandler = std::make_unique<sdbusplus::bus::match_t>(
+            static_cast<sdbusplus::bus::bus&>(*conn), matchRule, callback);
+    }
+    catch (const sdbusplus::exception::SdBusError& e)
+    {
+        logs_err("registerMatchRule(): Error rule: %s, %s\n",
+                 matchRule.c_str(), e.what());
+        throw std::runtime_error(e.what());
+    }
+    return propertyHandler;
+}
+
 bool setDbusProperty(const std::string& objPath, const std::string& interface,
                      const std::string& property, const PropertyVariant& val)
 {
@@ -295,12 +336,12 @@ bool setDbusProperty(const std::string& service, const std::string& objPath,
                      const PropertyVariant& val)
 {
     log_elapsed();
-    auto bus = sdbusplus::bus::new_default();
+    auto bus = connection();
     bool ret = false;
     try
     {
-        DelayedMethod method(&defaultDbusDelayer, bus, service.c_str(),
-                             objPath.c_str(), freeDesktopInterface, setCall);
+        DelayedMethod method(bus, service.c_str(), objPath.c_str(),
+                             freeDesktopInterface, setCall);
         method.append(interface);
         method.append(property);
         method.append(val);
@@ -313,6 +354,7 @@ bool setDbusProperty(const std::string& service, const std::string& objPath,
     }
     catch (const sdbusplus::exception::exception& e)
     {
+        ConnectionPool::instance().failed(e);
         std::string tmp = errorMsg("setDbusProperty() Failed to set property",
                                    objPath, interface, property, e.what());
         logs_err("%s\n", tmp.c_str());
@@ -323,224 +365,42 @@ bool setDbusProperty(const std::string& service, const std::string& objPath,
 // CachingObjectMapper ////////////////////////////////////////////////////////
 
 CachingObjectMapper::ValueType CachingObjectMapper::getObjectImpl(
-    [[maybe_unused]] sdbusplus::bus::bus& bus, const std::string& objectPath,
+    [[maybe_unused]] const BusPtr& bus, const std::string& objectPath,
     const std::vector<std::string>& interfaces)
 {
-    ensureIsInitialized();
-    return scopeManagers(objectsServicesMapping.at(objectPath), interfaces);
+    return tree->getObject(objectPath, interfaces);
 }
 
 std::vector<std::string> CachingObjectMapper::getSubTreePathsImpl(
-    [[maybe_unused]] sdbusplus::bus::bus& bus, const std::string& subtree,
+    [[maybe_unused]] const BusPtr& bus, const std::string& subtree,
     int depth, const std::vector<std::string>& interfaces)
 {
-    ensureIsInitialized();
-    if (depth == 0 && subtree == "/")
-    {
-        return getSubTreePathsImpl(bus, interfaces);
-    }
-    else
-    {
-        throw std::runtime_error(
-            "CachingObjectMapper::getSubTreePathsImpl not implemented"
-            "for depth != and subtree != '/'");
-    }
+    return tree->getSubTreePaths(subtree, depth, interfaces);
 }
 
 std::vector<std::string> CachingObjectMapper::getSubTreePathsImpl(
-    [[maybe_unused]] sdbusplus::bus::bus& bus,
-    const std::vector<std::string>& interfaces)
-{
-    ensureIsInitialized();
-    std::vector<std::string> result;
-    for (const auto& keyValPair : objectsServicesMapping)
-    {
-        if (scopeManagers(keyValPair.second, interfaces).size() != 0)
-        {
-            result.push_back(keyValPair.first);
-        }
-    }
-    return result;
-}
-
-void CachingObjectMapper::refresh()
-{
-    this->objectsServicesMapping = DirectObjectMapper().getSubtreeImpl(
-        this->bus, "/", 0, std::vector<std::string>({}));
-    this->isInitialized = true;
-}
-
-CachingObjectMapper::ValueType CachingObjectMapper::scopeManagers(
-    const ValueType& implementations,
+    [[maybe_unused]] const BusPtr& bus,
     const std::vector<std::string>& interfaces)
 {
-    CachingObjectMapper::ValueType result;
-    for (const auto& keyValPair : implementations)
-    {
-        const auto& intfs = keyValPair.second;
-        bool implementsAny = true;
-        // Yes, the original xyz.openbmc_project.ObjectMapper's logic of the
-        // object paths scoping based on a list of interfaces is whether a
-        // particular path implements any of them, not all
-        for (std::vector<std::string>::const_iterator it = interfaces.cbegin();
-             it != interfaces.cend() && implementsAny; ++it)
-        {
-            implementsAny =
-                std::find(intfs.cbegin(), intfs.cend(), *it) != intfs.cend();
-        }
-        if (implementsAny)
-        {
-            result[keyValPair.first] = intfs;
-        }
-    }
-    return result;
-}
-
-void CachingObjectMapper::ensureIsInitialized()
-{
-    if (!this->isInitialized)
-    {
-        this->refresh();
-    }
-}
-
-// DbusDelayer ////////////////////////////////////////////////////////////////
-
-const char* DbusDelayer::stateToStr(State state)
-{
-    static std::map<State, const char*> stateToNameMap(
-        {{State::idle, "idle"},
-         {State::waiting, "waiting"},
-         {State::calling, "calling"}});
-    return stateToNameMap.at(state);
-}
-
-std::string timeToStringMsec(
-    const std::chrono::time_point<std::chrono::steady_clock>& time)
-{
-    std::stringstream ss;
-    ss << std::chrono::duration_cast<std::chrono::milliseconds>(
-              time.time_since_epoch())
-              .count();
-    return ss.str();
-}
-
-std::chrono::milliseconds
-    DbusDelayer::callStartAttempt(const std::string& signature)
-{
-    if (this->state == State::idle)
-    {
-        auto now = std::chrono::steady_clock::now();
-        std::chrono::milliseconds waitTime =
-            this->callStartAttemptImpl(signature, now);
-        this->state = State::waiting;
-        return waitTime;
-    }
-    else // ! this->state == State::idle
-    {
-        log_dbg("Function called on object in an incorrect state (%s). "
-                "Expected state: %s. Ignoring the call.\n",
-                stateToStr(this->state), stateToStr(State::idle));
-        return std::chrono::milliseconds(0);
-    }
-}
-
-void DbusDelayer::callStartActual(const std::string& signature)
-{
-    if (this->state == State::waiting)
-    {
-        auto now = std::chrono::steady_clock::now();
-        this->callStartActualImpl(signature, now);
-        this->state = State::calling;
-    }
-    else // ! this->state == State::waiting
-    {
-        log_dbg("Function called on object in an incorrect state (%s). "
-                "Expected state: %s. Ignoring the call.\n",
-                stateToStr(this->state), stateToStr(State::waiting));
-    }
-}
-
-void DbusDelayer::callFinished(const std::string& signature)
-{
-    if (this->state == State::calling)
-    {
-        auto now = std::chrono::steady_clock::now();
-        this->callFinishedImpl(signature, now);
-        this->state = State::idle;
-    }
-    else // ! this->state == State::calling
-    {
-        log_dbg("Function called on object in an incorrect state (%s). "
-                "Expected state: %s. Ignoring the call.\n",
-                stateToStr(this->state), stateToStr(State::calling));
-    }
-}
-
-std::chrono::milliseconds DbusDelayer::callStartAttemptImpl(
-    [[maybe_unused]] const std::string& signature,
-    [[maybe_unused]] const std::chrono::time_point<std::chrono::steady_clock>&
-        now)
-{
-    return std::chrono::milliseconds(0);
+    return tree->getSubTreePaths("/", 0, interfaces);
 }
 
-void DbusDelayer::callStartActualImpl(
-    [[maybe_unused]] const std::string& signature,
-    [[maybe_unused]] const std::chrono::time_point<std::chrono::steady_clock>&
-        now)
-{}
-
-void DbusDelayer::callFinishedImpl(
-    [[maybe_unused]] const std::string& signature,
-    [[maybe_unused]] const std::chrono::time_point<std::chrono::steady_clock>&
-        now)
-{}
-
-// DbusDelayerConstLowerBound /////////////////////////////////////////////////
-
-void DbusDelayerConstLowerBound::setDelayTime(
-    const std::chrono::milliseconds& waitTimeLowerBound)
-{
-    _waitTimeLowerBound = waitTimeLowerBound;
-}
-
-void DbusDelayerConstLowerBound::callFinishedImpl(
-    [[maybe_unused]] const std::string& signature,
-    const std::chrono::time_point<std::chrono::steady_clock>& now)
-{
-    _lastCallFinish = now;
-}
-
-std::chrono::milliseconds DbusDelayerConstLowerBound::callStartAttemptImpl(
-    [[maybe_unused]] const std::string& signature,
-    [[maybe_unused]] const std::chrono::time_point<std::chrono::steady_clock>&
-        now)
+CachingObjectMapper::FullTreeType CachingObjectMapper::getSubtreeImpl(
+    [[maybe_unused]] const BusPtr& bus, const std::string& subtree,
+    int depth, const std::vector<std::string>& interfaces)
 {
-    return std::max(_waitTimeLowerBound -
-                        std::chrono::duration_cast<std::chrono::milliseconds>(
-                            now - _lastCallFinish),
-                    std::chrono::milliseconds(0));
+    return tree->getSubTree(subtree, depth, interfaces);
 }
 
-// DbusDelayerStateGuard //////////////////////////////////////////////////////
-
-DbusDelayerStateGuard::~DbusDelayerStateGuard()
+void CachingObjectMapper::refresh()
 {
-    if (_dbusDelayer->getState() == DbusDelayer::State::waiting)
-    {
-        _dbusDelayer->callStartActual(_repr);
-    }
-    if (_dbusDelayer->getState() == DbusDelayer::State::calling)
-    {
-        _dbusDelayer->callFinished(_repr);
-    }
+    tree->refresh();
 }
 
 // DirectObjectMapper /////////////////////////////////////////////////////////
 
 DirectObjectMapper::ValueType DirectObjectMapper::getObjectImpl(
-    sdbusplus::bus::bus& bus, const std::string& objectPath,
+    const BusPtr& bus, const std::string& objectPath,
     const std::vector<std::string>& interfaces) const
 {
     ValueType result;
@@ -555,7 +415,7 @@ DirectObjectMapper::ValueType DirectObjectMapper::getObjectImpl(
 }
 
 std::vector<std::string> DirectObjectMapper::getSubTreePathsImpl(
-    sdbusplus::bus::bus& bus, const std::string& subtree, int depth,
+    const BusPtr& bus, const std::string& subtree, int depth,
     const std::vector<std::string>& interfaces) const
 {
 
@@ -572,7 +432,7 @@ std::vector<std::string> DirectObjectMapper::getSubTreePathsImpl(
 }
 
 DirectObjectMapper::FullTreeType DirectObjectMapper::getSubtreeImpl(
-    sdbusplus::bus::bus& bus, const std::string& subtree, int depth,
+    const BusPtr& bus, const std::string& subtree, int depth,
     const std::vector<std::string>& interfaces) const
 {
     FullTreeType result;
@@ -592,34 +452,40 @@ DirectObjectMapper::FullTreeType DirectObjectMapper::getSubtreeImpl(
 sdbusplus::message::message
     DelayedMethod::call(std::optional<sdbusplus::SdBusDuration> timeout)
 {
-    const std::lock_guard<std::mutex> lock(_dbusDelayer->mutex);
-    // 'ddsg' makes sure that '_dbusDelayer' is always left in
-    // the 'State::idle' state after leving this function, even
-    // if exception occurs in dbus read
-    DbusDelayerStateGuard ddsg(_dbusDelayer, _repr);
-    if (_dbusDelayer->getState() == DbusDelayer::State::idle)
-    {
-        auto waitTime = _dbusDelayer->callStartAttempt(_repr);
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = DeadlineScope::current();
+    std::optional<RateLimiter::Permit> permit;
+    if (auto at = deadline.at())
+    {
+        permit = RateLimiter::instance().acquire(_service, *at);
+    }
+    else
+    {
+        permit.emplace(RateLimiter::instance().acquire(_service));
+    }
+    if (!permit || deadline.expired())
+    {
+        DeadlineScope::countExpired();
+        log_dbg("Deadline passed before dbus call '%s'\n", _repr.c_str());
+        throw sdbusplus::exception::SdBusError(
+            ETIMEDOUT, ("Deadline passed before " + _repr).c_str());
+    }
+    log_dbg("Delayed for %lld us dbus call '%s'\n",
+            (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count(),
+            _repr.c_str());
+    try
+    {
+        return _bus->call(_method, deadline.timeout(timeout));
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        if (e.get_errno() == ETIMEDOUT)
         {
-            std::stringstream ss;
-            ss << "Delayed for " << waitTime.count() << " ms dbus call '"
-               << _repr << "'" << std::endl;
-            log_dbg("%s", ss.str().c_str());
+            DeadlineScope::countTimedOut();
         }
-        std::this_thread::sleep_for(waitTime);
-        _dbusDelayer->callStartActual(_repr);
-        auto reply = _bus.call(_method, timeout);
-        _dbusDelayer->callFinished(_repr);
-        return reply;
-    }
-    else // ! _dbusDelayer->getState() == DbusDelayer::State::idle
-    {
-        log_err("_dbusDelayer object expected to be in '%s' state. "
-                "(actual state: '%s'). "
-                "Falling back to regular, non-delayed dbus call.\n",
-                DbusDelayer::stateToStr(DbusDelayer::State::idle),
-                DbusDelayer::stateToStr(_dbusDelayer->getState()));
-        return _bus.call(_method, timeout);
+        throw;
     }
 }
 
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dbus_connection.hpp"
+
+#include "log.hpp"
+
+#include <cerrno>
+
+namespace dbus
+{
+
+ConnectionPool& ConnectionPool::instance()
+{
+    static ConnectionPool pool;
+    return pool;
+}
+
+ConnectionPool::ThreadConnections::~ThreadConnections()
+{
+    for (size_t i = 0; i < buses.size(); ++i)
+    {
+        if (buses[i] && !stale[i])
+        {
+            pool->_open--;
+        }
+    }
+}
+
+ConnectionPool::ThreadConnections& ConnectionPool::threadConnections()
+{
+    thread_local ThreadConnections connections;
+    return connections;
+}
+
+BusPtr ConnectionPool::get(BusType type)
+{
+    auto& connections = threadConnections();
+    connections.pool = this;
+    auto i = static_cast<size_t>(type);
+    auto& bus = connections.buses[i];
+    if (bus && !connections.stale[i])
+    {
+        _reused++;
+        return bus;
+    }
+    // a stale connection is only released here, callers may still use it
+    bus = std::make_shared<sdbusplus::bus::bus>(
+        type == BusType::systemBus ? sdbusplus::bus::new_default_system()
+                                   : sdbusplus::bus::new_default());
+    connections.stale[i] = false;
+    _opened++;
+    _open++;
+    return bus;
+}
+
+void ConnectionPool::drop(BusType type)
+{
+    auto& connections = threadConnections();
+    auto i = static_cast<size_t>(type);
+    if (connections.buses[i] && !connections.stale[i])
+    {
+        connections.stale[i] = true;
+        _dropped++;
+        _open--;
+    }
+}
+
+bool ConnectionPool::failed(const sdbusplus::exception::exception& e,
+                            BusType type)
+{
+    if (!isConnectionError(e.get_errno()))
+    {
+        return false;
+    }
+    logs_wrn("D-Bus connection error '%s', reconnecting\n", e.what());
+    drop(type);
+    return true;
+}
+
+bool ConnectionPool::isConnectionError(int error)
+{
+    switch (error)
+    {
+        case ECONNRESET:
+        case ECONNREFUSED:
+        case ECONNABORTED:
+        case ENOTCONN:
+        case EPIPE:
+        case ESHUTDOWN:
+        case EBADF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+ConnectionStats ConnectionPool::stats() const
+{
+    return ConnectionStats{_opened.load(), _reused.load(), _dropped.load(),
+                           _open.load()};
+}
+
+} // namespace dbus
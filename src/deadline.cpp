@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "deadline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace dbus
+{
+
+namespace
+{
+
+std::atomic<int64_t> eventBudgetMs{EVENT_DEADLINE_MS};
+
+std::array<std::atomic<size_t>, stageCount> expiredCalls{};
+std::array<std::atomic<size_t>, stageCount> timedOutCalls{};
+
+thread_local Deadline currentDeadline;
+thread_local Stage currentStage = Stage::none;
+
+} // namespace
+
+const char* stageName(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::none:
+            return "none";
+        case Stage::detection:
+            return "detection";
+        case Stage::handlers:
+            return "handlers";
+        case Stage::telemetry:
+            return "telemetry";
+        case Stage::logging:
+            return "logging";
+    }
+    return "unknown";
+}
+
+// Deadline ///////////////////////////////////////////////////////////////////
+
+Deadline Deadline::after(std::chrono::milliseconds budget,
+                         Clock::time_point start)
+{
+    return Deadline(start + budget);
+}
+
+Deadline Deadline::forEvent(Clock::time_point arrived)
+{
+    auto budget = eventBudget();
+    if (budget.count() <= 0)
+    {
+        return Deadline();
+    }
+    return after(budget, arrived);
+}
+
+void Deadline::setEventBudget(std::chrono::milliseconds budget)
+{
+    eventBudgetMs = budget.count();
+}
+
+std::chrono::milliseconds Deadline::eventBudget()
+{
+    return std::chrono::milliseconds(eventBudgetMs.load());
+}
+
+bool Deadline::expired() const
+{
+    return _at && Clock::now() >= *_at;
+}
+
+std::optional<sdbusplus::SdBusDuration>
+    Deadline::timeout(std::optional<sdbusplus::SdBusDuration> timeout) const
+{
+    if (!_at)
+    {
+        return timeout;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+        *_at - Clock::now());
+    // 0 would mean the default timeout to sd-bus
+    sdbusplus::SdBusDuration remaining(std::max<int64_t>(left.count(), 1));
+    if (timeout && *timeout < remaining)
+    {
+        return timeout;
+    }
+    return remaining;
+}
+
+Deadline Deadline::atLeast(std::chrono::milliseconds minimum) const
+{
+    if (!_at)
+    {
+        return *this;
+    }
+    return Deadline(std::max(*_at, Clock::now() + minimum));
+}
+
+// DeadlineScope //////////////////////////////////////////////////////////////
+
+DeadlineScope::DeadlineScope(Deadline deadline, Stage stage) :
+    _previousDeadline(currentDeadline), _previousStage(currentStage)
+{
+    currentDeadline = deadline;
+    currentStage = stage;
+}
+
+DeadlineScope::DeadlineScope(Deadline deadline) :
+    DeadlineScope(deadline, currentStage)
+{}
+
+DeadlineScope::DeadlineScope(Stage stage) :
+    DeadlineScope(currentDeadline, stage)
+{}
+
+DeadlineScope::~DeadlineScope()
+{
+    currentDeadline = _previousDeadline;
+    currentStage = _previousStage;
+}
+
+Deadline DeadlineScope::current()
+{
+    return currentDeadline;
+}
+
+Stage DeadlineScope::stage()
+{
+    return currentStage;
+}
+
+void DeadlineScope::countExpired()
+{
+    expiredCalls[static_cast<size_t>(currentStage)]++;
+}
+
+void DeadlineScope::countTimedOut()
+{
+    timedOutCalls[static_cast<size_t>(currentStage)]++;
+}
+
+DeadlineStats DeadlineScope::stats()
+{
+    DeadlineStats stats{};
+    for (size_t i = 0; i < stageCount; ++i)
+    {
+        stats.expired[i] = expiredCalls[i].load();
+        stats.timedOut[i] = timedOutCalls[i].load();
+    }
+    return stats;
+}
+
+} // namespace dbus
@@ -17,6 +17,7 @@
 #include <boost/algorithm/string/split.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <ranges>
 #include <set>
 
@@ -405,6 +406,26 @@ DeviceIdPattern::DeviceIdPattern(const std::string& devIdPattern) :
     _patternInputDomains =
         calcInputDomains(calcInputIndexToBracketPoss(_bracketPosToInputPos),
                          _bracketInputMappings);
+
+    for (unsigned i = 0; i < _bracketInputMappings.size(); ++i)
+    {
+        const auto& domain = _patternInputDomains[_bracketPosToInputPos[i]];
+        auto& outputMapping = _bracketOutputMappings.emplace_back();
+        // iterating the map keeps each list of arguments sorted
+        for (const auto& [arg, value] : _bracketInputMappings[i])
+        {
+            if (domain.contains(arg))
+            {
+                outputMapping[value].push_back(arg);
+            }
+        }
+    }
+    // _bracketOutputMappings = vector{
+    //     [0]: map{ [0]: vector{ 1 }, [1]: vector{ 2 }, ...,
+    //               [7]: vector{ 8 } },
+    //     [1]: map{ [1]: vector{ 1 }, [2]: vector{ 2 }, ...,
+    //               [8]: vector{ 8 } }
+    // }
 }
 
 std::string DeviceIdPattern::eval(const PatternIndex& pi) const
@@ -458,25 +479,99 @@ std::vector<std::string> DeviceIdPattern::valuesVec() const
 
 bool DeviceIdPattern::matches(const std::string& str) const
 {
-    // marcinw:TODO: more efficient implementation
-    return !match(str).empty();
-    // auto values = this->values();
-    // return !(std::find(values.cbegin(), values.cend(), str) ==
-    //          values.cend());
+    std::vector<int> args(dim(), PatternIndex::unspecified);
+    std::vector<PatternIndex> res;
+    return matchFrom(str, 0, 0, args, res, true);
 }
 
 std::vector<PatternIndex> DeviceIdPattern::match(const std::string& str) const
 {
-    // marcinw:TODO: more efficient implementation
+    std::vector<int> args(dim(), PatternIndex::unspecified);
     std::vector<PatternIndex> res;
-    for (const auto& arg : this->domain())
+    matchFrom(str, 0, 0, args, res, false);
+    // Backtracking finds the arguments in the order of bracket value lengths
+    // rather than in the order of 'domain()'
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+bool DeviceIdPattern::matchFrom(const std::string& str, unsigned bracketPos,
+                                std::size_t strPos, std::vector<int>& args,
+                                std::vector<PatternIndex>& res,
+                                bool firstOnly) const
+{
+    // Every bracket is preceded by its text fragment, the last fragment
+    // closes the pattern
+    const auto& fragment = _patternNonBracketFragments[bracketPos];
+    if (str.compare(strPos, fragment.size(), fragment) != 0)
     {
-        if (this->eval(arg) == str)
+        return false;
+    }
+    strPos += fragment.size();
+
+    if (bracketPos == _bracketOutputMappings.size())
+    {
+        if (strPos != str.size())
+        {
+            return false;
+        }
+        PatternIndex pi;
+        for (unsigned i = 0; i < args.size(); ++i)
         {
-            res.push_back(arg);
+            pi.set(i, args[i]);
         }
+        res.push_back(pi);
+        return true;
     }
-    return res;
+
+    const auto& outputMapping = _bracketOutputMappings[bracketPos];
+    if (outputMapping.empty())
+    {
+        return false;
+    }
+    const unsigned maxValue = outputMapping.rbegin()->first;
+    int& arg = args[_bracketPosToInputPos[bracketPos]];
+    bool found = false;
+    // Bracket values are printed in decimal without leading zeros. Try every
+    // number prefixing the remaining string, the shortest first.
+    unsigned long value = 0;
+    for (std::size_t end = strPos; end < str.size() &&
+                                   std::isdigit((unsigned char)str[end]);
+         ++end)
+    {
+        if (end > strPos && str[strPos] == '0')
+        {
+            break;
+        }
+        value = value * 10 + (str[end] - '0');
+        if (value > maxValue)
+        {
+            break;
+        }
+        auto it = outputMapping.find(value);
+        if (it == outputMapping.end())
+        {
+            continue;
+        }
+        for (unsigned candidate : it->second)
+        {
+            // Brackets sharing the input position must agree on the argument
+            if (arg != PatternIndex::unspecified && arg != (int)candidate)
+            {
+                continue;
+            }
+            int prevArg = arg;
+            arg = candidate;
+            found |= matchFrom(str, bracketPos + 1, end + 1, args, res,
+                               firstOnly);
+            arg = prevArg;
+            if (found && firstOnly)
+            {
+                return true;
+            }
+        }
+    }
+    return found;
 }
 
 bool DeviceIdPattern::isInjective() const
@@ -536,6 +631,87 @@ PatternInputDomain DeviceIdPattern::dimDomain(unsigned axis) const
     }
 }
 
+// PatternCache ///////////////////////////////////////////////////////////////
+
+PatternCache& PatternCache::instance()
+{
+    static PatternCache cache;
+    return cache;
+}
+
+PatternCache::PatternPtr PatternCache::get(const std::string& pattern)
+{
+    if (!hasBrackets(pattern))
+    {
+        return std::make_shared<const DeviceIdPattern>(pattern);
+    }
+    {
+        std::shared_lock lock(_mutex);
+        auto it = _patterns.find(pattern);
+        if (it != _patterns.end())
+        {
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return insert(pattern);
+}
+
+bool PatternCache::preload(const std::string& pattern)
+{
+    if (!hasBrackets(pattern))
+    {
+        return true;
+    }
+    try
+    {
+        insert(pattern);
+    }
+    catch (const std::exception& e)
+    {
+        logs_dbg("Pattern '%s' not cached: %s\n", pattern.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+PatternCache::PatternPtr PatternCache::insert(const std::string& pattern)
+{
+    // Compile outside of the lock, a concurrent miss on the same string
+    // just compiles it twice
+    auto compiled = std::make_shared<const DeviceIdPattern>(pattern);
+    std::unique_lock lock(_mutex);
+    auto it = _patterns.find(pattern);
+    if (it != _patterns.end())
+    {
+        return it->second;
+    }
+    if (_patterns.size() < _maxSize)
+    {
+        _patterns.emplace(pattern, compiled);
+    }
+    return compiled;
+}
+
+PatternCacheStats PatternCache::stats() const
+{
+    PatternCacheStats result;
+    result.hits = _hits.load(std::memory_order_relaxed);
+    result.misses = _misses.load(std::memory_order_relaxed);
+    std::shared_lock lock(_mutex);
+    result.size = _patterns.size();
+    return result;
+}
+
+void PatternCache::clear()
+{
+    std::unique_lock lock(_mutex);
+    _patterns.clear();
+    _hits = 0;
+    _misses = 0;
+}
+
 // Helper functions ///////////////////////////////////////////////////////////
 
 /**
@@ -24,8 +24,8 @@ bool existsRange(const device_id::DeviceIdPattern& patternObj)
 
 bool existsRange(const std::string& str)
 {
-    device_id::DeviceIdPattern devicePattern(str);
-    return existsRange(devicePattern);
+    return device_id::hasBrackets(str) &&
+           existsRange(*device_id::cachedPattern(str));
 }
 
 DeviceIdMap expandDeviceRange(const device_id::DeviceIdPattern& patternObj)
@@ -52,8 +52,7 @@ DeviceIdMap expandDeviceRange(const device_id::DeviceIdPattern& patternObj)
 
 DeviceIdMap expandDeviceRange(const std::string& deviceRegx)
 {
-    device_id::DeviceIdPattern devicePattern(deviceRegx);
-    return  expandDeviceRange(devicePattern);
+    return expandDeviceRange(*device_id::cachedPattern(deviceRegx));
 }
 
 device_id::PatternIndex
@@ -90,10 +89,10 @@ std::string determineDeviceName(const std::string& objPattern,
     std::string deviceName{""};
     if (false == objPath.empty() && false == objPattern.empty())
     {
-        device_id::DeviceIdPattern objectPathPattern(objPattern);
-        device_id::DeviceIdPattern deviceTypePattern(devType);
-        deviceName =
-             determineDeviceName(objectPathPattern, objPath, deviceTypePattern);
+        auto objectPathPattern = device_id::cachedPattern(objPattern);
+        auto deviceTypePattern = device_id::cachedPattern(devType);
+        deviceName = determineDeviceName(*objectPathPattern, objPath,
+                                         *deviceTypePattern);
     }
     logs_dbg("objPattern:'%s' objPath:'%s' devType:'%s' Devname:'%s'\n.",
              objPattern.c_str(), objPath.c_str(), devType.c_str(),
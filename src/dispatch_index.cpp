@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dispatch_index.hpp"
+
+#include "device_id.hpp"
+#include "log.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+namespace dispatch_index
+{
+
+data_accessor::DataAccessor dbusTrigger(const std::string& objectPath,
+                                        const std::string& interface,
+                                        const std::string& property)
+{
+    const std::string type = "DBUS";
+    nlohmann::json j;
+    j[data_accessor::typeKey] = type;
+    j[data_accessor::accessorTypeKeys[type][0]] = objectPath;
+    j[data_accessor::accessorTypeKeys[type][1]] = interface;
+    j[data_accessor::accessorTypeKeys[type][2]] = property;
+    return data_accessor::DataAccessor(j);
+}
+
+// StringInterner /////////////////////////////////////////////////////////////
+
+StringInterner::Id StringInterner::intern(std::string_view str)
+{
+    auto it = _ids.find(str);
+    if (it != _ids.end())
+    {
+        return it->second;
+    }
+    Id id = static_cast<Id>(_strings.size());
+    _strings.emplace_back(str);
+    _ids.emplace(_strings.back(), id);
+    return id;
+}
+
+StringInterner::Id StringInterner::find(std::string_view str) const
+{
+    auto it = _ids.find(str);
+    return it != _ids.end() ? it->second : invalidId;
+}
+
+// DispatchIndex //////////////////////////////////////////////////////////////
+
+void DispatchIndex::clear()
+{
+    _paths = StringInterner();
+    _interfaces = StringInterner();
+    _properties = StringInterner();
+    _dispatch.clear();
+    _built = false;
+}
+
+void DispatchIndex::add(const data_accessor::DataAccessor& accessor,
+                        const std::shared_ptr<event_info::EventNode>& event)
+{
+    auto iface = _interfaces.intern(accessor.getDbusInterface());
+    auto prop = _properties.intern(accessor.getProperty());
+    device_id::DeviceIdPattern pattern(accessor.getDbusObjectPath());
+    for (const auto& path : pattern.values())
+    {
+        auto [entry, added] =
+            _dispatch.try_emplace(Key{_paths.intern(path), iface, prop});
+        if (added)
+        {
+            entry->second.trigger = dbusTrigger(
+                path, accessor.getDbusInterface(), accessor.getProperty());
+        }
+        auto& events = entry->second.events;
+        if (std::find(events.begin(), events.end(), event) == events.end())
+        {
+            events.push_back(event);
+        }
+    }
+}
+
+bool DispatchIndex::build(const event_info::EventTriggerView& triggerView,
+                          const event_info::EventRecoveryView& recoveryView)
+{
+    clear();
+    try
+    {
+        // triggers go first so that, per key, the list has the same order
+        // as the Trigger View lookup followed by the Recovery View lookup
+        for (const auto& [accessor, event] : triggerView)
+        {
+            if (accessor.isValidDbusAccessor())
+            {
+                add(accessor, event);
+            }
+        }
+        for (const auto& [accessor, event] : recoveryView)
+        {
+            if (accessor.isValidDbusAccessor())
+            {
+                add(accessor, event);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        logs_err("Failed to build the dispatch index, falling back to the "
+                 "event views: %s\n", e.what());
+        clear();
+        return false;
+    }
+    _built = true;
+    logs_info("Dispatch index built: %zu keys, %zu paths, %zu interfaces, "
+              "%zu properties\n",
+              _dispatch.size(), _paths.size(), _interfaces.size(),
+              _properties.size());
+    return true;
+}
+
+const DispatchIndex::Entry*
+    DispatchIndex::find(std::string_view objectPath,
+                        std::string_view interface,
+                        std::string_view property) const
+{
+    Key key{_paths.find(objectPath), _interfaces.find(interface),
+            _properties.find(property)};
+    if (key.path == StringInterner::invalidId ||
+        key.interface == StringInterner::invalidId ||
+        key.property == StringInterner::invalidId)
+    {
+        return nullptr;
+    }
+    auto it = _dispatch.find(key);
+    return it != _dispatch.end() ? &it->second : nullptr;
+}
+
+} // namespace dispatch_index
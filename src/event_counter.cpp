@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "event_counter.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace event_counter
+{
+
+std::string CounterStore::key(const std::string& event,
+                              const std::string& device)
+{
+    // event names never contain a newline
+    std::string result;
+    result.reserve(event.size() + device.size() + 1);
+    result.append(event).append(1, '\n').append(device);
+    return result;
+}
+
+CounterStore::Shard& CounterStore::shard(const std::string& key)
+{
+    return _shards[std::hash<std::string>{}(key) % _shards.size()];
+}
+
+const CounterStore::Shard& CounterStore::shard(const std::string& key) const
+{
+    return _shards[std::hash<std::string>{}(key) % _shards.size()];
+}
+
+bool CounterStore::hit(const std::string& event, const std::string& device,
+                       int triggerCount, std::chrono::milliseconds decayWindow,
+                       Clock::time_point now)
+{
+    auto k = key(event, device);
+    auto& s = shard(k);
+    std::lock_guard lock(s.mutex);
+    auto [it, inserted] = s.buckets.try_emplace(k);
+    auto& bucket = it->second;
+    if (inserted)
+    {
+        bucket.event = event;
+        bucket.device = device;
+    }
+    else if (decayWindow.count() > 0 && now > bucket.updated)
+    {
+        double leaked =
+            std::chrono::duration<double>(now - bucket.updated) / decayWindow;
+        bucket.count = std::max(0.0, bucket.count - leaked);
+    }
+    bucket.updated = now;
+    bucket.count += 1;
+    if (bucket.count >= triggerCount)
+    {
+        bucket.count = triggerCount;
+        return true;
+    }
+    return false;
+}
+
+double CounterStore::get(const std::string& event,
+                         const std::string& device) const
+{
+    auto k = key(event, device);
+    const auto& s = shard(k);
+    std::lock_guard lock(s.mutex);
+    auto it = s.buckets.find(k);
+    return it != s.buckets.end() ? it->second.count : 0;
+}
+
+void CounterStore::set(const std::string& event, const std::string& device,
+                       double count, Clock::time_point now)
+{
+    auto k = key(event, device);
+    auto& s = shard(k);
+    std::lock_guard lock(s.mutex);
+    auto& bucket = s.buckets[k];
+    bucket.event = event;
+    bucket.device = device;
+    bucket.count = count;
+    bucket.updated = now;
+}
+
+void CounterStore::reset(const std::string& event, const std::string& device)
+{
+    auto k = key(event, device);
+    auto& s = shard(k);
+    std::lock_guard lock(s.mutex);
+    s.buckets.erase(k);
+}
+
+std::vector<CounterEntry> CounterStore::snapshot() const
+{
+    std::vector<CounterEntry> result;
+    for (const auto& s : _shards)
+    {
+        std::lock_guard lock(s.mutex);
+        for (const auto& [k, bucket] : s.buckets)
+        {
+            result.push_back({bucket.event, bucket.device, bucket.count});
+        }
+    }
+    return result;
+}
+
+size_t CounterStore::size() const
+{
+    size_t result = 0;
+    for (const auto& s : _shards)
+    {
+        std::lock_guard lock(s.mutex);
+        result += s.buckets.size();
+    }
+    return result;
+}
+
+void CounterStore::clear()
+{
+    for (auto& s : _shards)
+    {
+        std::lock_guard lock(s.mutex);
+        s.buckets.clear();
+    }
+}
+
+} // namespace event_counter
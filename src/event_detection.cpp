@@ -11,12 +11,16 @@
 
 #include "event_detection.hpp"
 
+#include "async_reader.hpp"
 #include "common.hpp"
 #include "eventing_main.hpp"
 #include "data_accessor.hpp"
+#include "deadline.hpp"
 #include "event_handler.hpp"
 #include "event_info.hpp"
+#include "object_tree.hpp"
 #include "pc_event.hpp"
+#include "property_store.hpp"
 #include "log.hpp"
 
 #include <boost/container/flat_map.hpp>
@@ -44,18 +48,39 @@ static EventDetection* eventDetectionPtr = nullptr;
 
 std::unique_ptr<ThreadpoolManager> threadpoolManager;
 
+std::unique_ptr<WorkerPool> workerPool;
+subscription_plan::SubscriptionPlan subscriptionPlan;
+
 std::unique_ptr<PcQueueType> queue;
 
+size_t queueMaxBatchSize = PROPERTIESCHANGED_MAX_BATCH_SIZE;
+
 event_info::EventTriggerView eventTriggerView;
 event_info::EventAccessorView eventAccessorView;
 event_info::EventRecoveryView eventRecoveryView;
 
+dispatch_index::DispatchIndex dispatchIndex;
+
+static std::atomic<bool> workerStopped{false};
+
 void EventDetection::workerThreadProcessEvents()
 {
-    while (true)
+    std::vector<PcDataType> batch;
+    batch.reserve(queueMaxBatchSize);
+    while (!workerThreadStopped())
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        popFromQueue();      
+        if (!queue->waitForData(
+                std::chrono::milliseconds(PROPERTIESCHANGED_WAIT_TIMEOUT_MS)))
+        {
+            continue;
+        }
+        batch.clear();
+        auto popped = queue->popBatch(batch, queueMaxBatchSize);
+        logs_dbg("worker: processing a batch of %zu elements\n", popped);
+        for (const auto& pc : batch)
+        {
+            processQueueData(pc);
+        }
     }
 }
 
@@ -66,8 +91,7 @@ void EventDetection::workerThreadMainLoop()
         auto bus = sdbusplus::bus::new_default_system();
         logs_err("thread2: starting event processing\n");
         workerThreadProcessEvents();
-        logs_err(
-            "thread2: exiting because workerThreadProcessEvents returned!!\n");
+        logs_info("thread2: stopped event processing\n");
     }
     catch (const std::exception& e)
     {
@@ -76,9 +100,20 @@ void EventDetection::workerThreadMainLoop()
     }
 }
 
+void EventDetection::stopWorkerThread()
+{
+    workerStopped = true;
+}
+
+bool EventDetection::workerThreadStopped()
+{
+    return workerStopped;
+}
+
 void EventDetection::dbusEventHandlerCallback(sdbusplus::message::message& msg)
 {
     logs_dbg("entered dbusEventHandlerCallback\n");
+    auto arrived = std::chrono::steady_clock::now();
     std::string msgInterface;
     boost::container::flat_map<std::string, PropertyVariant> propertiesChanged;
 
@@ -93,6 +128,17 @@ void EventDetection::dbusEventHandlerCallback(sdbusplus::message::message& msg)
         return;
     }
 
+    // namespace match rules also deliver objects nobody subscribed
+    if (!subscriptionPlan.wants(objectPath, msgInterface))
+    {
+        logs_dbg("Not subscribed PC Path: %s, Intf: %s\n", objectPath.c_str(),
+                 msgInterface.c_str());
+        return;
+    }
+    // before dispatching, the handlers read the new values from the store
+    dbus::PropertyStore::instance().update(objectPath, msgInterface,
+                                           propertiesChanged);
+
     // pcTimestampType timestamp = std::chrono::steady_clock::now();
 
     for (auto& pc : propertiesChanged)
@@ -125,24 +171,36 @@ void EventDetection::dbusEventHandlerCallback(sdbusplus::message::message& msg)
             continue;
         }
 
-        // TODO: the json, propertyvalue, and dataaccessor creation are
-        // duplicated here and on the second thread.
-        const std::string type = "DBUS";
-        nlohmann::json j;
-        j[data_accessor::typeKey] = type;
-        j[data_accessor::accessorTypeKeys[type][0]] = objectPath;
-        j[data_accessor::accessorTypeKeys[type][1]] = msgInterface;
-        j[data_accessor::accessorTypeKeys[type][2]] = eventProperty;
-        data_accessor::PropertyValue propertyValue(variant);
-        data_accessor::DataAccessor accessor(j, propertyValue);
+        if (!dispatchIndex.isBuilt())
+        {
+            auto accessor = dispatch_index::dbusTrigger(
+                objectPath, msgInterface, eventProperty);
+            accessor.setDataValue(data_accessor::PropertyValue(variant));
+            logs_dbg("Passing PC Trigger into Event Discovery phase\n");
+            eventDiscovery(accessor);
+            continue;
+        }
+
+        // only signals some event listens to get their accessor copied
+        const auto* entry =
+            dispatchIndex.find(objectPath, msgInterface, eventProperty);
+        if (entry == nullptr)
+        {
+            logs_dbg("No event listens to PC Trigger Path: %s, Intf: %s, "
+                     "Prop: '%s'\n",
+                     objectPath.c_str(), msgInterface.c_str(),
+                     eventProperty.c_str());
+            continue;
+        }
 
         logs_dbg(
-            "Got PC Trigger ... Path: %s, Intf: %s, Prop: '%s', VarIndex: %d\n",
+            "Got PC Trigger ... Path: %s, Intf: %s, Prop: '%s', VarIndex: %d, "
+            "events: %zu\n",
             objectPath.c_str(), msgInterface.c_str(), eventProperty.c_str(),
-            index);
-        logs_dbg("Passing PC Trigger into Event Discovery phase\n");
-
-        eventDiscovery(accessor);
+            index, entry->events.size());
+        auto accessor = entry->trigger;
+        accessor.setDataValue(data_accessor::PropertyValue(variant));
+        pushToQueue(accessor, entry->events, arrived);
 
     } // end for (auto& pc : propertiesChanged)
     logs_dbg("finished dbusEventHandlerCallback\n");
@@ -156,62 +214,80 @@ DbusEventHandlerList EventDetection::startEventDetection(
     eventDetectionPtr = eventDetection;
 
     DbusEventHandlerList handlerList;
-    // helper map to make sure a object-path+interface is registered just once
-    RegisteredObjectInterfaceMap uniqueRegisterMap;
+    // object-path + interface pairs are registered just once, siblings
+    // sharing an interface under a single namespace rule
+    subscriptionPlan.clear();
 
     for (const auto& dev : *this->_eventMap)
     {
         for (auto& event : dev.second)
         {
-            subscribeAcc(event.trigger, uniqueRegisterMap, conn, handlerList);
-            subscribeAcc(event.accessor, uniqueRegisterMap, conn, handlerList);
-            subscribeAcc(event.recovery_accessor, uniqueRegisterMap, conn,
-                         handlerList);
+            subscribeAcc(event.trigger, subscriptionPlan);
+            subscribeAcc(event.accessor, subscriptionPlan);
+            subscribeAcc(event.recovery_accessor, subscriptionPlan);
+        }
+    }
+
+    auto genericHandler = std::bind(&EventDetection::dbusEventHandlerCallback,
+                                    std::placeholders::_1);
+    // a namespace rule also wakes us up for the parent's other descendants
+    auto descendants = [](const std::string& parent,
+                          const std::string& interface) {
+        return dbus::ObjectTree::shared()
+            ->getSubTreePaths(parent, 0, {interface})
+            .size();
+    };
+    for (const auto& rule :
+         subscriptionPlan.plan(SUBSCRIPTION_MIN_NAMESPACE_GROUP, descendants))
+    {
+        log_dbg("subscribing %s %s:%s (%zu objects)\n",
+                rule.isNamespace ? "namespace" : "object", rule.path.c_str(),
+                rule.interface.c_str(), rule.objects.size());
+        handlerList.push_back(
+            dbus::registerMatchRule(conn, rule.matchRule(), genericHandler));
+        for (const auto& object : rule.objects)
+        {
+            dbus::PropertyStore::instance().track(object, rule.interface);
         }
     }
-    log_dbg("dbusEventHandlerMatcher created.\n");
+    log_info("dbusEventHandlerMatcher created: %zu match rules for %zu "
+             "object:interface subscriptions, %zu rules saved.\n",
+             subscriptionPlan.rules().size(), subscriptionPlan.subscriptions(),
+             subscriptionPlan.savedRules());
     return handlerList;
 }
 
-void EventDetection::subscribeAcc(
-    const data_accessor::DataAccessor& acc, RegisteredObjectInterfaceMap& map,
-    std::shared_ptr<sdbusplus::asio::connection>& conn,
-    DbusEventHandlerList& handlerList)
+void EventDetection::subscribeAcc(const data_accessor::DataAccessor& acc,
+                                  subscription_plan::SubscriptionPlan& plan)
 {
-    auto genericHandler = std::bind(&EventDetection::dbusEventHandlerCallback,
-                                    std::placeholders::_1);
     auto dbusInfo = acc.getDbusInterfaceObjectsMap();
     if (dbusInfo.empty() == false)
     {
         const auto& interface = dbusInfo.begin()->first;
-        size_t i = 0;
         for (const auto& object : dbusInfo.begin()->second)
         {
-            auto key = dbusInfo.begin()->second.at(i) + ":" + interface;
-            if (map.count(key) == 0)
-            {
-                log_dbg("subscribing object:interface : %s\n", key.c_str());
-                handlerList.push_back(dbus::registerServicePropertyChanged(
-                    conn, object, interface, genericHandler));
-                map[key] = 1; // global map, indicate it is already subscribed
-            }
-            else
-            {
-                log_dbg("object:interface already subscribed: %s\n",
-                        key.c_str());
-            }
-            i++;
+            log_dbg("subscribing object:interface : %s:%s\n", object.c_str(),
+                    interface.c_str());
+            plan.add(object, interface);
         }
     }
 }
 
-void EventDetection::popFromQueue()
+bool EventDetection::popFromQueue()
 {
     PcDataType pc;
     if (!queue->pop(pc))
     {
-        return;
+        return false;
     }
+    processQueueData(pc);
+    return true;
+}
+
+void EventDetection::processQueueData(const PcDataType& pc)
+{
+    dbus::DeadlineScope deadline(dbus::Deadline::forEvent(pc.arrived),
+                                 dbus::Stage::detection);
     data_accessor::DataAccessor accessor = pc.accessor;
     data_accessor::PropertyValue propertyValue =
         accessor.getDataValue();
@@ -224,23 +300,31 @@ void EventDetection::popFromQueue()
     {
         return;
     }
-    std::stringstream ss;
-    accessor.print(ss);
-    logs_err(
-        "Event Candidate List has events from PC Trigger/Accessor %s\n",
-        ss.str().c_str());
-    logs_err("Data value: %s \n", propertyValue.getString().c_str());
+    if (log_enabled(information))
+    {
+        std::stringstream ss;
+        accessor.print(ss);
+        logs_info(
+            "Event Candidate List has events from PC Trigger/Accessor %s\n",
+            ss.str().c_str());
+        logs_info("Data value: %s \n", propertyValue.getString().c_str());
+    }
     processEventList(eventsCandidateList, propertyValue);
 }
 
 void EventDetection::pushToQueue(const data_accessor::DataAccessor& pcTrigger,
-                                 EventNodeSharedList eventPtrs)
+                                 EventNodeSharedList eventPtrs,
+                                 std::chrono::steady_clock::time_point arrived)
 {
-    bool pushSuccess =
-        queue->push(PcDataType{.accessor = pcTrigger, .eventPtrs = eventPtrs});
+    bool pushSuccess = queue->push(PcDataType{
+        .accessor = pcTrigger, .eventPtrs = eventPtrs, .arrived = arrived});
     if (!pushSuccess)
     {
-        logs_err("callback: failed to push event to queue! \n");
+        auto stats = queue->stats();
+        logs_err("callback: failed to push event to queue! (dropped newest: "
+                 "%zu, dropped oldest: %zu, block timeouts: %zu)\n",
+                 stats.droppedNewest, stats.droppedOldest,
+                 stats.blockTimeouts);
         std::stringstream ss;
         pcTrigger.print(ss);
         logs_err("PC Trigger Accessor contents: %s\n", ss.str().c_str());
@@ -248,13 +332,13 @@ void EventDetection::pushToQueue(const data_accessor::DataAccessor& pcTrigger,
                  pcTrigger.getDataValue().getString().c_str());
     }
     size_t availableSpace = queue->write_available();
-    logs_err("callback: queue now has space for %zu elements\n",
+    logs_dbg("callback: queue now has space for %zu elements\n",
              availableSpace);
-    if (availableSpace < PROPERTIESCHANGED_QUEUE_SIZE / 2)
+    if (availableSpace < queue->capacity() / 2)
     {
         logs_err("callback: queue has less than 50%% space available "
                  "(%zu available, %zu total)\n",
-                 availableSpace, (size_t)PROPERTIESCHANGED_QUEUE_SIZE);
+                 availableSpace, queue->capacity());
     }
 }
 
@@ -262,8 +346,12 @@ int EventDetection::eventDiscovery(const data_accessor::DataAccessor& accessor,
                                     const bool& bootup)
 {
     EventNodeSharedList eventPtrs{};
+    // only the debug messages print the accessor
     std::stringstream ss;
-    accessor.print(ss);
+    if (log_enabled(debug))
+    {
+        accessor.print(ss);
+    }
     if (!bootup)
     {
         /** used to make sure the same event is not being sent more than once
@@ -301,7 +389,7 @@ int EventDetection::eventDiscovery(const data_accessor::DataAccessor& accessor,
     }
     else
     {
-        logs_err("In Bootup Event Detection phase Accessor data='%s' acc=%s",
+        logs_dbg("In Bootup Event Detection phase Accessor data='%s' acc=%s",
                  accessor.getDataValue().getString().c_str(), ss.str().c_str());
 
         // Accessors comming from Seltest must have data, avoiding TP failed
@@ -310,15 +398,16 @@ int EventDetection::eventDiscovery(const data_accessor::DataAccessor& accessor,
             auto itr = eventAccessorView.equal_range(accessor);
             if (itr.first == itr.second)
             {
-                logs_err("Accessor not found in eventAccessorView acc=%s",
+                logs_dbg("Accessor not found in eventAccessorView acc=%s",
                          ss.str().c_str());
             }
             else
             {
                 for (auto it = itr.first; it != itr.second; it++)
                 {
-                    logs_err("Discovered bootup event with matching accessor: %s\n",
-                             it->second->event.c_str());
+                    logs_info(
+                        "Discovered bootup event with matching accessor: %s\n",
+                        it->second->event.c_str());
                     eventPtrs.push_back(it->second);
                 }
             }
@@ -359,7 +448,7 @@ bool EventDetection::getIsAccessorInteresting(
                 if (event_info::EventNode::getIsAccessorInterestingToEvent(
                         event, accessor))
                 {
-                    logs_err("Event %s has interesting accessor!\n",
+                    logs_dbg("Event %s has interesting accessor!\n",
                              event.event.c_str());
                     return true;
                 }
@@ -376,7 +465,7 @@ void EventDetection::processEventList(EventCandidateList& eventsCandidateList,
     for (auto& assertedEvent : eventsCandidateList)
     {
         auto& candidate = *std::get<0>(assertedEvent);
-        logs_err("Asserted Event: %s\n", candidate.event.c_str());
+        logs_info("Asserted Event: %s\n", candidate.event.c_str());
         int eventValue = invalidIntParam;
         if (candidate.valueAsCount)
         {
@@ -400,7 +489,7 @@ void EventDetection::processEventList(EventCandidateList& eventsCandidateList,
             
             if (isRecovery)
             {
-                logs_err(
+                logs_info(
                     "performing RootCauseTracer due to recovery on %s\n",
                     event.device.c_str());
                 if (isMultiThread)
@@ -432,12 +521,15 @@ void EventDetection::processEventList(EventCandidateList& eventsCandidateList,
                     logs_err("Failed to get current device health (ignored)\n");
                 }
 #endif // EVENTING_SERVICE_DEVICE_STATUS_FS
-                std::stringstream ss;
-                ss << "Throw out an eventHdlrMgr. device: "
-                   << event.device << " event: '" << event.event << "'"
-                   << " deviceIndex: "
-                   << assertedDevice.deviceIndexTuple;
-                logs_err("%s\n", ss.str().c_str());
+                if (log_enabled(information))
+                {
+                    std::stringstream ss;
+                    ss << "Throw out an eventHdlrMgr. device: "
+                       << event.device << " event: '" << event.event << "'"
+                       << " deviceIndex: "
+                       << assertedDevice.deviceIndexTuple;
+                    logs_info("%s\n", ss.str().c_str());
+                }
                 if (isMultiThread)
                 {
                     eventDetectionPtr->RunEventHandlers(event);
@@ -460,7 +552,29 @@ void EventDetection::bootUpEventsDetection()
     EventCandidateList eventCandidateList{};
     data_accessor::PropertyValue propertyValue(int(0));
     const bool doNotUseMultiThread = false;
-        
+
+    // read the properties of all the events in bulk up front
+    std::vector<std::vector<data_accessor::DataAccessor>> expanded{};
+    std::vector<dbus::PropertyRequest> requests{};
+    for (auto& accViewItem : eventAccessorView)
+    {
+        auto& accessor = accViewItem.first;
+        expanded.emplace_back();
+        if (accessor.isTypeDbus())
+        {
+            expanded.back() = accessor.expand();
+            for (const auto& accExpanded : expanded.back())
+            {
+                if (auto request = accExpanded.dbusReadRequest())
+                {
+                    requests.push_back(*request);
+                }
+            }
+        }
+    }
+    dbus::PrefetchScope prefetched(requests, dbus::PrefetchScope::Mode::bulk);
+
+    auto expandedIt = expanded.begin();
     for (auto& accViewItem : eventAccessorView)
     {
         auto& accessor = accViewItem.first;
@@ -473,7 +587,7 @@ void EventDetection::bootUpEventsDetection()
         std::vector<data_accessor::DataAccessor> accList{};
         if (accessor.isTypeDbus())
         {
-            accList = accessor.expand();
+            accList = std::move(*expandedIt);
             for (auto& accExpanded : accList)
             {
                 accExpanded.read(); // object path is ready to get-property
@@ -483,6 +597,7 @@ void EventDetection::bootUpEventsDetection()
         {
             accList.push_back(accessor);
         }
+        ++expandedIt;
         
         for (auto& accData : accList)
         {
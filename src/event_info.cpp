@@ -17,12 +17,15 @@
 #include <boost/algorithm/string/split.hpp>
 #include <nlohmann/json.hpp>
 
+#include <charconv>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <regex>
 #include <string>
+#include <system_error>
 #include <vector>
 
 using json = nlohmann::json;
@@ -453,6 +456,49 @@ void EventNode::readDeviceTypes(const json& js, const std::string& eventName)
     }
 }
 
+/**
+ * @brief The decay window of an "event_counter_reset" of type "decay", its
+ *        "metadata" in milliseconds as a number or a string of digits
+ *
+ * @return zero (no decay) if the reset is of another type or the metadata is
+ *         not a valid window, which is logged
+ */
+static std::chrono::milliseconds decayWindow(const json& counterReset,
+                                             const std::string& eventName)
+{
+    if (counterReset.value("type", "") != "decay")
+    {
+        return std::chrono::milliseconds(0);
+    }
+    auto metadata = counterReset.find("metadata");
+    uint64_t windowMs = 0;
+    bool valid = false;
+    if (metadata != counterReset.end() && metadata->is_number_integer())
+    {
+        valid = metadata->is_number_unsigned() || metadata->get<int64_t>() >= 0;
+        windowMs = valid ? metadata->get<uint64_t>() : 0;
+    }
+    else if (metadata != counterReset.end() && metadata->is_string())
+    {
+        const auto& str = metadata->get_ref<const std::string&>();
+        auto [end, ec] =
+            std::from_chars(str.data(), str.data() + str.size(), windowMs);
+        valid = !str.empty() && ec == std::errc() &&
+                end == str.data() + str.size();
+    }
+    if (!valid)
+    {
+        std::stringstream ss;
+        ss << "Invalid \"event_counter_reset\" decay metadata in event entry '"
+           << eventName << "': "
+           << (metadata != counterReset.end() ? metadata->dump() : "missing")
+           << ", the event counter will not decay";
+        shortlogs_err(<< ss.str());
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::milliseconds(windowMs);
+}
+
 void EventNode::loadFrom(const json& j)
 {
     this->configEventNode = j;
@@ -480,6 +526,8 @@ void EventNode::loadFrom(const json& j)
     this->device = "";
 
     this->counterReset = j.at("event_counter_reset");
+    this->counterDecayWindow =
+        decayWindow(j.at("event_counter_reset"), this->event);
 
     // std::vector<event_info::MessageArg> messageArgs;
     // if (j["redfish"].contains("message_args"))
@@ -549,17 +597,12 @@ void EventNode::print() const
        << "\n";
     ss << accessor << "\n";
 
-    ss << "\t\tcount(map)      " << count.size() << "\n";
-    for (auto& p : count)
-    {
-        ss << "\t\t\t[" << p.first << "] = " << p.second << "\n";
-    }
-
     ss << "\t\ttriggerCount    " << triggerCount << "\n";
     ss << "\t\tcounterReset    "
        << "todo"
        << "\n";
     ss << counterReset << "\n";
+    ss << "\t\tcounterDecayWindow " << counterDecayWindow.count() << "ms\n";
 
     ss << "\t\tredfish:" << std::endl;
     messageRegistry.print(ss, "\t\t\t");
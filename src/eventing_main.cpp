@@ -10,31 +10,44 @@
 
 #include "eventing_main.hpp"
 
+#include "async_reader.hpp"
 #include "common.hpp"
 #include "cmd_line.hpp"
 #include "dat_traverse.hpp"
+#include "deadline.hpp"
+#include "device_id.hpp"
 #include "diagnostics.hpp"
 #include "event_detection.hpp"
 #include "event_info.hpp"
 #include "message_composer.hpp"
 #include "device_status_handler.hpp"
 #include "pc_event.hpp"
+#include "property_snapshot.hpp"
+#include "property_store.hpp"
+#include "rate_limiter.hpp"
 #include "selftest.hpp"
+#include "service_cache.hpp"
+#include "subprocess.hpp"
 #include "threadpool_manager.hpp"
 #include "util.hpp"
 
 #include <unistd.h>
 
+#include <boost/asio/signal_set.hpp>
 #include <boost/container/flat_map.hpp>
 #include <nlohmann/json.hpp>
 #include <phosphor-logging/log.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <queue>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -87,6 +100,10 @@ struct Configuration
     std::string event;
     int running_thread_limit = DEFAULT_RUNNING_THREAD_LIMIT;
     int total_thread_limit = DEFAULT_TOTAL_THREAD_LIMIT;
+    size_t queue_batch_size = PROPERTIESCHANGED_MAX_BATCH_SIZE;
+    size_t queue_size = PROPERTIESCHANGED_QUEUE_SIZE;
+    PcOverflowPolicy queue_overflow_policy = PcOverflowPolicy::dropNewest;
+    size_t worker_queue_size = WORKER_POOL_QUEUE_SIZE;
 };
 
 Configuration configuration;
@@ -176,7 +193,64 @@ int setDbusDelay(cmd_line::ArgFuncParamType params)
     {
         throw std::runtime_error("Dbus delay cannot be lesser than 0");
     }
-    dbus::defaultDbusDelayer.setDelayTime(std::chrono::milliseconds(delay));
+    if (delay > 0)
+    {
+        // one call at a time, spaced by 'delay' start to start
+        dbus::RateLimit limit;
+        limit.rate = 1000.0 / delay;
+        limit.burst = 1;
+        limit.maxConcurrent = 1;
+        dbus::RateLimiter::instance().setDefaultLimit(limit);
+    }
+    return 0;
+}
+
+int setDbusRateLimits(cmd_line::ArgFuncParamType params)
+{
+    auto& limiter = dbus::RateLimiter::instance();
+    for (const auto& spec : params)
+    {
+        auto [service, limit] = dbus::RateLimiter::parse(spec);
+        if (service == "*")
+        {
+            limiter.setDefaultLimit(limit);
+        }
+        else
+        {
+            limiter.setLimit(service, limit);
+        }
+    }
+    return 0;
+}
+
+int setEventDeadline(cmd_line::ArgFuncParamType params)
+{
+    int deadline = std::stoi(params[0]);
+    if (deadline < 0)
+    {
+        throw std::runtime_error("Event deadline cannot be negative");
+    }
+    dbus::Deadline::setEventBudget(std::chrono::milliseconds(deadline));
+    return 0;
+}
+
+int enableCoprocesses(cmd_line::ArgFuncParamType params)
+{
+    for (const auto& executable : params)
+    {
+        subprocess::Runner::instance().enableCoprocess(executable);
+    }
+    return 0;
+}
+
+int setCmdlineMemoTtl(cmd_line::ArgFuncParamType params)
+{
+    int ttl = std::stoi(params[0]);
+    if (ttl < 0)
+    {
+        throw std::runtime_error("CMDLINE memo TTL cannot be negative");
+    }
+    subprocess::Memo::instance().setTtl(std::chrono::milliseconds(ttl));
     return 0;
 }
 
@@ -202,6 +276,46 @@ int setTotalThreadLimit(cmd_line::ArgFuncParamType params)
     return 0;
 }
 
+int setQueueBatchSize(cmd_line::ArgFuncParamType params)
+{
+    int batch = std::stoi(params[0]);
+    if (batch <= 0)
+    {
+        throw std::runtime_error("Queue batch size cannot be less than 1");
+    }
+    configuration.queue_batch_size = batch;
+    return 0;
+}
+
+int setQueueSize(cmd_line::ArgFuncParamType params)
+{
+    int size = std::stoi(params[0]);
+    if (size <= 0)
+    {
+        throw std::runtime_error("Queue size cannot be less than 1");
+    }
+    configuration.queue_size = size;
+    return 0;
+}
+
+int setWorkerQueueSize(cmd_line::ArgFuncParamType params)
+{
+    int size = std::stoi(params[0]);
+    if (size <= 0)
+    {
+        throw std::runtime_error("Worker queue size cannot be less than 1");
+    }
+    configuration.worker_queue_size = size;
+    return 0;
+}
+
+int setQueueOverflowPolicy(cmd_line::ArgFuncParamType params)
+{
+    configuration.queue_overflow_policy =
+        pcOverflowPolicyFromString(params[0]);
+    return 0;
+}
+
 static cmd_line::CmdLineArgs cmdLineArgs = {
     {"-h", "--help", cmd_line::OptFlag::none, "", cmd_line::ActFlag::exclusive,
      "This help.",
@@ -221,17 +335,60 @@ static cmd_line::CmdLineArgs cmdLineArgs = {
      setLogFile},
     {"-s", "--dbus-space", cmd_line::OptFlag::overwrite, "<num>",
      cmd_line::ActFlag::normal,
-     "Minimal amount of time (in ms) between dbus calls"
-     " (from the finish of the last one to the start of the current)",
+     "Minimal amount of time (in ms) between the starts of two dbus calls"
+     " to a service, one call at a time."
+     " Shortcut for --dbus-rate-limit '*=<1000/num>:1:1'",
      setDbusDelay},
+    {"-r", "--dbus-rate-limit", cmd_line::OptFlag::append,
+     "<service>=<rate>[:<burst>[:<max concurrent>]]",
+     cmd_line::ActFlag::normal,
+     "Token bucket limiting the dbus calls to a service: <rate> calls per"
+     " second, <burst> calls back to back (default 1), at most"
+     " <max concurrent> calls waiting for their reply (default no limit)."
+     " Service '*' sets the default. Can be repeated",
+     setDbusRateLimits},
+    {"-E", "--event-deadline", cmd_line::OptFlag::overwrite, "<ms>",
+     cmd_line::ActFlag::normal,
+     "Time an event has for all its dbus calls, from the arrival of its"
+     " signal to the log creation. 0 for the default dbus timeout on every"
+     " call",
+     setEventDeadline},
+    {"-C", "--coprocess", cmd_line::OptFlag::append, "<executable>",
+     cmd_line::ActFlag::normal,
+     "Keep one instance of the CMDLINE wrapper <executable> running in"
+     " co-process mode and send it the runs, instead of a fork/exec each."
+     " Ignored if the wrapper does not support it. Can be repeated",
+     enableCoprocesses},
+    {"-m", "--cmdline-memo-ttl", cmd_line::OptFlag::overwrite, "<ms>",
+     cmd_line::ActFlag::normal,
+     "Time the output of a CMDLINE command is reused by the reads of the"
+     " same command line. 0 runs the command for every read",
+     setCmdlineMemoTtl},
     {"-t", "--running-threads", cmd_line::OptFlag::overwrite, "<num>",
      cmd_line::ActFlag::normal,
-     "Maximum number of simultaneous running event handling threads",
+     "Number of threads running event handlers",
      setRunningThreadLimit},
     {"-T", "--total-threads", cmd_line::OptFlag::overwrite, "<num>",
      cmd_line::ActFlag::normal,
-     "Maximum number of simultaneous running + queued event handling threads",
+     "Maximum number of simultaneous running + queued bootup threads",
      setTotalThreadLimit},
+    {"-w", "--worker-queue-size", cmd_line::OptFlag::overwrite, "<num>",
+     cmd_line::ActFlag::normal,
+     "Maximum number of event handling tasks waiting for a free thread",
+     setWorkerQueueSize},
+    {"-b", "--queue-batch-size", cmd_line::OptFlag::overwrite, "<num>",
+     cmd_line::ActFlag::normal,
+     "Maximum number of PropertiesChanged signals processed per worker wakeup",
+     setQueueBatchSize},
+    {"-q", "--queue-size", cmd_line::OptFlag::overwrite, "<num>",
+     cmd_line::ActFlag::normal,
+     "Capacity of the PropertiesChanged queue",
+     setQueueSize},
+    {"-Q", "--queue-overflow-policy", cmd_line::OptFlag::overwrite,
+     "<policy>", cmd_line::ActFlag::normal,
+     "What to do when the PropertiesChanged queue is full: "
+     "drop-newest (default), drop-oldest or block",
+     setQueueOverflowPolicy},
     {"-D", "--diagnostics-mode", cmd_line::OptFlag::none, "",
      cmd_line::ActFlag::normal,
      "Run in diagnostics mode. This performs a series of tests logging "
@@ -257,22 +414,407 @@ int showHelp()
     return 0;
 }
 
+/**
+ * @brief Compile the device id patterns of one accessor into the cache, and
+ *        its fields DataAccessor::contains() matches as regexes into
+ *        util::RegexCache
+ */
+static void preloadAccessorPatterns(const data_accessor::DataAccessor& acc)
+{
+    auto& cache = device_id::PatternCache::instance();
+    for (const auto& str :
+         {acc.getDbusObjectPath(), acc.getArguments(), acc.getDevice()})
+    {
+        if (!str.empty())
+        {
+            cache.preload(str);
+        }
+    }
+    auto& regexes = util::RegexCache::instance();
+    for (const auto& str :
+         {acc.getDbusObjectPath(), acc.getDbusInterface(), acc.getProperty(),
+          acc.getExecutable(), acc.getArguments()})
+    {
+        if (!str.empty())
+        {
+            regexes.preload(str);
+        }
+    }
+}
+
+/**
+ * @brief Compile the device id patterns found in the DAT json into the cache
+ *
+ * Device names, their associations and the object paths, arguments and
+ * device names of the test point accessors.
+ */
+static void preloadDatPatterns(const nlohmann::json& j)
+{
+    auto& cache = device_id::PatternCache::instance();
+    if (j.is_array())
+    {
+        for (const auto& elem : j)
+        {
+            preloadDatPatterns(elem);
+        }
+        return;
+    }
+    if (!j.is_object())
+    {
+        return;
+    }
+    for (const auto& [key, value] : j.items())
+    {
+        if (value.is_string() && (key == "object" || key == "arguments" ||
+                                  key == "device_name"))
+        {
+            cache.preload(value.get<std::string>());
+        }
+        else if (key == "association" && value.is_array())
+        {
+            for (const auto& device : value)
+            {
+                if (device.is_string())
+                {
+                    cache.preload(device.get<std::string>());
+                }
+            }
+        }
+        else
+        {
+            preloadDatPatterns(value);
+        }
+    }
+}
+
+/**
+ * @brief Pre-populate device_id::PatternCache and util::RegexCache from the
+ *        loaded profiles so that handling signals doesn't need to parse any
+ *        pattern
+ */
+static void preloadPatterns()
+{
+    auto& cache = device_id::PatternCache::instance();
+    for (const auto& [deviceType, events] : profile::eventMap)
+    {
+        for (const auto& event : events)
+        {
+            cache.preload(event.getStringifiedDeviceType());
+            for (const auto& type : event.deviceTypes)
+            {
+                cache.preload(type);
+            }
+            preloadAccessorPatterns(event.accessor);
+            preloadAccessorPatterns(event.trigger);
+            preloadAccessorPatterns(event.recovery_accessor);
+            preloadAccessorPatterns(event.counterReset);
+        }
+    }
+    for (const auto& [name, device] : profile::deviceAssociation.items())
+    {
+        cache.preload(name);
+        preloadDatPatterns(device);
+    }
+    logs_err("Device id pattern cache preloaded with %zu patterns, regex "
+             "cache with %zu regexes\n",
+             cache.stats().size, util::RegexCache::instance().stats().size);
+}
+
+/**
+ * @brief Per stage counters of @c dbus::DeadlineStats, keyed by stage name
+ */
+static std::map<std::string, uint64_t>
+    stageCounters(const std::array<size_t, dbus::stageCount>& counters)
+{
+    std::map<std::string, uint64_t> result;
+    for (size_t i = 0; i < dbus::stageCount; ++i)
+    {
+        result[dbus::stageName(static_cast<dbus::Stage>(i))] = counters[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Export the deadline counters as read-only properties of @c iface
+ */
+static void
+    registerDeadlineProperties(sdbusplus::asio::dbus_interface& iface)
+{
+    iface.register_property_r(
+        "DeadlineExpiredCalls", std::map<std::string, uint64_t>{},
+        sdbusplus::vtable::property_::none,
+        [](const std::map<std::string, uint64_t>&) {
+        return stageCounters(dbus::DeadlineScope::stats().expired);
+    });
+    iface.register_property_r(
+        "DeadlineTimedOutCalls", std::map<std::string, uint64_t>{},
+        sdbusplus::vtable::property_::none,
+        [](const std::map<std::string, uint64_t>&) {
+        return stageCounters(dbus::DeadlineScope::stats().timedOut);
+    });
+}
+
+using Counters = std::map<std::string, uint64_t>;
+
+static Counters queueCounters()
+{
+    auto stats = event_detection::queue->stats();
+    return Counters{{"DroppedNewest", stats.droppedNewest},
+                    {"DroppedOldest", stats.droppedOldest},
+                    {"BlockTimeouts", stats.blockTimeouts},
+                    {"BlockedPushes", stats.blockedPushes},
+                    {"Free", event_detection::queue->write_available()}};
+}
+
+static Counters workerPoolCounters()
+{
+    auto stats = event_detection::workerPool->stats();
+    return Counters{{"Workers", stats.workers},
+                    {"QueueDepth", stats.queueDepth},
+                    {"MaxQueueDepth", stats.maxQueueDepth},
+                    {"Submitted", stats.submitted},
+                    {"Completed", stats.completed},
+                    {"Rejected", stats.rejected},
+                    {"Stolen", stats.stolen},
+                    {"TotalWaitUs", stats.totalWaitUs},
+                    {"MaxWaitUs", stats.maxWaitUs},
+                    {"Lanes", stats.lanes},
+                    {"LaneQueueDepth", stats.laneQueueDepth}};
+}
+
+static Counters connectionCounters()
+{
+    auto stats = dbus::ConnectionPool::instance().stats();
+    return Counters{{"Opened", stats.opened},
+                    {"Reused", stats.reused},
+                    {"Dropped", stats.dropped},
+                    {"Open", stats.open}};
+}
+
+static Counters serviceCacheCounters()
+{
+    auto stats = dbus::ServiceCache::instance().stats();
+    return Counters{{"Hits", stats.hits},
+                    {"Misses", stats.misses},
+                    {"Invalidations", stats.invalidations},
+                    {"Size", stats.size}};
+}
+
+static Counters objectTreeCounters()
+{
+    auto stats = dbus::ObjectTree::shared()->stats();
+    return Counters{{"Queries", stats.queries},
+                    {"Refreshes", stats.refreshes},
+                    {"Updates", stats.updates},
+                    {"Objects", stats.objects}};
+}
+
+static Counters subscriptionCounters()
+{
+    const auto& plan = event_detection::subscriptionPlan;
+    return Counters{{"Subscriptions", plan.subscriptions()},
+                    {"Rules", plan.rules().size()},
+                    {"UnwantedSignals", plan.unwanted()}};
+}
+
+static Counters asyncReaderCounters()
+{
+    auto stats = dbus::AsyncReader::instance().stats();
+    return Counters{{"Issued", stats.issued},
+                    {"Completed", stats.completed},
+                    {"Failed", stats.failed},
+                    {"TimedOut", stats.timedOut},
+                    {"MaxInFlight", stats.maxInFlight}};
+}
+
+static Counters snapshotCounters()
+{
+    auto stats = dbus::PropertySnapshot::stats();
+    return Counters{{"Snapshots", stats.snapshots},
+                    {"GetManagedObjectsCalls", stats.managedObjectsCalls},
+                    {"GetAllCalls", stats.getAllCalls},
+                    {"Requested", stats.requested},
+                    {"Served", stats.served},
+                    {"CallsAvoided", stats.callsAvoided()}};
+}
+
+static Counters propertyStoreCounters()
+{
+    auto stats = dbus::PropertyStore::instance().stats();
+    return Counters{{"Hits", stats.hits},
+                    {"Misses", stats.misses},
+                    {"Stale", stats.stale},
+                    {"Updates", stats.updates},
+                    {"Size", stats.size}};
+}
+
+/**
+ * @brief "<executable>/<counter>" for every executable run so far
+ */
+static Counters subprocessCounters()
+{
+    Counters counters;
+    for (const auto& [executable, stats] :
+         subprocess::Runner::instance().stats())
+    {
+        counters[executable + "/Spawns"] = stats.spawns;
+        counters[executable + "/CoprocessRequests"] = stats.coprocessRequests;
+        counters[executable + "/CoprocessStarts"] = stats.coprocessStarts;
+        counters[executable + "/AverageUs"] = stats.averageUs();
+        counters[executable + "/MaxUs"] = stats.maxUs;
+        counters[executable + "/Timeouts"] = stats.timeouts;
+        counters[executable + "/Failures"] = stats.failures;
+        counters[executable + "/ExitPolls"] = stats.exitPolls;
+    }
+    return counters;
+}
+
+static Counters memoCounters()
+{
+    auto stats = subprocess::Memo::instance().stats();
+    return Counters{{"Runs", stats.runs}, {"Hits", stats.hits}};
+}
+
+static Counters patternCacheCounters()
+{
+    auto stats = device_id::PatternCache::instance().stats();
+    return Counters{{"Hits", stats.hits},
+                    {"Misses", stats.misses},
+                    {"Size", stats.size}};
+}
+
+/**
+ * @brief "<service>/<counter>" for every service called so far
+ */
+static Counters rateLimiterCounters()
+{
+    Counters counters;
+    for (const auto& [service, stats] : dbus::RateLimiter::instance().stats())
+    {
+        counters[service + "/Calls"] = stats.calls;
+        counters[service + "/Waited"] = stats.waited;
+        counters[service + "/WaitUs"] = stats.waitUs;
+        counters[service + "/MaxWaitUs"] = stats.maxWaitUs;
+        counters[service + "/TimedOut"] = stats.timedOut;
+        counters[service + "/InFlight"] = stats.inFlight;
+    }
+    return counters;
+}
+
+static Counters regexCacheCounters()
+{
+    auto stats = util::RegexCache::instance().stats();
+    return Counters{{"Hits", stats.hits},
+                    {"Misses", stats.misses},
+                    {"Size", stats.size}};
+}
+
+static Counters logCounters()
+{
+    return Counters{{"DroppedMessages", logger.droppedMessages()}};
+}
+
+/**
+ * @brief The counters of one component, read each time they are reported
+ */
+struct Statistics
+{
+    /** exported as the "<name>Statistics" property */
+    const char* name;
+    Counters (*read)();
+};
+
+/**
+ * @brief Every component keeping counters, reported at runtime by
+ *        registerStatisticsProperties() and at exit by logStatistics()
+ */
+static const std::array statistics = {
+    Statistics{"PropertiesChangedQueue", queueCounters},
+    Statistics{"WorkerPool", workerPoolCounters},
+    Statistics{"DbusConnections", connectionCounters},
+    Statistics{"ServiceCache", serviceCacheCounters},
+    Statistics{"ObjectTree", objectTreeCounters},
+    Statistics{"Subscriptions", subscriptionCounters},
+    Statistics{"RateLimiter", rateLimiterCounters},
+    Statistics{"AsyncReader", asyncReaderCounters},
+    Statistics{"PropertySnapshot", snapshotCounters},
+    Statistics{"PropertyStore", propertyStoreCounters},
+    Statistics{"Subprocess", subprocessCounters},
+    Statistics{"CmdlineMemo", memoCounters},
+    Statistics{"PatternCache", patternCacheCounters},
+    Statistics{"RegexCache", regexCacheCounters},
+    Statistics{"Log", logCounters}};
+
+/**
+ * @brief Export the counters of every component as read-only properties of
+ *        @c iface, the counters are read on every Get
+ */
+static void
+    registerStatisticsProperties(sdbusplus::asio::dbus_interface& iface)
+{
+    for (const auto& [name, read] : statistics)
+    {
+        iface.register_property_r(
+            std::string(name) + "Statistics", Counters{},
+            sdbusplus::vtable::property_::none,
+            [read = read](const Counters&) { return read(); });
+    }
+}
+
+/**
+ * @brief Log the counters of every component, one line per component
+ */
+static void logStatistics()
+{
+    for (const auto& [name, read] : statistics)
+    {
+        std::string line;
+        for (const auto& [counter, value] : read())
+        {
+            line += " " + counter + "=" + std::to_string(value);
+        }
+        logs_err("%s:%s\n", name, line.c_str());
+    }
+}
+
 // sd_bus* bus = nullptr;
 
 } // namespace eventing
 
+/** the worker thread, replaced by startWorkerThread() once it has returned */
+static std::thread workerThread;
+
 void startWorkerThread(std::shared_ptr<boost::asio::io_context> io)
 {
-    auto thread = std::make_unique<std::thread>([io]() {
+    if (workerThread.joinable())
+    {
+        workerThread.join();
+    }
+    workerThread = std::thread([io]() {
         logs_err("Creating worker thread\n");
         event_detection::EventDetection::workerThreadMainLoop();
+        if (event_detection::EventDetection::workerThreadStopped())
+        {
+            return;
+        }
         // the main loop exited for whatever reason, so
         // queue a task to the main thread to restart the worker thread
         logs_err(
             "worker thread event loop exited unexpectedly, restarting it\n");
         io->post([io]() { startWorkerThread(io); });
     });
-    thread->detach();
+}
+
+/**
+ * @brief Stops the worker thread and waits for it to return
+ */
+void stopWorkerThread()
+{
+    event_detection::EventDetection::stopWorkerThread();
+    if (workerThread.joinable())
+    {
+        workerThread.join();
+    }
 }
 
 #ifdef EVENTING_FEATURE_ONLY
@@ -280,10 +822,11 @@ void startWorkerThread(std::shared_ptr<boost::asio::io_context> io)
  * @brief Runs the BootUp Event detection on a separated Thread
  * 
  * @param eventDetection
+ * @return the thread, to be joined before exiting
  */
-void  bootUpEventsDetection(event_detection::EventDetection& eventDetection)
+std::thread bootUpEventsDetection(event_detection::EventDetection& eventDetection)
 {
-    auto thread = std::make_unique<std::thread>([eventDetection]() mutable {        
+    return std::thread([eventDetection]() mutable {
         logs_wrn("started bootup eventing detection \n");
         ThreadpoolGuard guard(event_detection::threadpoolManager.get());
         if (!guard.was_successful())
@@ -296,15 +839,6 @@ void  bootUpEventsDetection(event_detection::EventDetection& eventDetection)
         }       
         eventDetection.bootUpEventsDetection();
     });
-    
-    if (thread != nullptr)
-    {
-        thread->detach();
-    }
-    else
-    {
-        logs_err("Create thread to process event failed!\n");
-    }    
 }
 #endif // EVENTING_FEATURE_ONLY
 
@@ -336,6 +870,9 @@ int main(int argc, char* argv[])
 {
     int rc = 0;
     logger.setLevel(DEF_DBG_LEVEL);
+    // the handlers only copy their messages, a thread writes them
+    logger.setAsync(true);
+    logger.flushOnCrash();
     logs_info("Default log level: %d. Current log level: %d\n", DEF_DBG_LEVEL,
               getLogLevel(logger.getLevel()));
 
@@ -405,13 +942,23 @@ int main(int argc, char* argv[])
     event_detection::threadpoolManager = std::make_unique<ThreadpoolManager>(
         eventing::configuration.running_thread_limit,
         eventing::configuration.total_thread_limit);
+    event_detection::workerPool = std::make_unique<WorkerPool>(
+        eventing::configuration.running_thread_limit,
+        eventing::configuration.worker_queue_size);
 
-    event_detection::queue =
-        std::make_unique<PcQueueType>(PROPERTIESCHANGED_QUEUE_SIZE);
+    event_detection::queue = std::make_unique<PcQueueType>(
+        eventing::configuration.queue_size,
+        eventing::configuration.queue_overflow_policy,
+        std::chrono::milliseconds(PROPERTIESCHANGED_QUEUE_BLOCK_TIMEOUT_MS));
+    event_detection::queueMaxBatchSize =
+        eventing::configuration.queue_batch_size;
 
     event_detection::eventTriggerView = eventing::profile::eventTriggerView;
     event_detection::eventAccessorView = eventing::profile::eventAccessorView;
     event_detection::eventRecoveryView = eventing::profile::eventRecoveryView;
+    event_detection::dispatchIndex.build(event_detection::eventTriggerView,
+                                         event_detection::eventRecoveryView);
+    eventing::preloadPatterns();
 
 #ifdef EVENTING_SERVICE_DEVICE_STATUS_FS
     event_handler::DeviceStatusHandler deviceStatus("DeviceStatus");
@@ -432,67 +979,6 @@ int main(int argc, char* argv[])
         &eventing::profile::propertyFilterSet, &eventHdlrMgr);
 
 #ifndef EVENTING_FEATURE_ONLY
-    auto thread = std::make_unique<std::thread>([rep_res, selftest,
-                                                 eventDetection]() mutable {
-        PROFILING_SWITCH(selftest::TsLatcher TS("bootup-selftest"));
-        logs_wrn("started bootup selftest\n");
-        ThreadpoolGuard guard(event_detection::threadpoolManager.get());
-        if (!guard.was_successful())
-        {
-            // the threadpool has reached the max queued tasks limit,
-            // don't run this event thread
-            logs_err(
-                "Thread pool over maxTotal tasks limit, exiting bootup selftest thread\n");
-            return;
-        }
-
-        bool reEvalLogs = isHmcBootup();      
-        if (false == reEvalLogs)
-        {
-            logs_err(
-                "Did not detect HMC Boot-up. Will not resolve all logs.\n");          
-        }
-        else
-        {
-            logs_err(
-                "HMC Boot-up detected. All logs will be resolved. Logs will be "
-                "regenerated for active conditions based on Self Test.\n");           
-        }
-
-        if (selftest.performEntireTree(rep_res,
-                                       std::vector<std::string>{"data_dump"},
-                                       reEvalLogs) != eventing::RcCode::succ)
-        {
-            logs_err("Bootup Selftest failed\n");
-            return;
-        }
-        for (const auto& entry : rep_res)
-        {
-            logs_dbg("SelfTest Device: %s\n", entry.first.c_str());
-            if (selftest.evaluateDevice(entry.second))
-            {
-                logs_dbg("Device %s healthy based on SelfTest.\n",
-                         entry.first.c_str());
-            }
-            else
-            {
-                logs_err(
-                    "SelfTest for Device %s failed. One or more event logs have been created for this device.\n",
-                    entry.first.c_str());
-            }
-        }
-        logs_err("finished bootup selftest\n");
-    });
-
-    if (thread != nullptr)
-    {
-        thread->detach();
-    }
-    else
-    {
-        logs_err("Create thread to process event failed!\n");
-    }
-
     /* Event handlers registration order is important - msgComposer uses data
     acquired by previous handlers; handlers are used in registration order. */
     eventHdlrMgr.RegisterHandler(&rootCauseTracer);
@@ -512,10 +998,26 @@ int main(int argc, char* argv[])
         logs_dbg("Failed to connect to system bus\n");
     }
 
+    // outlives the connections, which are dropped when the threads are joined
+    auto io = std::make_shared<boost::asio::io_context>();
+    // the threads started below use the globals, stop them before exiting
+    std::thread seedThread;
+    std::thread bootupThread;
+    auto stopThreads = [&seedThread, &bootupThread]() {
+        // io no longer runs, read synchronously until the threads return
+        dbus::AsyncReader::instance().setConnection(nullptr);
+        for (auto* thread : {&seedThread, &bootupThread})
+        {
+            if (thread->joinable())
+            {
+                thread->join();
+            }
+        }
+        stopWorkerThread();
+    };
+
     try
     {
-        auto io = std::make_shared<boost::asio::io_context>();
-
         startWorkerThread(io);
 
         auto sdbusp =
@@ -525,16 +1027,93 @@ int main(int argc, char* argv[])
         auto server = sdbusplus::asio::object_server(sdbusp);
         auto iface = server.add_interface(mon_evt::TOP_OBJPATH,
                                           mon_evt::SERVICE_IFCNAME);
+        // the subscription plan counts objects in the tree
+        auto objectTreeMatcher = dbus::ObjectTree::shared()->subscribe(sdbusp);
         auto eventMatcher =
             eventDetection.startEventDetection(&eventDetection, sdbusp);
+        // this thread runs io, the others read through it concurrently
+        dbus::AsyncReader::instance().setConnection(sdbusp);
+        // the subscriptions are up, signals received meanwhile win
+        seedThread =
+            std::thread([]() { dbus::PropertyStore::instance().seed(); });
+
+#ifndef EVENTING_FEATURE_ONLY
+        // the selftest queries the object tree, start it once the tree is
+        // subscribed to so no change is missed after the first load
+        bootupThread = std::thread([rep_res, selftest,
+                                    eventDetection]() mutable {
+            PROFILING_SWITCH(selftest::TsLatcher TS("bootup-selftest"));
+            logs_wrn("started bootup selftest\n");
+            ThreadpoolGuard guard(event_detection::threadpoolManager.get());
+            if (!guard.was_successful())
+            {
+                // the threadpool has reached the max queued tasks limit,
+                // don't run this event thread
+                logs_err(
+                    "Thread pool over maxTotal tasks limit, exiting bootup selftest thread\n");
+                return;
+            }
 
+            bool reEvalLogs = isHmcBootup();
+            if (false == reEvalLogs)
+            {
+                logs_err(
+                    "Did not detect HMC Boot-up. Will not resolve all logs.\n");
+            }
+            else
+            {
+                logs_err(
+                    "HMC Boot-up detected. All logs will be resolved. Logs will be "
+                    "regenerated for active conditions based on Self Test.\n");
+            }
+
+            if (selftest.performEntireTree(rep_res,
+                                           std::vector<std::string>{"data_dump"},
+                                           reEvalLogs) != eventing::RcCode::succ)
+            {
+                logs_err("Bootup Selftest failed\n");
+                return;
+            }
+            for (const auto& entry : rep_res)
+            {
+                logs_dbg("SelfTest Device: %s\n", entry.first.c_str());
+                if (selftest.evaluateDevice(entry.second))
+                {
+                    logs_dbg("Device %s healthy based on SelfTest.\n",
+                             entry.first.c_str());
+                }
+                else
+                {
+                    logs_err(
+                        "SelfTest for Device %s failed. One or more event logs have been created for this device.\n",
+                        entry.first.c_str());
+                }
+            }
+            logs_err("finished bootup selftest\n");
+        });
+#endif // EVENTING_FEATURE_ONLY
+
+        eventing::registerDeadlineProperties(*iface);
+        eventing::registerStatisticsProperties(*iface);
         iface->initialize();
 
+        // stop io on an orderly shutdown, so the pool drains and the
+        // statistics and the log are written before exiting
+        boost::asio::signal_set signals(*io, SIGINT, SIGTERM);
+        signals.async_wait([io](const boost::system::error_code& ec,
+                                int signal) {
+            if (!ec)
+            {
+                logs_err("Received signal %d, shutting down\n", signal);
+                io->stop();
+            }
+        });
+
 #ifdef EVENTING_FEATURE_ONLY
         if (isHmcBootup())
         {
             logs_err("Performing Eventing Bootup initial checks.\n");
-            bootUpEventsDetection(eventDetection);
+            bootupThread = bootUpEventsDetection(eventDetection);
         }
         else
         {
@@ -548,8 +1127,15 @@ int main(int argc, char* argv[])
     catch (const std::exception& e)
     {
         logs_err("%s\n", e.what());
+        stopThreads();
+        event_detection::workerPool->shutdown(false);
         return -1;
     }
 
+    stopThreads();
+    // the queued tasks refer to eventDetection, finish them while it exists
+    event_detection::workerPool->shutdown();
+    eventing::logStatistics();
+    logger.setAsync(false);
     return 0;
 }
@@ -26,7 +26,7 @@ static void evalJson(const device_id::PatternIndex& index,
         auto str = jsonPattern.get<std::string>();
         try
         {
-            result = device_id::DeviceIdPattern(str).eval(index);
+            result = device_id::cachedPattern(str)->eval(index);
         }
         catch (const std::exception& e)
         {
@@ -10,9 +10,804 @@
 
 #include "log.hpp"
 
+#include <signal.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+
 namespace logging
 {
 
+int formatTo(char* buffer, size_t size, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    auto length = vsnprintf(buffer, size, fmt, args);
+    va_end(args);
+    return length;
+}
+
+namespace
+{
+
+/** printf of one conversion @c spec into @c out */
+template <typename T>
+void appendFormatted(std::string& out, const std::string& spec, T value)
+{
+    char buffer[256];
+    auto length = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+    if (length < 0)
+    {
+        return;
+    }
+    if (static_cast<size_t>(length) < sizeof(buffer))
+    {
+        out.append(buffer, static_cast<size_t>(length));
+        return;
+    }
+    std::string large(static_cast<size_t>(length) + 1, '\0');
+    snprintf(large.data(), large.size(), spec.c_str(), value);
+    out.append(large.data(), static_cast<size_t>(length));
+}
+
+/** reads the arguments LogRecord::capture() stored */
+class ArgReader
+{
+  public:
+    explicit ArgReader(const LogRecord& record) : _record(record)
+    {}
+
+    bool next(LogRecord::Arg& arg)
+    {
+        if (_offset >= _record.size)
+        {
+            return false;
+        }
+        arg = static_cast<LogRecord::Arg>(_record.payload[_offset++]);
+        return true;
+    }
+
+    template <typename T>
+    T value()
+    {
+        T value;
+        memcpy(&value, _record.payload + _offset, sizeof(value));
+        _offset += sizeof(value);
+        return value;
+    }
+
+    std::string str()
+    {
+        auto length = value<uint16_t>();
+        std::string str(_record.payload + _offset, length);
+        _offset += length;
+        return str;
+    }
+
+    /** the next argument as an integer, 0 if it is not one */
+    int64_t integer()
+    {
+        LogRecord::Arg arg;
+        if (!next(arg))
+        {
+            return 0;
+        }
+        switch (arg)
+        {
+            case LogRecord::Arg::sint:
+                return value<int64_t>();
+            case LogRecord::Arg::uint:
+                return static_cast<int64_t>(value<uint64_t>());
+            case LogRecord::Arg::real:
+                value<double>();
+                return 0;
+            case LogRecord::Arg::longReal:
+                value<long double>();
+                return 0;
+            case LogRecord::Arg::str:
+                str();
+                return 0;
+            case LogRecord::Arg::ptr:
+                return static_cast<int64_t>(value<uintptr_t>());
+        }
+        return 0;
+    }
+
+  private:
+    const LogRecord& _record;
+    size_t _offset = 0;
+};
+
+/** @c value converted as the caller's argument was */
+template <typename Signed, typename Unsigned>
+void appendAs(std::string& out, const std::string& spec, bool isSigned,
+              int64_t value)
+{
+    if (isSigned)
+    {
+        appendFormatted(out, spec, static_cast<Signed>(value));
+    }
+    else
+    {
+        appendFormatted(out, spec, static_cast<Unsigned>(value));
+    }
+}
+
+/** an integer conversion, @c length the printf length modifier */
+void appendInteger(std::string& out, const std::string& spec,
+                   const std::string& length, bool isSigned, int64_t value)
+{
+    if (length == "hh")
+    {
+        appendAs<signed char, unsigned char>(out, spec, isSigned, value);
+    }
+    else if (length == "h")
+    {
+        appendAs<short, unsigned short>(out, spec, isSigned, value);
+    }
+    else if (length == "l")
+    {
+        appendAs<long, unsigned long>(out, spec, isSigned, value);
+    }
+    else if (length == "ll" || length == "q")
+    {
+        appendAs<long long, unsigned long long>(out, spec, isSigned, value);
+    }
+    else if (length == "j")
+    {
+        appendAs<intmax_t, uintmax_t>(out, spec, isSigned, value);
+    }
+    else if (length == "z")
+    {
+        appendAs<ssize_t, size_t>(out, spec, isSigned, value);
+    }
+    else if (length == "t")
+    {
+        appendAs<ptrdiff_t, size_t>(out, spec, isSigned, value);
+    }
+    else
+    {
+        appendAs<int, unsigned>(out, spec, isSigned, value);
+    }
+}
+
+} // namespace
+
+std::string formatRecord(const LogRecord& record)
+{
+    if (record.text)
+    {
+        return std::string(record.payload, record.size);
+    }
+    std::string out;
+    ArgReader args(record);
+    for (const char* c = record.fmt; *c != '\0'; ++c)
+    {
+        if (*c != '%')
+        {
+            out.push_back(*c);
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            out.push_back('%');
+            ++c;
+            continue;
+        }
+        // %[flags][width][.precision][length]conversion, '*' resolved
+        std::string spec{"%"};
+        ++c;
+        while (*c != '\0' && strchr("-+ #0'", *c) != nullptr)
+        {
+            spec.push_back(*c++);
+        }
+        if (*c == '*')
+        {
+            auto width = args.integer();
+            spec += width < 0 ? "-" + std::to_string(-width)
+                              : std::to_string(width);
+            ++c;
+        }
+        while (isdigit(*c))
+        {
+            spec.push_back(*c++);
+        }
+        if (*c == '.')
+        {
+            ++c;
+            if (*c == '*')
+            {
+                auto precision = args.integer();
+                if (precision >= 0)
+                {
+                    spec += "." + std::to_string(precision);
+                }
+                ++c;
+            }
+            else
+            {
+                spec.push_back('.');
+            }
+            while (isdigit(*c))
+            {
+                spec.push_back(*c++);
+            }
+        }
+        std::string length;
+        while (*c != '\0' && strchr("hljztLq", *c) != nullptr)
+        {
+            length.push_back(*c++);
+        }
+        if (*c == '\0')
+        {
+            break;
+        }
+        spec += length;
+        spec.push_back(*c);
+
+        LogRecord::Arg arg;
+        if (*c == 'n' || !args.next(arg))
+        {
+            continue;
+        }
+        switch (arg)
+        {
+            case LogRecord::Arg::sint:
+            case LogRecord::Arg::uint:
+            {
+                auto value = arg == LogRecord::Arg::sint
+                                 ? args.value<int64_t>()
+                                 : static_cast<int64_t>(
+                                       args.value<uint64_t>());
+                if (strchr("diouxXc", *c) != nullptr)
+                {
+                    appendInteger(out, spec, length,
+                                  *c == 'd' || *c == 'i' || *c == 'c', value);
+                }
+                else if (strchr("fFeEgGaA", *c) != nullptr)
+                {
+                    appendFormatted(out, spec, static_cast<double>(value));
+                }
+                else
+                {
+                    out += "(?)";
+                }
+                break;
+            }
+            case LogRecord::Arg::real:
+            case LogRecord::Arg::longReal:
+            {
+                long double value = arg == LogRecord::Arg::real
+                                        ? args.value<double>()
+                                        : args.value<long double>();
+                if (strchr("fFeEgGaA", *c) == nullptr)
+                {
+                    out += "(?)";
+                }
+                else if (length == "L")
+                {
+                    appendFormatted(out, spec, value);
+                }
+                else
+                {
+                    appendFormatted(out, spec, static_cast<double>(value));
+                }
+                break;
+            }
+            case LogRecord::Arg::str:
+            {
+                auto value = args.str();
+                if (*c == 's')
+                {
+                    appendFormatted(out, spec, value.c_str());
+                }
+                else
+                {
+                    out += "(?)";
+                }
+                break;
+            }
+            case LogRecord::Arg::ptr:
+            {
+                auto value = args.value<uintptr_t>();
+                if (*c == 'p')
+                {
+                    appendFormatted(out, spec, reinterpret_cast<void*>(value));
+                }
+                else if (strchr("diouxX", *c) != nullptr)
+                {
+                    appendInteger(out, spec, length, false,
+                                  static_cast<int64_t>(value));
+                }
+                else
+                {
+                    out += "(?)";
+                }
+                break;
+            }
+        }
+    }
+    // as the synchronous mode, which formats into 1024 chars
+    if (out.size() > 1023)
+    {
+        out.resize(1023);
+    }
+    return out;
+}
+
+namespace
+{
+
+/** the Log crashFlush() writes, see Log::flushOnCrash() */
+std::atomic<Log*> crashLog{nullptr};
+
+/** large enough for crashFlush(), SIGSTKSZ is not a constant anymore */
+constexpr size_t altStackSize = 64 * 1024;
+
+/** the alternate stack of the calling thread, released when it exits */
+void useAltStack()
+{
+    struct AltStack
+    {
+        std::unique_ptr<char[]> memory;
+
+        ~AltStack()
+        {
+            if (memory)
+            {
+                stack_t stack = {};
+                stack.ss_flags = SS_DISABLE;
+                ::sigaltstack(&stack, nullptr);
+            }
+        }
+    };
+    thread_local AltStack altStack;
+    if (altStack.memory)
+    {
+        return;
+    }
+    altStack.memory = std::make_unique<char[]>(altStackSize);
+    stack_t stack = {};
+    stack.ss_sp = altStack.memory.get();
+    stack.ss_size = altStackSize;
+    if (::sigaltstack(&stack, nullptr) != 0)
+    {
+        altStack.memory.reset();
+    }
+}
+
+/** buffered write(2), only what is async-signal-safe */
+class CrashWriter
+{
+  public:
+    explicit CrashWriter(int fd) : _fd(fd)
+    {}
+
+    ~CrashWriter()
+    {
+        flush();
+    }
+
+    void put(const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            put(data[i]);
+        }
+    }
+
+    void put(const char* str)
+    {
+        put(str, strlen(str));
+    }
+
+    void put(char c)
+    {
+        if (_size == sizeof(_buffer))
+        {
+            flush();
+        }
+        _buffer[_size++] = c;
+    }
+
+    void number(uint64_t value, unsigned base = 10, int width = 1)
+    {
+        char digits[24];
+        int count = 0;
+        do
+        {
+            digits[count++] = "0123456789abcdef"[value % base];
+            value /= base;
+        } while (value != 0 && count < static_cast<int>(sizeof(digits)));
+        for (; width > count; --width)
+        {
+            put('0');
+        }
+        while (count > 0)
+        {
+            put(digits[--count]);
+        }
+    }
+
+    /** "[MM/DD/YY HH:MM:SS.nanosecs]" as Log::prefix(), without gmtime_r() */
+    void time(const struct timespec& ts)
+    {
+        auto days = static_cast<int64_t>(ts.tv_sec) / 86400;
+        auto seconds = static_cast<int64_t>(ts.tv_sec) % 86400;
+        // civil date of days since 1970-01-01, proleptic Gregorian
+        days += 719468;
+        auto era = days / 146097;
+        auto dayOfEra = days - era * 146097;
+        auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                          dayOfEra / 146096) /
+                         365;
+        auto dayOfYear =
+            dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+        auto day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        auto month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+        auto year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+        put('[');
+        number(static_cast<uint64_t>(month), 10, 2);
+        put('/');
+        number(static_cast<uint64_t>(day), 10, 2);
+        put('/');
+        number(static_cast<uint64_t>(year % 100), 10, 2);
+        put(' ');
+        number(static_cast<uint64_t>(seconds / 3600), 10, 2);
+        put(':');
+        number(static_cast<uint64_t>(seconds / 60 % 60), 10, 2);
+        put(':');
+        number(static_cast<uint64_t>(seconds % 60), 10, 2);
+        put('.');
+        number(static_cast<uint64_t>(ts.tv_nsec), 10, 9);
+        put(']');
+    }
+
+    /** the arguments LogRecord::capture() stored, as they are */
+    void arguments(const LogRecord& record)
+    {
+        size_t offset = 0;
+        auto read = [&record, &offset](auto& value) {
+            memcpy(&value, record.payload + offset, sizeof(value));
+            offset += sizeof(value);
+        };
+        put(" <-");
+        while (offset < record.size)
+        {
+            auto arg = static_cast<LogRecord::Arg>(record.payload[offset++]);
+            put(' ');
+            switch (arg)
+            {
+                case LogRecord::Arg::sint:
+                {
+                    int64_t value;
+                    read(value);
+                    if (value < 0)
+                    {
+                        put('-');
+                    }
+                    number(value < 0 ? 0 - static_cast<uint64_t>(value)
+                                     : static_cast<uint64_t>(value));
+                    break;
+                }
+                case LogRecord::Arg::uint:
+                {
+                    uint64_t value;
+                    read(value);
+                    number(value);
+                    break;
+                }
+                case LogRecord::Arg::ptr:
+                {
+                    uintptr_t value;
+                    read(value);
+                    put("0x");
+                    number(value, 16);
+                    break;
+                }
+                case LogRecord::Arg::str:
+                {
+                    uint16_t length;
+                    read(length);
+                    put('"');
+                    put(record.payload + offset, length);
+                    put('"');
+                    offset += length;
+                    break;
+                }
+                case LogRecord::Arg::real:
+                case LogRecord::Arg::longReal:
+                {
+                    // the bytes, formatting a float is not signal-safe
+                    auto size = arg == LogRecord::Arg::real
+                                    ? sizeof(double)
+                                    : sizeof(long double);
+                    put("real:");
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        number(static_cast<uint8_t>(
+                                   record.payload[offset + i]),
+                               16, 2);
+                    }
+                    offset += size;
+                    break;
+                }
+                default:
+                    // not a record capture() wrote
+                    put('?');
+                    return;
+            }
+        }
+    }
+
+    void flush()
+    {
+        size_t written = 0;
+        while (written < _size)
+        {
+            auto rc = ::write(_fd, _buffer + written, _size - written);
+            if (rc < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (rc <= 0)
+            {
+                break;
+            }
+            written += static_cast<size_t>(rc);
+        }
+        _size = 0;
+    }
+
+  private:
+    int _fd;
+    char _buffer[512];
+    size_t _size = 0;
+};
+
+void flushAndReraise(int signal)
+{
+    auto errnoSaved = errno;
+    auto* log = crashLog.load(std::memory_order_acquire);
+    if (log != nullptr)
+    {
+        log->crashFlush(signal);
+    }
+    errno = errnoSaved;
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(signal, &action, nullptr);
+    ::raise(signal);
+}
+
+} // namespace
+
+// Log ////////////////////////////////////////////////////////////////////////
+
+uint64_t Log::nextId()
+{
+    static std::atomic<uint64_t> id{0};
+    return ++id;
+}
+
+LogRing& Log::threadRing()
+{
+    // the last Log the thread logged to, mostly the only one
+    thread_local uint64_t owner = 0;
+    thread_local std::shared_ptr<LogRing> ring;
+    if (owner != _id || !ring)
+    {
+        std::lock_guard lock(_ringsMutex);
+        auto& threadRing = _rings[std::this_thread::get_id()];
+        if (!threadRing)
+        {
+            threadRing = std::make_shared<LogRing>(_ringSlots);
+            threadRing->next = _lastRing.load(std::memory_order_relaxed);
+            _lastRing.store(threadRing.get(), std::memory_order_release);
+        }
+        if (crashLog.load(std::memory_order_relaxed) == this)
+        {
+            useAltStack();
+        }
+        ring = threadRing;
+        owner = _id;
+    }
+    return *ring;
+}
+
+std::string Log::prefix(int level, const struct timespec& ts) const
+{
+    char time[100] = {0};
+    struct tm tm;
+    strftime(time, sizeof(time), "%D %T", gmtime_r(&ts.tv_sec, &tm));
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "[%s.%09ld]", time, ts.tv_nsec);
+    return std::string(buffer) + severity(level);
+}
+
+char Log::severity(int level)
+{
+    switch (getLogLevel(level))
+    {
+        case LogLevel::error:
+            return 'E';
+        case LogLevel::warning:
+            return 'W';
+        case LogLevel::debug:
+            return 'D';
+        case LogLevel::information:
+            return 'I';
+        default:
+            return 'O';
+    }
+}
+
+void Log::setAsync(bool enable, size_t ringSlots)
+{
+    std::unique_lock lock(_writerMutex);
+    if (enable)
+    {
+        _ringSlots = ringSlots;
+        if (_writer.joinable())
+        {
+            return;
+        }
+        _stop = false;
+        _async = true;
+        _writer = std::thread([this]() {
+            const std::chrono::milliseconds interval(LOG_FLUSH_INTERVAL_MS);
+            std::unique_lock lock(_writerMutex);
+            while (!_stop)
+            {
+                _wake.wait_for(lock, interval);
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        });
+        return;
+    }
+    if (!_writer.joinable())
+    {
+        return;
+    }
+    _async = false;
+    _stop = true;
+    lock.unlock();
+    _wake.notify_one();
+    _writer.join();
+    flush();
+}
+
+void Log::flush()
+{
+    std::scoped_lock flushLock(_flushMutex);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::scoped_lock lock(_ringsMutex);
+        for (const auto& [thread, ring] : _rings)
+        {
+            rings.push_back(ring);
+        }
+    }
+
+    // in call order across the threads
+    std::vector<std::pair<const LogRecord*, LogRing*>> records;
+    std::vector<size_t> counts;
+    for (const auto& ring : rings)
+    {
+        counts.push_back(ring->size());
+        for (size_t i = 0; i < counts.back(); ++i)
+        {
+            records.emplace_back(&ring->at(i), ring.get());
+        }
+    }
+    std::sort(records.begin(), records.end(),
+              [](const auto& a, const auto& b) {
+                  return a.first->seq < b.first->seq;
+              });
+    std::string out;
+    for (const auto& [record, ring] : records)
+    {
+        out += prefix(record->level, record->time);
+        out += formatRecord(*record);
+    }
+    for (size_t i = 0; i < rings.size(); ++i)
+    {
+        rings[i]->pop(counts[i]);
+    }
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _droppedReported)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        out += prefix(LogLevel::warning, now) + "[log]: " +
+               std::to_string(dropped - _droppedReported) +
+               " messages dropped, the log ring of their thread was full\n";
+        _droppedReported = dropped;
+    }
+    if (out.empty())
+    {
+        return;
+    }
+
+    std::scoped_lock logGuard(lMutex);
+    outputLog(out);
+}
+
+void Log::flushOnCrash()
+{
+    crashLog.store(this, std::memory_order_release);
+    useAltStack();
+    struct sigaction action = {};
+    action.sa_handler = flushAndReraise;
+    sigemptyset(&action.sa_mask);
+    // a fault inside the handler kills the process instead of looping
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND | SA_NODEFER;
+    for (auto signal : {SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL})
+    {
+        ::sigaction(signal, &action, nullptr);
+    }
+}
+
+void Log::stopCrashFlush()
+{
+    Log* self = this;
+    crashLog.compare_exchange_strong(self, nullptr);
+}
+
+void Log::crashFlush(int signal) const
+{
+    CrashWriter out(_crashFd.load(std::memory_order_relaxed));
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    out.time(now);
+    out.put("E[log]: signal ");
+    out.number(static_cast<uint64_t>(signal));
+    out.put(", the messages not written yet follow, thread by thread\n");
+    for (auto* ring = _lastRing.load(std::memory_order_acquire);
+         ring != nullptr; ring = ring->next)
+    {
+        auto size = ring->size();
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto& record = ring->at(i);
+            out.time(record.time);
+            out.put(severity(record.level));
+            if (record.text)
+            {
+                out.put(record.payload, record.size);
+                if (record.size == 0 || record.payload[record.size - 1] != '\n')
+                {
+                    out.put('\n');
+                }
+                continue;
+            }
+            auto length = strlen(record.fmt);
+            if (length != 0 && record.fmt[length - 1] == '\n')
+            {
+                --length;
+            }
+            out.put(record.fmt, length);
+            out.arguments(record);
+            out.put('\n');
+        }
+    }
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != 0)
+    {
+        out.time(now);
+        out.put("W[log]: ");
+        out.number(dropped);
+        out.put(" messages dropped in all, the log ring of their thread was "
+                "full\n");
+    }
+}
+
 #if defined(LOG_ELAPSED_TIME)
 // initialize static variables
 int  LogElapsedTime::_deep = -1;
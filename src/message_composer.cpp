@@ -13,6 +13,7 @@
 
 #include "common.hpp"
 #include "dbus_accessor.hpp"
+#include "deadline.hpp"
 #include "event_handler.hpp"
 #include "event_info.hpp"
 
@@ -22,6 +23,7 @@
 #include <sdbusplus/exception.hpp>
 
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <map>
@@ -49,10 +51,10 @@ MessageComposer::~MessageComposer()
 
 bool MessageComposer::createLog(event_info::EventNode& event)
 {
-    auto bus = sdbusplus::bus::new_default_system();
-    auto method = bus.new_method_call(
-        "xyz.openbmc_project.Logging", "/xyz/openbmc_project/logging",
-        "xyz.openbmc_project.Logging.Create", "Create");
+    auto bus = dbus::connection(dbus::BusType::systemBus);
+    dbus::DelayedMethod method(bus, "xyz.openbmc_project.Logging",
+                               "/xyz/openbmc_project/logging",
+                               "xyz.openbmc_project.Logging.Create", "Create");
     method.append(event.event);
     method.append(makeSeverity(event.getSeverity()));
 
@@ -88,13 +90,19 @@ bool MessageComposer::createLog(event_info::EventNode& event)
                                 ? "property_change"
                                 : "other"}}}));
 
+    // the log is created even if the telemetries used up the deadline
+    dbus::DeadlineScope logging(
+        dbus::DeadlineScope::current().atLeast(
+            std::chrono::milliseconds(EVENT_LOG_MIN_TIMEOUT_MS)),
+        dbus::Stage::logging);
     try
     {
-        bus.call(method);
+        method.call();
         return true;
     }
     catch (const sdbusplus::exception::SdBusError& e)
     {
+        dbus::ConnectionPool::instance().failed(e, dbus::BusType::systemBus);
         std::cerr << "ERROR CREATING LOG " << e.what() << "\n";
         log<level::ERR>("Failed to create log for event",
                         entry("SDBUSERR=%s", e.what()));
@@ -0,0 +1,546 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "object_tree.hpp"
+
+#include "dbus_accessor.hpp"
+#include "log.hpp"
+#include "service_cache.hpp"
+
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/message/native_types.hpp>
+
+#include <algorithm>
+#include <mutex>
+
+namespace dbus
+{
+
+std::shared_ptr<ObjectTree> ObjectTree::shared()
+{
+    static auto tree = std::make_shared<ObjectTree>();
+    return tree;
+}
+
+std::vector<std::unique_ptr<sdbusplus::bus::match_t>>
+    ObjectTree::subscribe(std::shared_ptr<sdbusplus::asio::connection> conn)
+{
+    namespace rules = sdbusplus::bus::match::rules;
+    auto& bus = static_cast<sdbusplus::bus::bus&>(*conn);
+    std::vector<std::unique_ptr<sdbusplus::bus::match_t>> matches;
+
+    matches.push_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, rules::interfacesAdded(),
+        [this](sdbusplus::message::message& msg) {
+            sdbusplus::message::object_path objectPath;
+            std::map<std::string, std::map<std::string, PropertyVariant>>
+                interfacesProperties;
+            try
+            {
+                msg.read(objectPath, interfacesProperties);
+            }
+            catch (const sdbusplus::exception::exception& e)
+            {
+                logs_dbg("ObjectTree: unreadable InterfacesAdded: %s\n",
+                         e.what());
+                markStale();
+                ServiceCache::instance().clear();
+                return;
+            }
+            std::vector<std::string> interfaces;
+            for (const auto& [interface, properties] : interfacesProperties)
+            {
+                interfaces.push_back(interface);
+            }
+            ServiceCache::instance().invalidatePath(objectPath.str);
+            interfacesAdded(objectPath.str, msg.get_sender(), interfaces);
+        }));
+
+    matches.push_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, rules::interfacesRemoved(),
+        [this](sdbusplus::message::message& msg) {
+            sdbusplus::message::object_path objectPath;
+            std::vector<std::string> interfaces;
+            try
+            {
+                msg.read(objectPath, interfaces);
+            }
+            catch (const sdbusplus::exception::exception& e)
+            {
+                logs_dbg("ObjectTree: unreadable InterfacesRemoved: %s\n",
+                         e.what());
+                markStale();
+                ServiceCache::instance().clear();
+                return;
+            }
+            ServiceCache::instance().invalidatePath(objectPath.str);
+            interfacesRemoved(objectPath.str, msg.get_sender(), interfaces);
+        }));
+
+    matches.push_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus, rules::nameOwnerChanged(),
+        [this](sdbusplus::message::message& msg) {
+            std::string name;
+            std::string oldOwner;
+            std::string newOwner;
+            try
+            {
+                msg.read(name, oldOwner, newOwner);
+            }
+            catch (const sdbusplus::exception::exception& e)
+            {
+                logs_dbg("ObjectTree: unreadable NameOwnerChanged: %s\n",
+                         e.what());
+                markStale();
+                ServiceCache::instance().clear();
+                return;
+            }
+            auto& serviceCache = ServiceCache::instance();
+            serviceCache.invalidateService(name);
+            if (!oldOwner.empty())
+            {
+                serviceCache.invalidateService(oldOwner);
+            }
+            nameOwnerChanged(name, oldOwner, newOwner);
+        }));
+
+    // whatever changed before the signals were registered is not applied
+    markStale();
+    _live = true;
+    // getService() answers are forgotten on the same signals
+    ServiceCache::instance().setEnabled(true);
+    return matches;
+}
+
+void ObjectTree::refresh()
+{
+    std::lock_guard refreshing(_refreshMutex);
+    reload();
+}
+
+void ObjectTree::reload()
+{
+    size_t generation = 0;
+    {
+        std::unique_lock lock(_mutex);
+        generation = _generation;
+        _reloading = true;
+    }
+
+    auto bus = connection(BusType::systemBus);
+    FullTreeType tree;
+    std::map<std::string, std::set<std::string>> owners;
+    try
+    {
+        DelayedMethod method(bus, "xyz.openbmc_project.ObjectMapper",
+                             "/xyz/openbmc_project/object_mapper",
+                             "xyz.openbmc_project.ObjectMapper", "GetSubTree");
+        method.append("/");
+        method.append(0);
+        method.append(std::vector<std::string>{});
+        auto reply = method.call();
+        reply.read(tree);
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        ConnectionPool::instance().failed(e, BusType::systemBus);
+        logs_err("ObjectTree: GetSubTree failed: %s\n", e.what());
+        std::unique_lock lock(_mutex);
+        _reloading = false;
+        return;
+    }
+
+    // unique names are needed to attribute the signals to the services
+    std::set<std::string> services;
+    for (const auto& [objectPath, managers] : tree)
+    {
+        for (const auto& [service, interfaces] : managers)
+        {
+            services.insert(service);
+        }
+    }
+    for (const auto& service : services)
+    {
+        try
+        {
+            std::string owner;
+            auto method = bus->new_method_call(
+                "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                "org.freedesktop.DBus", "GetNameOwner");
+            method.append(service);
+            auto reply = bus->call(method);
+            reply.read(owner);
+            owners[owner].insert(service);
+        }
+        catch (const sdbusplus::exception::exception& e)
+        {
+            // gone meanwhile, its objects go with the NameOwnerChanged
+            logs_dbg("ObjectTree: no owner of %s: %s\n", service.c_str(),
+                     e.what());
+        }
+    }
+
+    std::unique_lock lock(_mutex);
+    _tree = std::move(tree);
+    _owners = std::move(owners);
+    rebuildIndex();
+    _loaded = true;
+    // a signal raced with the reload, it may or may not be part of it
+    _stale = generation != _generation;
+    _reloading = false;
+    _refreshes++;
+}
+
+void ObjectTree::load(FullTreeType tree,
+                      std::map<std::string, std::set<std::string>> owners)
+{
+    std::unique_lock lock(_mutex);
+    _tree = std::move(tree);
+    _owners = std::move(owners);
+    rebuildIndex();
+    _loaded = true;
+    _stale = false;
+    _generation++;
+}
+
+void ObjectTree::ensureLoaded()
+{
+    {
+        std::shared_lock lock(_mutex);
+        if (_loaded && !_stale)
+        {
+            return;
+        }
+    }
+    // one caller reloads, the others wait for it and use its tree, even if
+    // a racing signal left it stale: the next query after them reloads
+    auto refreshes = _refreshes.load();
+    std::lock_guard refreshing(_refreshMutex);
+    {
+        std::shared_lock lock(_mutex);
+        if ((_loaded && !_stale) || _refreshes.load() != refreshes)
+        {
+            return;
+        }
+    }
+    reload();
+}
+
+ObjectTree::ValueType
+    ObjectTree::getObject(const std::string& objectPath,
+                          const std::vector<std::string>& interfaces)
+{
+    _queries++;
+    ensureLoaded();
+    std::shared_lock lock(_mutex);
+    auto it = _tree.find(objectPath);
+    if (it == _tree.end())
+    {
+        return {};
+    }
+    return scopeManagers(it->second, interfaces);
+}
+
+ObjectTree::FullTreeType
+    ObjectTree::getSubTree(const std::string& subtree, int depth,
+                           const std::vector<std::string>& interfaces)
+{
+    _queries++;
+    ensureLoaded();
+    std::string prefix = subtree;
+    if (prefix.empty() || prefix.back() != '/')
+    {
+        prefix += '/';
+    }
+
+    FullTreeType result;
+    std::shared_lock lock(_mutex);
+    // the descendants of a path are contiguous in the ordered tree
+    for (auto it = _tree.lower_bound(prefix);
+         it != _tree.end() && it->first.starts_with(prefix); ++it)
+    {
+        if (depth > 0 &&
+            std::count(it->first.begin() + prefix.size(), it->first.end(),
+                       '/') >= depth)
+        {
+            continue;
+        }
+        auto managers = scopeManagers(it->second, interfaces);
+        if (!managers.empty())
+        {
+            result.emplace(it->first, std::move(managers));
+        }
+    }
+    return result;
+}
+
+std::vector<std::string>
+    ObjectTree::getSubTreePaths(const std::string& subtree, int depth,
+                                const std::vector<std::string>& interfaces)
+{
+    std::vector<std::string> result;
+    for (auto& [objectPath, managers] : getSubTree(subtree, depth, interfaces))
+    {
+        result.push_back(objectPath);
+    }
+    return result;
+}
+
+std::vector<std::string>
+    ObjectTree::getPathsNamed(const std::vector<std::string>& names,
+                              const std::vector<std::string>& interfaces)
+{
+    _queries++;
+    ensureLoaded();
+    std::set<std::string> result;
+    std::shared_lock lock(_mutex);
+    for (const auto& name : names)
+    {
+        auto paths = _byName.find(name);
+        if (paths == _byName.end())
+        {
+            continue;
+        }
+        for (const auto& objectPath : paths->second)
+        {
+            auto object = _tree.find(objectPath);
+            if (object != _tree.end() &&
+                !scopeManagers(object->second, interfaces).empty())
+            {
+                result.insert(objectPath);
+            }
+        }
+    }
+    return {result.begin(), result.end()};
+}
+
+void ObjectTree::interfacesAdded(const std::string& objectPath,
+                                 const std::string& sender,
+                                 const std::vector<std::string>& interfaces)
+{
+    std::unique_lock lock(_mutex);
+    _generation++;
+    if (!_loaded)
+    {
+        return;
+    }
+    auto names = _owners.find(sender);
+    if (names == _owners.end())
+    {
+        // eg. a service exporting objects before taking its name
+        _stale = true;
+        return;
+    }
+    if (!_tree.contains(objectPath))
+    {
+        indexPath(objectPath);
+    }
+    for (const auto& service : names->second)
+    {
+        auto& implemented = _tree[objectPath][service];
+        for (const auto& interface : interfaces)
+        {
+            if (std::find(implemented.begin(), implemented.end(), interface) ==
+                implemented.end())
+            {
+                implemented.push_back(interface);
+            }
+        }
+    }
+    _updates++;
+}
+
+void ObjectTree::interfacesRemoved(const std::string& objectPath,
+                                   const std::string& sender,
+                                   const std::vector<std::string>& interfaces)
+{
+    std::unique_lock lock(_mutex);
+    auto object = _tree.find(objectPath);
+    if (_loaded && !_reloading && object == _tree.end())
+    {
+        // nothing of it is mirrored, nothing to remove
+        return;
+    }
+    _generation++;
+    if (!_loaded)
+    {
+        return;
+    }
+    auto names = _owners.find(sender);
+    if (names == _owners.end())
+    {
+        _stale = true;
+        return;
+    }
+    if (object == _tree.end())
+    {
+        return;
+    }
+    for (const auto& service : names->second)
+    {
+        auto implemented = object->second.find(service);
+        if (implemented == object->second.end())
+        {
+            continue;
+        }
+        std::erase_if(implemented->second,
+                      [&interfaces](const std::string& interface) {
+            return std::find(interfaces.begin(), interfaces.end(),
+                             interface) != interfaces.end();
+        });
+        if (implemented->second.empty())
+        {
+            object->second.erase(implemented);
+        }
+    }
+    if (object->second.empty())
+    {
+        unindexPath(objectPath);
+        _tree.erase(object);
+    }
+    _updates++;
+}
+
+void ObjectTree::nameOwnerChanged(const std::string& name,
+                                  const std::string& oldOwner,
+                                  const std::string& newOwner)
+{
+    std::unique_lock lock(_mutex);
+    if (name.starts_with(':'))
+    {
+        // a unique name's own NameOwnerChanged, the well known names it
+        // owned got theirs already
+        if (newOwner.empty())
+        {
+            _owners.erase(name);
+        }
+        return;
+    }
+    if (!oldOwner.empty())
+    {
+        auto names = _owners.find(oldOwner);
+        if (names != _owners.end())
+        {
+            names->second.erase(name);
+            if (names->second.empty())
+            {
+                _owners.erase(names);
+            }
+        }
+    }
+    if (!newOwner.empty())
+    {
+        // the objects it exports from now on come with InterfacesAdded, and
+        // the ones it exported before taking the name came from a sender
+        // not known then, which marked the tree stale
+        _owners[newOwner].insert(name);
+        return;
+    }
+    if (removeService(name) || _reloading)
+    {
+        // a reload racing with this one may still hold the objects
+        _generation++;
+        _updates++;
+    }
+}
+
+bool ObjectTree::removeService(const std::string& service)
+{
+    bool removed = false;
+    for (auto object = _tree.begin(); object != _tree.end();)
+    {
+        removed = object->second.erase(service) > 0 || removed;
+        if (object->second.empty())
+        {
+            unindexPath(object->first);
+            object = _tree.erase(object);
+        }
+        else
+        {
+            ++object;
+        }
+    }
+    return removed;
+}
+
+std::string ObjectTree::nameOf(const std::string& objectPath)
+{
+    return objectPath.substr(objectPath.rfind('/') + 1);
+}
+
+void ObjectTree::rebuildIndex()
+{
+    _byName.clear();
+    for (const auto& [objectPath, managers] : _tree)
+    {
+        indexPath(objectPath);
+    }
+}
+
+void ObjectTree::indexPath(const std::string& objectPath)
+{
+    _byName[nameOf(objectPath)].insert(objectPath);
+}
+
+void ObjectTree::unindexPath(const std::string& objectPath)
+{
+    auto paths = _byName.find(nameOf(objectPath));
+    if (paths != _byName.end())
+    {
+        paths->second.erase(objectPath);
+        if (paths->second.empty())
+        {
+            _byName.erase(paths);
+        }
+    }
+}
+
+void ObjectTree::markStale()
+{
+    std::unique_lock lock(_mutex);
+    _generation++;
+    _stale = true;
+}
+
+ObjectTreeStats ObjectTree::stats() const
+{
+    std::shared_lock lock(_mutex);
+    return ObjectTreeStats{_refreshes.load(), _updates.load(), _queries.load(),
+                           _tree.size()};
+}
+
+ObjectTree::ValueType
+    ObjectTree::scopeManagers(const ValueType& implementations,
+                              const std::vector<std::string>& interfaces)
+{
+    if (interfaces.empty())
+    {
+        return implementations;
+    }
+    ValueType result;
+    for (const auto& [manager, intfs] : implementations)
+    {
+        // like xyz.openbmc_project.ObjectMapper, a manager implementing any
+        // of the interfaces is in
+        bool implementsAny = std::any_of(
+            interfaces.cbegin(), interfaces.cend(),
+            [&intfs](const std::string& interface) {
+            return std::find(intfs.cbegin(), intfs.cend(), interface) !=
+                   intfs.cend();
+        });
+        if (implementsAny)
+        {
+            result[manager] = intfs;
+        }
+    }
+    return result;
+}
+
+} // namespace dbus
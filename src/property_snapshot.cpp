@@ -0,0 +1,296 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "property_snapshot.hpp"
+
+#include "dbus_accessor.hpp"
+#include "log.hpp"
+
+#include <sdbusplus/exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <tuple>
+
+namespace dbus
+{
+
+namespace
+{
+
+constexpr auto objectManagerInterface = "org.freedesktop.DBus.ObjectManager";
+
+std::atomic<size_t> snapshots{0};
+std::atomic<size_t> managedObjectsCalls{0};
+std::atomic<size_t> getAllCalls{0};
+std::atomic<size_t> requested{0};
+std::atomic<size_t> served{0};
+
+/** service -> ObjectManager paths */
+std::map<std::string, std::vector<std::string>> objectManagers()
+{
+    std::map<std::string, std::vector<std::string>> result;
+    try
+    {
+        CachingObjectMapper om;
+        for (const auto& [path, services] :
+             om.getSubtree("/", 0, {objectManagerInterface}))
+        {
+            for (const auto& service : services)
+            {
+                result[service.first].push_back(path);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        logs_wrn("Could not list the ObjectManagers: %s\n", e.what());
+    }
+    return result;
+}
+
+/** objects @c service exports below @c manager */
+size_t managedBy(const std::string& service, const std::string& manager)
+{
+    size_t count = 0;
+    try
+    {
+        CachingObjectMapper om;
+        for (const auto& [path, services] : om.getSubtree(manager, 0))
+        {
+            count += services.count(service);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        logs_wrn("Could not count the objects of %s under %s: %s\n",
+                 service.c_str(), manager.c_str(), e.what());
+    }
+    return count;
+}
+
+bool getManagedObjects(const std::string& service, const std::string& manager,
+                       PropertySnapshot& snapshot)
+{
+    try
+    {
+        DelayedMethod method(connection(), service, manager,
+                             objectManagerInterface, "GetManagedObjects");
+        auto reply = method.call();
+        std::map<sdbusplus::message::object_path,
+                 std::map<std::string, std::map<std::string, PropertyVariant>>>
+            objects;
+        reply.read(objects);
+        PropertySnapshot::ManagedObjects byPath;
+        for (auto& [path, interfaces] : objects)
+        {
+            byPath.emplace(path.str, std::move(interfaces));
+        }
+        snapshot.add(byPath);
+        return true;
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        ConnectionPool::instance().failed(e);
+        logs_wrn("GetManagedObjects %s %s failed: %s\n", service.c_str(),
+                 manager.c_str(), e.what());
+    }
+    return false;
+}
+
+void getAll(const std::string& service, const std::string& objectPath,
+            const std::string& interface, PropertySnapshot& snapshot)
+{
+    try
+    {
+        DelayedMethod method(connection(), service, objectPath,
+                             freeDesktopInterface, "GetAll");
+        method.append(interface);
+        auto reply = method.call();
+        std::map<std::string, PropertyVariant> properties;
+        reply.read(properties);
+        snapshot.add(objectPath, interface, properties);
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        ConnectionPool::instance().failed(e);
+        logs_wrn("GetAll %s %s %s failed: %s\n", service.c_str(),
+                 objectPath.c_str(), interface.c_str(), e.what());
+    }
+}
+
+} // namespace
+
+PropertySnapshot
+    PropertySnapshot::take(const std::vector<PropertyRequest>& requests)
+{
+    std::vector<std::pair<std::string, std::string>> objects;
+    for (const auto& request : requests)
+    {
+        objects.emplace_back(request.objectPath, request.interface);
+    }
+    auto snapshot = takeObjects(objects);
+
+    size_t found = 0;
+    for (const auto& request : requests)
+    {
+        found += snapshot._values.count(request);
+    }
+    requested += requests.size();
+    served += found;
+    logs_dbg("Snapshot of %zu properties: %zu found, %zu values\n",
+             requests.size(), found, snapshot.size());
+    return snapshot;
+}
+
+PropertySnapshot PropertySnapshot::takeObjects(
+    const std::vector<std::pair<std::string, std::string>>& objects)
+{
+    PropertySnapshot snapshot;
+    snapshots++;
+    if (objects.empty())
+    {
+        return snapshot;
+    }
+
+    auto managers = objectManagers();
+    // (service, manager) -> objects
+    std::map<std::pair<std::string, std::string>, std::set<std::string>>
+        managed;
+    // (service, object, interface) to fetch
+    std::set<std::tuple<std::string, std::string, std::string>> wanted;
+    for (const auto& [objectPath, interface] : objects)
+    {
+        auto service = getService(objectPath, interface);
+        if (service.empty())
+        {
+            continue;
+        }
+        wanted.emplace(service, objectPath, interface);
+        auto it = managers.find(service);
+        if (it != managers.end())
+        {
+            auto manager = managerOf(objectPath, it->second);
+            if (!manager.empty())
+            {
+                managed[{service, manager}].insert(objectPath);
+            }
+        }
+    }
+
+    std::set<std::pair<std::string, std::string>> fetched;
+    for (const auto& [serviceManager, paths] : managed)
+    {
+        const auto& [service, manager] = serviceManager;
+        if (paths.size() < SNAPSHOT_MIN_MANAGED_OBJECTS ||
+            !worthManagedObjects(paths.size(), managedBy(service, manager)))
+        {
+            continue;
+        }
+        managedObjectsCalls++;
+        if (getManagedObjects(service, manager, snapshot))
+        {
+            for (const auto& path : paths)
+            {
+                fetched.emplace(service, path);
+            }
+        }
+    }
+    for (const auto& [service, path, interface] : wanted)
+    {
+        if (fetched.count({service, path}) == 0)
+        {
+            getAllCalls++;
+            getAll(service, path, interface, snapshot);
+        }
+    }
+    return snapshot;
+}
+
+void PropertySnapshot::add(
+    const std::string& objectPath, const std::string& interface,
+    const std::map<std::string, PropertyVariant>& properties)
+{
+    for (const auto& [property, value] : properties)
+    {
+        _values[PropertyRequest{objectPath, interface, property}] = value;
+    }
+}
+
+void PropertySnapshot::add(const ManagedObjects& objects)
+{
+    for (const auto& [path, interfaces] : objects)
+    {
+        for (const auto& [interface, properties] : interfaces)
+        {
+            add(path, interface, properties);
+        }
+    }
+}
+
+std::optional<PropertyVariant>
+    PropertySnapshot::find(const PropertyRequest& request) const
+{
+    auto it = _values.find(request);
+    if (it == _values.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::vector<PropertyVariant>
+    PropertySnapshot::values(const std::vector<PropertyRequest>& requests) const
+{
+    std::vector<PropertyVariant> result;
+    result.reserve(requests.size());
+    for (const auto& request : requests)
+    {
+        result.push_back(find(request).value_or(PropertyVariant{}));
+    }
+    return result;
+}
+
+SnapshotStats PropertySnapshot::stats()
+{
+    return SnapshotStats{snapshots.load(), managedObjectsCalls.load(),
+                         getAllCalls.load(), requested.load(), served.load()};
+}
+
+bool PropertySnapshot::worthManagedObjects(size_t requested, size_t exported)
+{
+    // the requested objects are part of the reply, a smaller count is stale
+    exported = std::max(exported, requested);
+    return requested >= SNAPSHOT_MIN_MANAGED_OBJECTS &&
+           requested * 100 >= exported * SNAPSHOT_MIN_MANAGED_OBJECTS_PERCENT;
+}
+
+std::string
+    PropertySnapshot::managerOf(const std::string& objectPath,
+                                const std::vector<std::string>& managers)
+{
+    // GetManagedObjects returns the objects below the manager, not itself
+    std::string best;
+    for (const auto& manager : managers)
+    {
+        bool above = (manager == "/" && objectPath != "/") ||
+                     (objectPath.size() > manager.size() &&
+                      objectPath.compare(0, manager.size(), manager) == 0 &&
+                      objectPath[manager.size()] == '/');
+        if (above && manager.size() > best.size())
+        {
+            best = manager;
+        }
+    }
+    return best;
+}
+
+} // namespace dbus
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "property_store.hpp"
+
+#include "log.hpp"
+#include "property_snapshot.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace dbus
+{
+
+PropertyStore& PropertyStore::instance()
+{
+    static PropertyStore store;
+    return store;
+}
+
+void PropertyStore::track(const std::string& objectPath,
+                          const std::string& interface)
+{
+    std::unique_lock lock(_mutex);
+    _tracked.emplace(objectPath, interface);
+}
+
+bool PropertyStore::isTracked(const std::string& objectPath,
+                              const std::string& interface) const
+{
+    std::shared_lock lock(_mutex);
+    return _tracked.count(Object{objectPath, interface}) != 0;
+}
+
+void PropertyStore::seed()
+{
+    std::vector<Object> objects;
+    {
+        std::shared_lock lock(_mutex);
+        objects.assign(_tracked.begin(), _tracked.end());
+    }
+    auto start = Clock::now();
+    auto snapshot = PropertySnapshot::takeObjects(objects);
+    size_t seeded = 0;
+    for (const auto& [request, value] : snapshot.all())
+    {
+        if (!isTracked(request.objectPath, request.interface) ||
+            isInvalidVariant(value))
+        {
+            continue;
+        }
+        refresh(request.objectPath, request.interface, request.property,
+                value, start);
+        seeded++;
+    }
+    logs_info("Property store seeded with %zu properties of %zu objects\n",
+              seeded, objects.size());
+}
+
+void PropertyStore::store(const Key& key, const PropertyVariant& value,
+                          Clock::time_point when, bool signal)
+{
+    auto it = _properties.find(key);
+    if (it == _properties.end())
+    {
+        _properties.emplace(key, StoredProperty{value, 1, when, signal});
+        return;
+    }
+    it->second.signalFed = it->second.signalFed || signal;
+    if (it->second.value != value)
+    {
+        it->second.value = value;
+        it->second.version++;
+    }
+    it->second.updated = when;
+}
+
+void PropertyStore::update(
+    const std::string& objectPath, const std::string& interface,
+    const boost::container::flat_map<std::string, PropertyVariant>& properties)
+{
+    auto now = Clock::now();
+    std::unique_lock lock(_mutex);
+    if (_tracked.count(Object{objectPath, interface}) == 0)
+    {
+        return;
+    }
+    for (const auto& [property, value] : properties)
+    {
+        if (isValidVariant(value))
+        {
+            store(Key{objectPath, interface, property}, value, now, true);
+            _updates++;
+        }
+    }
+}
+
+void PropertyStore::refresh(const std::string& objectPath,
+                            const std::string& interface,
+                            const std::string& property,
+                            const PropertyVariant& value,
+                            Clock::time_point readStart)
+{
+    if (isInvalidVariant(value))
+    {
+        return;
+    }
+    std::unique_lock lock(_mutex);
+    if (_tracked.count(Object{objectPath, interface}) == 0)
+    {
+        return;
+    }
+    Key key{objectPath, interface, property};
+    auto it = _properties.find(key);
+    // a signal received during the read is newer than what the read got
+    if (it != _properties.end() && it->second.updated >= readStart)
+    {
+        return;
+    }
+    store(key, value, readStart, false);
+}
+
+std::optional<StoredProperty>
+    PropertyStore::find(const std::string& objectPath,
+                        const std::string& interface,
+                        const std::string& property)
+{
+    std::shared_lock lock(_mutex);
+    if (_tracked.empty())
+    {
+        return std::nullopt;
+    }
+    auto it = _properties.find(Key{objectPath, interface, property});
+    // no signal keeps the others current, they are read
+    if (it == _properties.end() || !it->second.signalFed)
+    {
+        if (_tracked.count(Object{objectPath, interface}) != 0)
+        {
+            _misses++;
+        }
+        return std::nullopt;
+    }
+    if (_maxAge.count() > 0 && Clock::now() - it->second.updated > _maxAge)
+    {
+        _stale++;
+        return std::nullopt;
+    }
+    _hits++;
+    return it->second;
+}
+
+void PropertyStore::setMaxAge(std::chrono::milliseconds maxAge)
+{
+    std::unique_lock lock(_mutex);
+    _maxAge = maxAge;
+}
+
+PropertyStoreStats PropertyStore::stats() const
+{
+    std::shared_lock lock(_mutex);
+    return PropertyStoreStats{_hits.load(), _misses.load(), _stale.load(),
+                              _updates.load(), _properties.size()};
+}
+
+void PropertyStore::clear()
+{
+    std::unique_lock lock(_mutex);
+    _tracked.clear();
+    _properties.clear();
+    _maxAge = std::chrono::milliseconds(PROPERTY_STORE_MAX_AGE_MS);
+}
+
+} // namespace dbus
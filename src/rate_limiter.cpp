@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "rate_limiter.hpp"
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace dbus
+{
+
+RateLimiter::Permit& RateLimiter::Permit::operator=(Permit&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (_bucket != nullptr)
+        {
+            _limiter->release(_bucket);
+        }
+        _limiter = other._limiter;
+        _bucket = other._bucket;
+        other._bucket = nullptr;
+    }
+    return *this;
+}
+
+RateLimiter::Permit::~Permit()
+{
+    if (_bucket != nullptr)
+    {
+        _limiter->release(_bucket);
+    }
+}
+
+RateLimiter& RateLimiter::instance()
+{
+    static RateLimiter limiter;
+    return limiter;
+}
+
+void RateLimiter::setLimit(const std::string& service, const RateLimit& limit)
+{
+    std::lock_guard lock(_mutex);
+    auto& b = bucket(service);
+    b.limit = limit;
+    b.ownLimit = true;
+    // a service not called yet starts with a full bucket
+    b.tokens = b.stats.calls == 0
+                   ? static_cast<double>(limit.burst)
+                   : std::min(b.tokens, static_cast<double>(limit.burst));
+    b.changed.notify_all();
+}
+
+void RateLimiter::setDefaultLimit(const RateLimit& limit)
+{
+    std::lock_guard lock(_mutex);
+    _defaultLimit = limit;
+    for (auto& [service, b] : _buckets)
+    {
+        if (!b->ownLimit)
+        {
+            b->limit = limit;
+            b->tokens =
+                b->stats.calls == 0
+                    ? static_cast<double>(limit.burst)
+                    : std::min(b->tokens, static_cast<double>(limit.burst));
+            b->changed.notify_all();
+        }
+    }
+}
+
+RateLimiter::Bucket& RateLimiter::bucket(const std::string& service)
+{
+    auto it = _buckets.find(service);
+    if (it == _buckets.end())
+    {
+        auto b = std::make_unique<Bucket>();
+        b->limit = _defaultLimit;
+        b->tokens = static_cast<double>(_defaultLimit.burst);
+        b->refilled = std::chrono::steady_clock::now();
+        it = _buckets.emplace(service, std::move(b)).first;
+    }
+    return *it->second;
+}
+
+void RateLimiter::refill(Bucket& b, std::chrono::steady_clock::time_point now)
+{
+    if (b.limit.rate > 0.0 && now > b.refilled)
+    {
+        std::chrono::duration<double> elapsed = now - b.refilled;
+        b.tokens = std::min(static_cast<double>(b.limit.burst),
+                            b.tokens + elapsed.count() * b.limit.rate);
+    }
+    b.refilled = now;
+}
+
+RateLimiter::Permit RateLimiter::acquire(const std::string& service)
+{
+    return std::move(*acquire(service,
+                              std::chrono::steady_clock::time_point::max()));
+}
+
+std::optional<RateLimiter::Permit>
+    RateLimiter::acquire(const std::string& service,
+                         std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock lock(_mutex);
+    auto& b = bucket(service);
+    auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    while (true)
+    {
+        refill(b, now);
+        bool hasToken = b.limit.rate <= 0.0 || b.tokens >= 1.0;
+        bool hasSlot =
+            b.limit.maxConcurrent == 0 || b.inFlight < b.limit.maxConcurrent;
+        if (hasToken && hasSlot)
+        {
+            break;
+        }
+        if (now >= deadline)
+        {
+            b.stats.timedOut++;
+            return std::nullopt;
+        }
+        auto wakeUp = deadline;
+        if (!hasToken)
+        {
+            // a slot freed earlier notifies
+            auto untilToken =
+                std::chrono::duration<double>((1.0 - b.tokens) / b.limit.rate);
+            wakeUp = std::min(
+                wakeUp,
+                now + std::chrono::duration_cast<
+                          std::chrono::steady_clock::duration>(untilToken));
+        }
+        if (wakeUp == std::chrono::steady_clock::time_point::max())
+        {
+            b.changed.wait(lock);
+        }
+        else
+        {
+            b.changed.wait_until(lock, wakeUp);
+        }
+        now = std::chrono::steady_clock::now();
+    }
+
+    if (b.limit.rate > 0.0)
+    {
+        b.tokens -= 1.0;
+    }
+    b.inFlight++;
+    b.stats.calls++;
+    if (now > start)
+    {
+        uint64_t waitUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - start)
+                .count();
+        b.stats.waited++;
+        b.stats.waitUs += waitUs;
+        b.stats.maxWaitUs = std::max(b.stats.maxWaitUs, waitUs);
+    }
+    return Permit(this, &b);
+}
+
+void RateLimiter::release(Bucket* b)
+{
+    std::lock_guard lock(_mutex);
+    b->inFlight--;
+    b->changed.notify_all();
+}
+
+std::map<std::string, RateLimiterStats> RateLimiter::stats() const
+{
+    std::lock_guard lock(_mutex);
+    std::map<std::string, RateLimiterStats> result;
+    for (const auto& [service, b] : _buckets)
+    {
+        auto stats = b->stats;
+        stats.inFlight = b->inFlight;
+        result.emplace(service, stats);
+    }
+    return result;
+}
+
+void RateLimiter::clear()
+{
+    std::lock_guard lock(_mutex);
+    _defaultLimit = RateLimit{};
+    _buckets.clear();
+}
+
+std::pair<std::string, RateLimit> RateLimiter::parse(const std::string& spec)
+{
+    auto eq = spec.rfind('=');
+    if (eq == std::string::npos || eq == 0 || eq + 1 == spec.size())
+    {
+        throw std::invalid_argument("expected <service>=<rate>[:<burst>"
+                                    "[:<max concurrent>]], got '" +
+                                    spec + "'");
+    }
+    std::vector<std::string> fields;
+    auto values = spec.substr(eq + 1);
+    boost::split(fields, values, boost::is_any_of(":"));
+    if (fields.size() > 3)
+    {
+        throw std::invalid_argument("too many fields in '" + spec + "'");
+    }
+
+    RateLimit limit;
+    limit.rate = std::stod(fields[0]);
+    if (fields.size() > 1)
+    {
+        limit.burst = std::stoul(fields[1]);
+    }
+    if (fields.size() > 2)
+    {
+        limit.maxConcurrent = std::stoul(fields[2]);
+    }
+    if (limit.rate < 0.0 || limit.burst == 0)
+    {
+        throw std::invalid_argument("negative rate or zero burst in '" +
+                                    spec + "'");
+    }
+    return {spec.substr(0, eq), limit};
+}
+
+} // namespace dbus
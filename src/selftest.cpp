@@ -11,6 +11,7 @@
 
 #include "selftest.hpp"
 
+#include "async_reader.hpp"
 #include "dbus_accessor.hpp"
 #include "event_detection.hpp"
 #include "property_accessor.hpp"
@@ -111,7 +112,7 @@ void Selftest::resolveLogEntry(
                 log_dbg("DEV: %s\n", deviceName.c_str());
                 log_dbg("LOG: %s\n", objectPath.first.str.c_str());
 
-                auto bus = sdbusplus::bus::new_default_system();
+                auto bus = dbus::connection(dbus::BusType::systemBus);
                 try
                 {
                     std::variant<bool> v = true;
@@ -126,6 +127,8 @@ void Selftest::resolveLogEntry(
                 }
                 catch (const sdbusplus::exception::exception& e)
                 {
+                    dbus::ConnectionPool::instance().failed(
+                        e, dbus::BusType::systemBus);
                     log_err(" Dbus Error: %s\n", e.what());
                 }
             }
@@ -146,7 +149,7 @@ void Selftest::updateDeviceHealth([[maybe_unused]] const std::string& device,
         {
             const std::string healthInterface(
                 "xyz.openbmc_project.State.Decorator.Health");
-            dbus::DirectObjectMapper om;
+            dbus::CachingObjectMapper om;
             std::vector<std::string> objPathsToAlter =
                 om.getAllDevIdObjPaths(device, healthInterface);
             if (!objPathsToAlter.empty())
@@ -322,6 +325,11 @@ eventing::RcCode Selftest::perform(const dat_traverse::Device& dev,
     /* Important, preinsert new device test to detect recursed device. */
     reportRes[dev.name] = tmpDeviceReport;
 
+    // read the DBUS and DeviceCoreAPI test points concurrently up front
+    dbus::PrefetchScope prefetched(testPointReads(dev, layersToIgnore));
+    dbus::PrefetchScope prefetchedCoreApi(
+        testPointCoreApiReads(dev, layersToIgnore));
+
     for (auto& tl : availableLayers)
     {
         auto& tmpLayerReport = tmpDeviceReport.layer[tl.first];
@@ -386,6 +394,53 @@ eventing::RcCode Selftest::perform(const dat_traverse::Device& dev,
     return eventing::RcCode::succ;
 }
 
+std::vector<dbus::PropertyRequest>
+    Selftest::testPointReads(const dat_traverse::Device& dev,
+                             const std::vector<std::string>& layersToIgnore)
+{
+    std::vector<dbus::PropertyRequest> requests;
+    for (auto& tl : dev.test)
+    {
+        if (std::find(layersToIgnore.begin(), layersToIgnore.end(), tl.first) !=
+            layersToIgnore.end())
+        {
+            continue;
+        }
+        for (auto& tp : tl.second.testPoints)
+        {
+            if (auto request = tp.second.accessor.dbusReadRequest())
+            {
+                requests.push_back(*request);
+            }
+        }
+    }
+    return requests;
+}
+
+std::vector<dbus::CoreApiRequest> Selftest::testPointCoreApiReads(
+    const dat_traverse::Device& dev,
+    const std::vector<std::string>& layersToIgnore)
+{
+    std::vector<dbus::CoreApiRequest> requests;
+    for (auto& tl : dev.test)
+    {
+        if (std::find(layersToIgnore.begin(), layersToIgnore.end(), tl.first) !=
+            layersToIgnore.end())
+        {
+            continue;
+        }
+        for (auto& tp : tl.second.testPoints)
+        {
+            // read(dev.name) in perform()
+            if (auto request = tp.second.accessor.coreApiReadRequest(dev.name))
+            {
+                requests.push_back(*request);
+            }
+        }
+    }
+    return requests;
+}
+
 eventing::RcCode Selftest::performEntireTree(ReportResult& reportRes,
                                         std::vector<std::string> layersToIgnore,
                                         const bool& doEventDetermination)
@@ -408,6 +463,23 @@ eventing::RcCode Selftest::performEntireTree(ReportResult& reportRes,
             }
         }
     }
+    // the test points of the whole tree, in bulk
+    std::vector<dbus::PropertyRequest> requests;
+    for (auto& dev : _dat)
+    {
+        auto reads = testPointReads(dev.second, layersToIgnore);
+        requests.insert(requests.end(), reads.begin(), reads.end());
+    }
+    dbus::PrefetchScope prefetched(requests, dbus::PrefetchScope::Mode::bulk);
+    std::vector<dbus::CoreApiRequest> coreApiRequests;
+    for (auto& dev : _dat)
+    {
+        auto reads = testPointCoreApiReads(dev.second, layersToIgnore);
+        coreApiRequests.insert(coreApiRequests.end(), reads.begin(),
+                               reads.end());
+    }
+    dbus::PrefetchScope prefetchedCoreApi(coreApiRequests);
+
     for (auto& dev : _dat)
     {
         if (perform(dev.second, reportRes, layersToIgnore,
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "service_cache.hpp"
+
+#include <mutex>
+
+namespace dbus
+{
+
+ServiceCache& ServiceCache::instance()
+{
+    static ServiceCache cache;
+    return cache;
+}
+
+std::optional<std::string> ServiceCache::find(const std::string& objectPath,
+                                              const std::string& interface)
+{
+    if (!_enabled)
+    {
+        return std::nullopt;
+    }
+    std::shared_lock lock(_mutex);
+    auto path = _entries.find(objectPath);
+    if (path != _entries.end())
+    {
+        auto entry = path->second.find(interface);
+        if (entry != path->second.end())
+        {
+            _hits++;
+            return entry->second;
+        }
+    }
+    _misses++;
+    return std::nullopt;
+}
+
+void ServiceCache::insert(const std::string& objectPath,
+                          const std::string& interface,
+                          const std::string& service, Generation generation)
+{
+    if (!_enabled || service.empty())
+    {
+        return;
+    }
+    std::unique_lock lock(_mutex);
+    // checked under the lock, invalidations bump it holding the lock too
+    if (generation != _generation)
+    {
+        return;
+    }
+    auto& interfaces = _entries[objectPath];
+    auto entry = interfaces.find(interface);
+    if (entry == interfaces.end())
+    {
+        interfaces.emplace(interface, service);
+        _size++;
+    }
+    else
+    {
+        erased(entry->second);
+        entry->second = service;
+    }
+    _services[service]++;
+}
+
+void ServiceCache::erased(const std::string& service)
+{
+    auto count = _services.find(service);
+    if (count != _services.end() && --count->second == 0)
+    {
+        _services.erase(count);
+    }
+}
+
+void ServiceCache::invalidateService(const std::string& service)
+{
+    bool unique = service.starts_with(':');
+    if (unique)
+    {
+        // every short lived client's name comes and goes, look before
+        // taking the lock exclusively
+        std::shared_lock lock(_mutex);
+        if (!_services.contains(service))
+        {
+            return;
+        }
+    }
+    std::unique_lock lock(_mutex);
+    auto count = _services.find(service);
+    if (count == _services.end())
+    {
+        // an answer being fetched may still name the well known service
+        // going away, the unique names of clients are not worth a reset
+        if (!unique)
+        {
+            _generation++;
+        }
+        return;
+    }
+    _generation++;
+    _size -= count->second;
+    _invalidations += count->second;
+    _services.erase(count);
+    for (auto path = _entries.begin(); path != _entries.end();)
+    {
+        auto& interfaces = path->second;
+        std::erase_if(interfaces, [&service](const auto& entry) {
+            return entry.second == service;
+        });
+        path = interfaces.empty() ? _entries.erase(path) : std::next(path);
+    }
+}
+
+void ServiceCache::invalidatePath(const std::string& objectPath)
+{
+    std::unique_lock lock(_mutex);
+    _generation++;
+    auto path = _entries.find(objectPath);
+    if (path != _entries.end())
+    {
+        _size -= path->second.size();
+        _invalidations += path->second.size();
+        for (const auto& [interface, service] : path->second)
+        {
+            erased(service);
+        }
+        _entries.erase(path);
+    }
+}
+
+void ServiceCache::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+ServiceCacheStats ServiceCache::stats() const
+{
+    std::shared_lock lock(_mutex);
+    return ServiceCacheStats{_hits.load(), _misses.load(),
+                             _invalidations.load(), _size};
+}
+
+void ServiceCache::clear()
+{
+    std::unique_lock lock(_mutex);
+    _generation++;
+    _entries.clear();
+    _services.clear();
+    _size = 0;
+}
+
+} // namespace dbus
@@ -0,0 +1,733 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "subprocess.hpp"
+
+#include "log.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+extern char** environ;
+
+namespace subprocess
+{
+
+namespace
+{
+
+/** a file descriptor closed at the end of its scope */
+class Fd
+{
+  public:
+    explicit Fd(int fd = -1) : _fd(fd)
+    {}
+
+    ~Fd()
+    {
+        reset();
+    }
+
+    Fd(const Fd&) = delete;
+    Fd& operator=(const Fd&) = delete;
+
+    int get() const
+    {
+        return _fd;
+    }
+
+    void reset(int fd = -1)
+    {
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+        }
+        _fd = fd;
+    }
+
+  private:
+    int _fd;
+};
+
+int openPidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/** append what the pipe holds to @c output, false once at end of file */
+bool drain(int fd, std::string& output)
+{
+    char buffer[4096];
+    while (true)
+    {
+        auto count = ::read(fd, buffer, sizeof(buffer));
+        if (count > 0)
+        {
+            output.append(buffer, static_cast<size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+/** the child and whatever it started in its group */
+void killGroup(pid_t pid)
+{
+    if (::kill(-pid, SIGKILL) != 0 && errno != ESRCH)
+    {
+        logs_wrn("Could not kill process group %d: %s\n", pid,
+                 std::strerror(errno));
+    }
+}
+
+/**
+ * @brief Start @c args in a process group of its own, @c stdinFd and
+ *        @c stdoutFd as its stdin and stdout (-1 to keep the daemon's)
+ *
+ * @return 0 or the error number
+ */
+int spawn(std::vector<std::string>& args, int stdinFd, int stdoutFd,
+          pid_t& pid)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    // dup2() clears close-on-exec on the child's copies
+    if (stdinFd >= 0)
+    {
+        posix_spawn_file_actions_adddup2(&actions, stdinFd, STDIN_FILENO);
+    }
+    if (stdoutFd >= 0)
+    {
+        posix_spawn_file_actions_adddup2(&actions, stdoutFd, STDOUT_FILENO);
+    }
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t noSignals;
+    sigemptyset(&noSignals);
+    // the daemon ignores SIGPIPE for the co-processes, the children do not
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+                                        POSIX_SPAWN_SETSIGMASK |
+                                        POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigmask(&attr, &noSignals);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+    {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    int rc = ::posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(),
+                            environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    return rc;
+}
+
+/** @c arg single-quoted for the shell */
+std::string quote(const std::string& arg)
+{
+    std::string quoted{"'"};
+    for (char c : arg)
+    {
+        quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+int exitCode(int status)
+{
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
+    // as a shell reports it
+    return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : -1;
+}
+
+} // namespace
+
+Runner& Runner::instance()
+{
+    static Runner runner;
+    return runner;
+}
+
+Result Runner::run(const std::string& commandLine,
+                   std::chrono::milliseconds timeout)
+{
+    auto args = split(commandLine);
+    if (args.empty())
+    {
+        throw std::runtime_error("empty command line");
+    }
+    const auto& executable = args[0];
+
+    if (auto* coprocess = this->coprocess(executable))
+    {
+        auto start = std::chrono::steady_clock::now();
+        Result result{-1, ""};
+        std::vector<std::string> coprocessArgs(args.begin() + 1, args.end());
+        Coprocess::Status status;
+        try
+        {
+            status = coprocess->request(coprocessArgs, timeout, result);
+        }
+        catch (const std::runtime_error&)
+        {
+            record(executable, std::chrono::steady_clock::now() - start,
+                   false, true, true);
+            throw;
+        }
+        if (status == Coprocess::Status::served)
+        {
+            record(executable, std::chrono::steady_clock::now() - start,
+                   false, false, true);
+            return result;
+        }
+    }
+
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0)
+    {
+        throw std::runtime_error(std::string("pipe2: ") +
+                                 std::strerror(errno));
+    }
+    Fd readEnd(fds[0]);
+    Fd writeEnd(fds[1]);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = 0;
+    int rc = spawn(args, -1, writeEnd.get(), pid);
+    writeEnd.reset();
+    if (rc != 0)
+    {
+        record(executable, {}, true, false);
+        throw std::runtime_error("cannot run '" + executable +
+                                 "': " + std::strerror(rc));
+    }
+
+    ::fcntl(readEnd.get(), F_SETFL,
+            ::fcntl(readEnd.get(), F_GETFL) | O_NONBLOCK);
+    Fd pidfd(openPidfd(pid));
+    Fd epoll(::epoll_create1(EPOLL_CLOEXEC));
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = readEnd.get();
+    ::epoll_ctl(epoll.get(), EPOLL_CTL_ADD, readEnd.get(), &event);
+    if (pidfd.get() >= 0)
+    {
+        event.data.fd = pidfd.get();
+        ::epoll_ctl(epoll.get(), EPOLL_CTL_ADD, pidfd.get(), &event);
+    }
+
+    Result result{-1, ""};
+    bool pipeOpen = true;
+    int status = 0;
+    size_t exitPolls = 0;
+    auto until = start + timeout;
+    // not reaped yet: the zombie keeps its pid, and the group's, from being
+    // reused until killGroup() below
+    auto exited = [pid]() {
+        siginfo_t info{};
+        return ::waitid(P_PID, static_cast<id_t>(pid), &info,
+                        WEXITED | WNOHANG | WNOWAIT) == 0 &&
+               info.si_pid == pid;
+    };
+    while (!exited())
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= until)
+        {
+            killGroup(pid);
+            ::waitpid(pid, &status, 0);
+            record(executable, std::chrono::steady_clock::now() - start, false,
+                   true, false, exitPolls);
+            throw std::runtime_error(
+                "child process timed out and was terminated!");
+        }
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(until - now);
+        auto wait = static_cast<int>(left.count());
+        if (pidfd.get() < 0)
+        {
+            wait = std::min(wait, SUBPROCESS_EXIT_POLL_MS);
+        }
+        epoll_event events[2];
+        auto ready = ::epoll_wait(epoll.get(), events, 2, wait);
+        exitPolls += ready == 0 ? 1 : 0;
+        for (int i = 0; i < ready; ++i)
+        {
+            if (events[i].data.fd == readEnd.get() && pipeOpen &&
+                !drain(readEnd.get(), result.output))
+            {
+                pipeOpen = false;
+                ::epoll_ctl(epoll.get(), EPOLL_CTL_DEL, readEnd.get(),
+                            nullptr);
+            }
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // what the child left behind would keep the pipe open
+    killGroup(pid);
+    ::waitpid(pid, &status, 0);
+    if (pipeOpen)
+    {
+        drain(readEnd.get(), result.output);
+    }
+    result.exitCode = exitCode(status);
+    record(executable, elapsed, false, false, false, exitPolls);
+    logs_dbg("'%s' exited with %d after %lld us, %zu bytes of output\n",
+             executable.c_str(), result.exitCode,
+             (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                 elapsed)
+                 .count(),
+             result.output.size());
+    return result;
+}
+
+std::map<std::string, ExecutableStats> Runner::stats() const
+{
+    std::lock_guard lock(_mutex);
+    auto stats = _stats;
+    for (const auto& [executable, coprocess] : _coprocesses)
+    {
+        stats[executable].coprocessStarts = coprocess->starts();
+    }
+    return stats;
+}
+
+void Runner::enableCoprocess(const std::string& executable)
+{
+    std::lock_guard lock(_mutex);
+    if (_coprocesses.count(executable) == 0)
+    {
+        _coprocesses.emplace(executable,
+                             std::make_unique<Coprocess>(executable));
+    }
+}
+
+Coprocess* Runner::coprocess(const std::string& executable) const
+{
+    std::lock_guard lock(_mutex);
+    auto it = _coprocesses.find(executable);
+    return it == _coprocesses.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> Runner::split(const std::string& commandLine)
+{
+    std::vector<std::string> args;
+    std::string arg;
+    bool inArg = false;
+    char quote = 0;
+    for (size_t i = 0; i < commandLine.size(); ++i)
+    {
+        char c = commandLine[i];
+        if (quote != 0)
+        {
+            if (c == quote)
+            {
+                quote = 0;
+            }
+            else if (c == '\\' && quote == '"' && i + 1 < commandLine.size())
+            {
+                arg += commandLine[++i];
+            }
+            else
+            {
+                arg += c;
+            }
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+            inArg = true;
+        }
+        else if (c == '\\' && i + 1 < commandLine.size())
+        {
+            arg += commandLine[++i];
+            inArg = true;
+        }
+        else if (c == ' ' || c == '\t' || c == '\n')
+        {
+            if (inArg)
+            {
+                args.push_back(std::move(arg));
+                arg.clear();
+                inArg = false;
+            }
+        }
+        else
+        {
+            arg += c;
+            inArg = true;
+        }
+    }
+    if (inArg)
+    {
+        args.push_back(std::move(arg));
+    }
+    return args;
+}
+
+void Runner::record(const std::string& executable,
+                    std::chrono::steady_clock::duration elapsed, bool failed,
+                    bool timedOut, bool coprocess, size_t exitPolls)
+{
+    auto us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count());
+    std::lock_guard lock(_mutex);
+    auto& stats = _stats[executable];
+    if (failed)
+    {
+        stats.failures++;
+        return;
+    }
+    coprocess ? stats.coprocessRequests++ : stats.spawns++;
+    stats.timeouts += timedOut ? 1 : 0;
+    stats.exitPolls += exitPolls;
+    stats.totalUs += us;
+    stats.maxUs = std::max(stats.maxUs, us);
+}
+
+// Memo ///////////////////////////////////////////////////////////////////////
+
+Memo& Memo::instance()
+{
+    static Memo memo;
+    return memo;
+}
+
+Result Memo::run(const std::string& commandLine,
+                 std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(_mutex);
+    if (_ttl.count() <= 0)
+    {
+        _stats.runs++;
+        lock.unlock();
+        return Runner::instance().run(commandLine, timeout);
+    }
+    auto now = Clock::now();
+    std::erase_if(_entries,
+                  [now](const auto& entry) {
+                      return entry.second.expires <= now;
+                  });
+    auto it = _entries.find(commandLine);
+    if (it != _entries.end())
+    {
+        _stats.hits++;
+        auto result = it->second.result;
+        lock.unlock();
+        if (result.wait_for(timeout) != std::future_status::ready)
+        {
+            throw std::runtime_error(
+                "timed out waiting for the same command run by another read");
+        }
+        return result.get();
+    }
+    std::promise<Result> promise;
+    _entries[commandLine] = Entry{promise.get_future().share(),
+                                  Clock::time_point::max()};
+    _stats.runs++;
+    lock.unlock();
+
+    try
+    {
+        auto result = Runner::instance().run(commandLine, timeout);
+        lock.lock();
+        _entries[commandLine].expires = Clock::now() + _ttl;
+        lock.unlock();
+        promise.set_value(result);
+        return result;
+    }
+    catch (...)
+    {
+        lock.lock();
+        _entries.erase(commandLine);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+void Memo::setTtl(std::chrono::milliseconds ttl)
+{
+    std::lock_guard lock(_mutex);
+    _ttl = ttl;
+    // the results kept keep their expiry
+}
+
+std::chrono::milliseconds Memo::ttl() const
+{
+    std::lock_guard lock(_mutex);
+    return _ttl;
+}
+
+MemoStats Memo::stats() const
+{
+    std::lock_guard lock(_mutex);
+    return _stats;
+}
+
+// Coprocess //////////////////////////////////////////////////////////////////
+
+Coprocess::~Coprocess()
+{
+    stop();
+}
+
+Coprocess::Status Coprocess::request(const std::vector<std::string>& args,
+                                     std::chrono::milliseconds timeout,
+                                     Result& result)
+{
+    // a request is one line, an argument spanning lines is left to
+    // fork/exec
+    if (std::any_of(args.begin(), args.end(), [](const std::string& arg) {
+            return arg.find('\n') != std::string::npos;
+        }))
+    {
+        return Status::unavailable;
+    }
+    // a busy co-process leaves the run to fork/exec instead of a queue
+    std::unique_lock lock(_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return Status::unavailable;
+    }
+    auto now = Clock::now();
+    if (_pid < 0 && now < _retryAfter)
+    {
+        return Status::unavailable;
+    }
+    if (_pid >= 0 &&
+        now - _lastUsed > std::chrono::milliseconds(COPROCESS_IDLE_CHECK_MS))
+    {
+        Result ping{-1, ""};
+        if (!exchange("",
+                      now + std::chrono::milliseconds(
+                                COPROCESS_START_TIMEOUT_MS),
+                      ping))
+        {
+            logs_wrn("Co-process %s failed its health check, restarting\n",
+                     _executable.c_str());
+            stop();
+        }
+    }
+    if (_pid < 0 && !start())
+    {
+        _retryAfter = now + std::chrono::milliseconds(COPROCESS_RETRY_MS);
+        return Status::unavailable;
+    }
+
+    std::string request;
+    for (const auto& arg : args)
+    {
+        request += (request.empty() ? "" : " ") + quote(arg);
+    }
+    auto until = Clock::now() + timeout;
+    if (!exchange(request, until, result))
+    {
+        bool timedOut = Clock::now() >= until;
+        stop();
+        if (timedOut)
+        {
+            throw std::runtime_error(
+                "co-process request timed out and was terminated!");
+        }
+        logs_wrn("Co-process %s stopped answering, restarting it on the "
+                 "next run\n",
+                 _executable.c_str());
+        return Status::unavailable;
+    }
+    _lastUsed = Clock::now();
+    return Status::served;
+}
+
+bool Coprocess::start()
+{
+    // writing to a co-process that died must not kill the daemon
+    static std::once_flag ignoreSigpipe;
+    std::call_once(ignoreSigpipe, []() { ::signal(SIGPIPE, SIG_IGN); });
+
+    int in[2];
+    int out[2];
+    if (::pipe2(in, O_CLOEXEC) != 0)
+    {
+        return false;
+    }
+    if (::pipe2(out, O_CLOEXEC) != 0)
+    {
+        ::close(in[0]);
+        ::close(in[1]);
+        return false;
+    }
+    std::vector<std::string> args{_executable, "-coprocess"};
+    pid_t pid = 0;
+    int rc = spawn(args, in[0], out[1], pid);
+    ::close(in[0]);
+    ::close(out[1]);
+    if (rc != 0)
+    {
+        ::close(in[1]);
+        ::close(out[0]);
+        logs_wrn("Cannot start co-process %s: %s\n", _executable.c_str(),
+                 std::strerror(rc));
+        return false;
+    }
+    _pid = pid;
+    _stdin = in[1];
+    _stdout = out[0];
+    ::fcntl(_stdout, F_SETFL, ::fcntl(_stdout, F_GETFL) | O_NONBLOCK);
+    _buffer.clear();
+    _starts++;
+
+    std::string handshake;
+    if (!readLine(handshake,
+                  Clock::now() +
+                      std::chrono::milliseconds(COPROCESS_START_TIMEOUT_MS)) ||
+        handshake != "COPROCESS 1")
+    {
+        logs_wrn("%s does not support the co-process mode, using fork/exec\n",
+                 _executable.c_str());
+        stop();
+        return false;
+    }
+    logs_dbg("Co-process %s started, pid %d\n", _executable.c_str(), _pid);
+    _lastUsed = Clock::now();
+    return true;
+}
+
+void Coprocess::stop()
+{
+    if (_pid < 0)
+    {
+        return;
+    }
+    killGroup(_pid);
+    ::waitpid(_pid, nullptr, 0);
+    ::close(_stdin);
+    ::close(_stdout);
+    _pid = -1;
+    _stdin = -1;
+    _stdout = -1;
+    _buffer.clear();
+}
+
+bool Coprocess::writeLine(const std::string& line)
+{
+    auto data = line + '\n';
+    size_t written = 0;
+    while (written < data.size())
+    {
+        auto count = ::write(_stdin, data.data() + written,
+                             data.size() - written);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool Coprocess::readLine(std::string& line, Clock::time_point until)
+{
+    while (true)
+    {
+        auto end = _buffer.find('\n');
+        if (end != std::string::npos)
+        {
+            line = _buffer.substr(0, end);
+            _buffer.erase(0, end + 1);
+            return true;
+        }
+        auto now = Clock::now();
+        if (now >= until)
+        {
+            return false;
+        }
+        pollfd readable{_stdout, POLLIN, 0};
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(until - now);
+        auto ready = ::poll(&readable, 1, static_cast<int>(wait.count()));
+        if (ready <= 0)
+        {
+            continue;
+        }
+        if (!drain(_stdout, _buffer) &&
+            _buffer.find('\n') == std::string::npos)
+        {
+            return false;
+        }
+    }
+}
+
+bool Coprocess::exchange(const std::string& request, Clock::time_point until,
+                         Result& result)
+{
+    if (!writeLine(request))
+    {
+        return false;
+    }
+    result.output.clear();
+    std::string line;
+    while (readLine(line, until))
+    {
+        // the separator follows output not ending with a newline on the
+        // same line
+        auto separator = line.find('\x1e');
+        if (separator != std::string::npos)
+        {
+            result.output += line.substr(0, separator);
+            try
+            {
+                result.exitCode = std::stoi(line.substr(separator + 1));
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+            return true;
+        }
+        result.output += line + '\n';
+    }
+    return false;
+}
+
+} // namespace subprocess
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "subscription_plan.hpp"
+
+#include <sdbusplus/bus.hpp>
+
+namespace subscription_plan
+{
+
+std::string SubscriptionRule::matchRule() const
+{
+    return isNamespace
+               ? sdbusplus::bus::match::rules::propertiesChangedNamespace(
+                     path, interface)
+               : sdbusplus::bus::match::rules::propertiesChanged(path,
+                                                                 interface);
+}
+
+std::string SubscriptionPlan::key(std::string_view objectPath,
+                                  std::string_view interface)
+{
+    std::string result;
+    result.reserve(objectPath.size() + interface.size() + 1);
+    result.append(objectPath).append(1, ':').append(interface);
+    return result;
+}
+
+void SubscriptionPlan::add(const std::string& objectPath,
+                           const std::string& interface)
+{
+    if (!_wanted.insert(key(objectPath, interface)).second)
+    {
+        return;
+    }
+    auto slash = objectPath.rfind('/');
+    std::string parent =
+        slash == std::string::npos ? "" : objectPath.substr(0, slash);
+    _byParent[interface][parent].insert(objectPath);
+}
+
+const std::vector<SubscriptionRule>&
+    SubscriptionPlan::plan(size_t minGroupSize, const Descendants& descendants)
+{
+    _rules.clear();
+    for (const auto& [interface, parents] : _byParent)
+    {
+        for (const auto& [parent, objects] : parents)
+        {
+            // never subscribe to the whole bus ("/" namespace)
+            if (objects.size() >= minGroupSize && !parent.empty() &&
+                (!descendants ||
+                 objects.size() * 100 >= descendants(parent, interface) *
+                                             SUBSCRIPTION_MIN_NAMESPACE_SHARE))
+            {
+                _rules.push_back(SubscriptionRule{
+                    parent, interface, true,
+                    std::vector<std::string>(objects.begin(), objects.end())});
+                continue;
+            }
+            for (const auto& object : objects)
+            {
+                _rules.push_back(
+                    SubscriptionRule{object, interface, false, {object}});
+            }
+        }
+    }
+    return _rules;
+}
+
+bool SubscriptionPlan::wants(std::string_view objectPath,
+                             std::string_view interface) const
+{
+    if (_wanted.contains(key(objectPath, interface)))
+    {
+        return true;
+    }
+    _unwanted.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SubscriptionPlan::clear()
+{
+    _byParent.clear();
+    _wanted.clear();
+    _rules.clear();
+}
+
+} // namespace subscription_plan
@@ -24,6 +24,8 @@
 #include <boost/exception/diagnostic_information.hpp>
 
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <thread>
 #include <unordered_map>
@@ -75,7 +77,6 @@ std::unordered_map<std::string, struct MatchDevice> deviceNameMap = {
  */
 constexpr auto RANGE_REGEX = "\\[[0-9]*-*[0-9]*\\]";
 
-constexpr auto RANGE_REGX_STR = ".*(\\[[0-9]*\\-*[0-9]*\\]).*";
 const auto RangeRepeaterIndicatorLength = ::strlen(RangeRepeaterIndicator);
 
 /**
@@ -83,12 +84,125 @@ const auto RangeRepeaterIndicatorLength = ::strlen(RangeRepeaterIndicator);
  */
 constexpr auto DEVICE_RANGE_REGX = ".*([0-9]+)$|.*([0-9]+)\\-.*";
 
+// RegexCache /////////////////////////////////////////////////////////////////
+
+RegexCache& RegexCache::instance()
+{
+    static RegexCache cache;
+    return cache;
+}
+
+RegexCache::RegexPtr RegexCache::get(const std::string& regex)
+{
+    {
+        std::shared_lock lock(_mutex);
+        auto it = _regexes.find(regex);
+        if (it != _regexes.end())
+        {
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return insert(regex);
+}
+
+bool RegexCache::preload(const std::string& regex)
+{
+    try
+    {
+        insert(regex);
+    }
+    catch (const std::regex_error& e)
+    {
+        logs_dbg("Regex '%s' not cached: %s\n", regex.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+RegexCache::RegexPtr RegexCache::insert(const std::string& regex)
+{
+    // Compile outside of the lock, a concurrent miss on the same string
+    // just compiles it twice
+    auto compiled = std::make_shared<const std::regex>(regex);
+    std::unique_lock lock(_mutex);
+    auto it = _regexes.find(regex);
+    if (it != _regexes.end())
+    {
+        return it->second;
+    }
+    if (_regexes.size() < _maxSize)
+    {
+        _regexes.emplace(regex, compiled);
+    }
+    return compiled;
+}
+
+RegexCacheStats RegexCache::stats() const
+{
+    RegexCacheStats result;
+    result.hits = _hits.load(std::memory_order_relaxed);
+    result.misses = _misses.load(std::memory_order_relaxed);
+    std::shared_lock lock(_mutex);
+    result.size = _regexes.size();
+    return result;
+}
+
+void RegexCache::clear()
+{
+    std::unique_lock lock(_mutex);
+    _regexes.clear();
+    _hits = 0;
+    _misses = 0;
+}
+
+// Scanners ///////////////////////////////////////////////////////////////////
+
+std::string lastRangeSpecification(const std::string& str)
+{
+    auto isDigit = [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c)) != 0;
+    };
+    for (auto open = str.rfind('['); open != std::string::npos;
+         open = open > 0 ? str.rfind('[', open - 1) : std::string::npos)
+    {
+        auto it = std::find_if_not(str.begin() + open + 1, str.end(),
+                                   isDigit);
+        it = std::find_if_not(it, str.end(), [](char c) { return c == '-'; });
+        it = std::find_if_not(it, str.end(), isDigit);
+        if (it != str.end() && *it == ']')
+        {
+            return std::string(str.begin() + open, it + 1);
+        }
+    }
+    return std::string{""};
+}
+
+std::string deviceRangeDigit(const std::string& str)
+{
+    if (!str.empty() &&
+        std::isdigit(static_cast<unsigned char>(str.back())))
+    {
+        return str.substr(str.size() - 1);
+    }
+    for (auto dash = str.rfind('-'); dash != std::string::npos && dash > 0;
+         dash = str.rfind('-', dash - 1))
+    {
+        if (std::isdigit(static_cast<unsigned char>(str[dash - 1])))
+        {
+            return str.substr(dash - 1, 1);
+        }
+    }
+    return std::string{""};
+}
+
 std::string matchedRegx(const std::string& str, const std::string& rgx)
 {
-    const std::regex reg{rgx};
+    auto reg = cachedRegex(rgx);
     std::smatch match;
     std::string ret{""};
-    if (std::regex_search(str, match, reg))
+    if (std::regex_search(str, match, *reg))
     {
         auto size = match.size();
         while (size--)
@@ -115,11 +229,11 @@ std::string removeRange(const std::string& str)
     std::string ret{str};
     if (str.empty() == false)
     {
-        std::string matched = matchedRegx(ret, RANGE_REGX_STR);
+        std::string matched = lastRangeSpecification(ret);
         auto pos = std::string::npos;
         if (matched.empty() == true)
         {
-            matched = matchedRegx(ret, DEVICE_RANGE_REGX);
+            matched = deviceRangeDigit(ret);
             if (matched.empty() == false)
             {
                 pos = ret.find_last_of(matched);
@@ -191,7 +305,7 @@ std::tuple<std::vector<int>, std::string> getMinMaxRange(const std::string& rgx)
     matchedRegex =
         (rgx.find_first_of("[") == 0 && rgx.find_last_of("]") == rgx.size() - 1)
             ? rgx
-            : matchedRegx(rgx, RANGE_REGX_STR);
+            : lastRangeSpecification(rgx);
     if (matchedRegex.empty() == false)
     {
         auto regxStr = matchedRegex;
@@ -239,7 +353,7 @@ RangeInformation getRangeInformation(const std::string& str)
     StringPosition stringPosition{std::string::npos};
     std::string fullRegxString{""};
     std::vector<int> minMax;
-    std::string matchedRegex = matchedRegx(str, RANGE_REGX_STR);
+    std::string matchedRegex = lastRangeSpecification(str);
 
     // std::regex_search does not work for str="blabla []" nor for str="[0-9]"
     if (matchedRegex.empty() == true)
@@ -306,7 +420,7 @@ std::string revertRangeRepeated(const std::string& str, size_t pos)
     }
 
     // TODO create a vector of Regular expressions for cases more than one
-    std::string matchedRegex = matchedRegx(strRegex, RANGE_REGX_STR);
+    std::string matchedRegex = lastRangeSpecification(strRegex);
     while (position != std::string::npos)
     {
         // TODO use matchedRegex[indexed]
@@ -360,7 +474,7 @@ void splitDeviceTypeForRegxSearch(const std::string& deviceType,
 {
     decltype(deviceType.size()) start = 0;
     decltype(start) counter = 0;
-    std::regex regxUnderscore{"_[A-Za-z]+"};
+    static const std::regex regxUnderscore{"_[A-Za-z]+"};
     std::sregex_token_iterator noMatches;
     std::sregex_token_iterator piece(deviceType.begin(), deviceType.end(),
                                      regxUnderscore, -1);
@@ -398,8 +512,7 @@ bool matchRegexString(const std::string& regstr, const std::string& str)
     {
         return true;
     }
-    device_id::DeviceIdPattern pattern(regstr);
-    return pattern.matches(str);
+    return device_id::cachedPattern(regstr)->matches(str);
 #else
     std::string myRegStr{regstr};
     std::string myStr{str};
@@ -435,9 +548,8 @@ std::regex createRegexDigitsRange(const std::string& pattern)
         }
     }
     regxStr += ")";
-    std::regex reg;
-    reg.assign(regxStr);
-    return reg;
+    // a copy shares the compiled automaton
+    return *cachedRegex(regxStr);
 }
 
 /**
@@ -456,15 +568,15 @@ std::string introduceDeviceInObjectpath(
     const std::string& objPath, const device_id::PatternIndex& deviceIndex)
 {
     std::string ret{objPath};
-    device_id::DeviceIdPattern  objPattern(objPath);
+    auto objPattern = device_id::cachedPattern(objPath);
     std::stringstream ss;
     ss << deviceIndex;
     // objPath should have a range specification, if not just return itself
-    if (objPattern.dim() > 0)
+    if (objPattern->dim() > 0)
     {
-        if (deviceIndex.dim() == objPattern.dim())
+        if (deviceIndex.dim() == objPattern->dim())
         {
-            ret = objPattern.eval(deviceIndex);
+            ret = objPattern->eval(deviceIndex);
         }
         else
         {
@@ -485,7 +597,7 @@ std::string getDeviceHealth(const std::string& device)
     {
         const std::string healthInterface(
             "xyz.openbmc_project.State.Decorator.Health");
-        dbus::DirectObjectMapper om;
+        dbus::CachingObjectMapper om;
         std::vector<std::string> objPaths =
             om.getAllDevIdObjPaths(device, healthInterface);
         if (!objPaths.empty())
@@ -0,0 +1,319 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "worker_pool.hpp"
+
+#include "log.hpp"
+
+#include <stdexcept>
+
+/** the pool and the queue index of the current thread, if it is a worker */
+static thread_local const WorkerPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+WorkerPool::WorkerPool(size_t workers, size_t queueCapacity,
+                       std::chrono::milliseconds submitTimeout) :
+    _capacity(queueCapacity),
+    _submitTimeout(submitTimeout)
+{
+    if (workers == 0)
+    {
+        throw std::runtime_error("WorkerPool: workers cannot be less than 1");
+    }
+    if (queueCapacity == 0)
+    {
+        throw std::runtime_error(
+            "WorkerPool: queue capacity cannot be less than 1");
+    }
+    for (size_t i = 0; i < workers; ++i)
+    {
+        _queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < workers; ++i)
+    {
+        _threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+    log_info("workers %zu, queue capacity %zu\n", workers, queueCapacity);
+}
+
+WorkerPool::~WorkerPool()
+{
+    shutdown(true);
+}
+
+bool WorkerPool::submit(Task task)
+{
+    std::unique_lock lock(_mutex);
+    if (!_spaceAvailable.wait_for(lock, _submitTimeout, [this]() {
+            return _stopping || _pending < _capacity;
+        }) ||
+        _stopping)
+    {
+        _rejected++;
+        log_err("Rejected task: %s, %zu queued, capacity %zu\n",
+                _stopping ? "pool shut down" : "queue full", _pending,
+                _capacity);
+        return false;
+    }
+    size_t id = currentPool == this
+                    ? currentWorker
+                    : _nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                          _queues.size();
+    {
+        // pushed under _mutex so that a worker claiming the task through
+        // _pending always finds it in one of the queues
+        std::lock_guard queueLock(_queues[id]->mutex);
+        _queues[id]->items.push_back(
+            Item{std::move(task), std::chrono::steady_clock::now()});
+    }
+    _pending++;
+    _maxQueueDepth = std::max(_maxQueueDepth, _pending);
+    _submitted++;
+    lock.unlock();
+    _workAvailable.notify_one();
+    return true;
+}
+
+bool WorkerPool::submit(const std::string& key, Task task)
+{
+    auto deadline = std::chrono::steady_clock::now() + _submitTimeout;
+    std::unique_lock lock(_laneMutex);
+    while (true)
+    {
+        {
+            std::lock_guard stopLock(_mutex);
+            if (_stopping)
+            {
+                break;
+            }
+        }
+        auto& lane = _lanes[key];
+        if (!lane.running)
+        {
+            // the lane is idle, its head task goes to the worker queues
+            lane.running = true;
+            lock.unlock();
+            if (submit([this, key, task = std::move(task)]() mutable {
+                    runLane(key, task);
+                }))
+            {
+                return true;
+            }
+            lock.lock();
+            // tasks queued behind the head meanwhile would wait for a
+            // runLane() that never comes, reject them too
+            auto it = _lanes.find(key);
+            size_t dropped = it->second.tasks.size();
+            _rejected += dropped;
+            _laneQueued -= dropped;
+            _lanes.erase(it);
+            lock.unlock();
+            if (dropped > 0)
+            {
+                log_err("Rejected %zu queued tasks of lane '%s', its head "
+                        "task was rejected\n",
+                        dropped, key.c_str());
+                _laneSpaceAvailable.notify_all();
+            }
+            return false;
+        }
+        if (_laneQueued < _capacity)
+        {
+            lane.tasks.push_back(std::move(task));
+            _laneQueued++;
+            _submitted++;
+            return true;
+        }
+        if (_laneSpaceAvailable.wait_until(lock, deadline) ==
+            std::cv_status::timeout)
+        {
+            break;
+        }
+    }
+    _rejected++;
+    log_err("Rejected task of lane '%s', %zu queued in lanes, capacity %zu\n",
+            key.c_str(), _laneQueued, _capacity);
+    return false;
+}
+
+void WorkerPool::runLane(const std::string& key, Task& task)
+{
+    runTask(task);
+    while (true)
+    {
+        Task next;
+        {
+            std::lock_guard lock(_laneMutex);
+            auto it = _lanes.find(key);
+            if (it->second.tasks.empty())
+            {
+                _lanes.erase(it);
+                return;
+            }
+            next = std::move(it->second.tasks.front());
+            it->second.tasks.pop_front();
+            _laneQueued--;
+        }
+        _laneSpaceAvailable.notify_one();
+        runTask(next);
+        _completed++;
+    }
+}
+
+void WorkerPool::shutdown(bool drain)
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+        if (!drain)
+        {
+            // Drop only the unclaimed tasks, a worker which already claimed
+            // one must still find it in a queue
+            for (auto& queue : _queues)
+            {
+                std::lock_guard queueLock(queue->mutex);
+                while (_pending > 0 && !queue->items.empty())
+                {
+                    queue->items.pop_back();
+                    _pending--;
+                    _rejected++;
+                }
+            }
+        }
+    }
+    if (!drain)
+    {
+        std::lock_guard lock(_laneMutex);
+        for (auto& [key, lane] : _lanes)
+        {
+            _rejected += lane.tasks.size();
+            _laneQueued -= lane.tasks.size();
+            lane.tasks.clear();
+        }
+    }
+    _workAvailable.notify_all();
+    _spaceAvailable.notify_all();
+    _laneSpaceAvailable.notify_all();
+    for (auto& thread : _threads)
+    {
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id())
+        {
+            thread.join();
+        }
+    }
+}
+
+WorkerPoolStats WorkerPool::stats() const
+{
+    WorkerPoolStats result;
+    result.workers = _threads.size();
+    {
+        std::lock_guard lock(_mutex);
+        result.queueDepth = _pending;
+        result.maxQueueDepth = _maxQueueDepth;
+    }
+    result.submitted = _submitted.load();
+    result.completed = _completed.load();
+    result.rejected = _rejected.load();
+    result.stolen = _stolen.load();
+    result.totalWaitUs = _totalWaitUs.load();
+    result.maxWaitUs = _maxWaitUs.load();
+    std::lock_guard lock(_laneMutex);
+    result.lanes = _lanes.size();
+    result.laneQueueDepth = _laneQueued;
+    return result;
+}
+
+void WorkerPool::workerLoop(size_t id)
+{
+    currentPool = this;
+    currentWorker = id;
+    while (true)
+    {
+        {
+            std::unique_lock lock(_mutex);
+            _workAvailable.wait(lock,
+                                [this]() { return _stopping || _pending > 0; });
+            if (_pending == 0)
+            {
+                // stopping and nothing left to drain
+                break;
+            }
+            _pending--;
+        }
+        _spaceAvailable.notify_one();
+        auto item = take(id);
+        run(item);
+    }
+    currentPool = nullptr;
+}
+
+WorkerPool::Item WorkerPool::take(size_t id)
+{
+    while (true)
+    {
+        {
+            auto& own = *_queues[id];
+            std::lock_guard lock(own.mutex);
+            if (!own.items.empty())
+            {
+                auto item = std::move(own.items.front());
+                own.items.pop_front();
+                return item;
+            }
+        }
+        for (size_t i = 1; i < _queues.size(); ++i)
+        {
+            auto& victim = *_queues[(id + i) % _queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.items.empty())
+            {
+                auto item = std::move(victim.items.back());
+                victim.items.pop_back();
+                _stolen++;
+                return item;
+            }
+        }
+        // Concurrent workers emptied the queues while this one was scanning
+        // them. There are never fewer queued tasks than claims, so the
+        // claimed one is still somewhere; scan again.
+        std::this_thread::yield();
+    }
+}
+
+void WorkerPool::run(Item& item)
+{
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - item.enqueued)
+                          .count();
+    _totalWaitUs += waitUs;
+    uint64_t maxWaitUs = _maxWaitUs.load();
+    while (waitUs > maxWaitUs &&
+           !_maxWaitUs.compare_exchange_weak(maxWaitUs, waitUs))
+    {}
+    runTask(item.task);
+    _completed++;
+}
+
+void WorkerPool::runTask(Task& task)
+{
+    try
+    {
+        task();
+    }
+    catch (const std::exception& e)
+    {
+        log_err("Task failed: %s\n", e.what());
+    }
+    catch (...)
+    {
+        log_err("Task failed with an unknown exception\n");
+    }
+}
@@ -591,6 +591,45 @@ TEST(DataAccessor, CopyOperator)
     EXPECT_EQ(destination.getDataValue().getInteger(), 1);
 }
 
+TEST(DataAccessor, TypedFieldsParsedFromJson)
+{
+    DataAccessor dbusAcc{jsonBITMASK};
+    EXPECT_EQ(dbusAcc.getAccessorType(), AccessorType::dbus);
+    EXPECT_EQ(dbusAcc.getType(), "DBUS");
+    EXPECT_TRUE(dbusAcc.isValidDbusAccessor());
+    EXPECT_EQ(dbusAcc.getDbusObjectPath(),
+              "/xyz/openbmc_project/inventory/system/chassis/GPU[0-7]");
+    EXPECT_EQ(dbusAcc.getDbusInterface(),
+              "xyz.openbmc_project.Inventory.Decorator.Dimension");
+    EXPECT_EQ(dbusAcc.getProperty(), "Depth");
+    EXPECT_TRUE(dbusAcc.existsCheckKey());
+    EXPECT_EQ(dbusAcc.getCheckMap().at("bitmask"), "0x01");
+
+    const nlohmann::json jsonCMDLINE = {{"type", "CMDLINE"},
+                                        {"executable", "/bin/echo"},
+                                        {"arguments", "GPU_SXM_[1-8]"},
+                                        {"check", {{"bitmap", "1"}}}};
+    DataAccessor cmdAcc{jsonCMDLINE};
+    EXPECT_EQ(cmdAcc.getAccessorType(), AccessorType::cmdline);
+    EXPECT_EQ(cmdAcc.getExecutable(), "/bin/echo");
+    EXPECT_EQ(cmdAcc.getArguments(), "GPU_SXM_[1-8]");
+    EXPECT_EQ(cmdAcc.getDbusObjectPath(), "");
+    EXPECT_TRUE(cmdAcc.existsCheckBitmap());
+    EXPECT_FALSE(cmdAcc.existsCheckLookup());
+
+    DataAccessor empty;
+    EXPECT_EQ(empty.getAccessorType(), AccessorType::none);
+    EXPECT_EQ(empty.getType(), "");
+    EXPECT_FALSE(empty.existsCheckKey());
+
+    // assigning a new json re-parses the typed fields
+    empty = jsonDEVICE;
+    EXPECT_EQ(empty.getAccessorType(), AccessorType::dbus);
+    EXPECT_EQ(empty.getDbusObjectPath(),
+              "/xyz/openbmc_project/inventory/system/chassis/GPU0");
+    EXPECT_EQ(DataAccessor::Hash{}(empty), DataAccessor::Hash{}(dbusAcc));
+}
+
 TEST(DataAccessor, CompareDeviceId)
 {
 
@@ -801,3 +840,61 @@ TEST(DataAccessor, ExpandDbusDoubleRange)
         EXPECT_EQ(list.back(), data_accessor::DataAccessor(lastJson));       
     }
 }
+
+TEST(DataAccessor, CmdLineRangeInvocation)
+{
+    constexpr auto filename = "./range-wrapper";
+    constexpr auto counter = "./range-wrapper.runs";
+    std::filesystem::remove(counter);
+    {
+        // "short" prints the first device only
+        std::ofstream script(filename);
+        script << "#!/bin/sh\n"
+               << "echo run >> " << counter << "\n"
+               << "mode=$1; shift\n"
+               << "for dev in \"$@\"; do\n"
+               << "  echo \"value of $dev\"; echo\n"
+               << "  [ $mode = short ] && break\n"
+               << "done\n"
+               << "exit 0\n";
+    }
+    std::filesystem::permissions(filename,
+                                 std::filesystem::perms::owner_all |
+                                     std::filesystem::perms::group_all,
+                                 std::filesystem::perm_options::add);
+    auto runs = [&counter]() {
+        std::ifstream file(counter);
+        std::string line;
+        size_t count = 0;
+        while (std::getline(file, line))
+        {
+            count++;
+        }
+        return count;
+    };
+
+    DataAccessor accessor(nlohmann::json{{"type", "CMDLINE"},
+                                         {"executable", filename},
+                                         {"arguments", "full GPU[0-3]"},
+                                         {"invocation", "range"}});
+    for (int gpu = 3; gpu >= 0; --gpu)
+    {
+        device_id::PatternIndex index(gpu);
+        EXPECT_EQ("value of GPU" + std::to_string(gpu),
+                  accessor.read("GPU" + std::to_string(gpu), &index));
+    }
+    // the other devices read within the memo TTL
+    EXPECT_EQ(1, runs());
+
+    // one value for two devices, each one is read alone
+    DataAccessor partial(nlohmann::json{{"type", "CMDLINE"},
+                                        {"executable", filename},
+                                        {"arguments", "short GPU[0-1]"},
+                                        {"invocation", "range"}});
+    device_id::PatternIndex second(1);
+    EXPECT_EQ("value of GPU1", partial.read("GPU1", &second));
+    EXPECT_EQ(3, runs());
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(counter);
+}
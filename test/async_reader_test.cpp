@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "async_reader.hpp"
+#include "data_accessor.hpp"
+#include "dbus_accessor.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::PrefetchScope;
+using dbus::PropertyRequest;
+
+static const std::string gpu1 =
+    "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1";
+static const std::string gpu2 =
+    "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_2";
+static const std::string stateIface =
+    "xyz.openbmc_project.State.Decorator.OperationalStatus";
+
+TEST(AsyncReaderTest, WithoutConnectionReadsSynchronously)
+{
+    auto values = dbus::AsyncReader::instance().readAll(
+        {{gpu1, stateIface, "State"}, {gpu2, stateIface, "State"}});
+    // nothing on the bus in the unit tests
+    ASSERT_EQ(2, values.size());
+    EXPECT_TRUE(isInvalidVariant(values[0]));
+    EXPECT_TRUE(isInvalidVariant(values[1]));
+}
+
+TEST(AsyncReaderTest, ScopesNest)
+{
+    EXPECT_FALSE(PrefetchScope::find(gpu1, stateIface, "State").has_value());
+    {
+        PrefetchScope outer({{gpu1, stateIface, "State"},
+                             {gpu2, stateIface, "State"}},
+                            {PropertyVariant(std::string{"Enabled"}),
+                             PropertyVariant()});
+        // failed reads are not kept
+        EXPECT_FALSE(
+            PrefetchScope::find(gpu2, stateIface, "State").has_value());
+        {
+            PrefetchScope inner({{gpu2, stateIface, "State"}},
+                                {PropertyVariant(std::string{"Disabled"})});
+            EXPECT_EQ("Enabled", std::get<std::string>(*PrefetchScope::find(
+                                     gpu1, stateIface, "State")));
+            EXPECT_EQ("Disabled", std::get<std::string>(*PrefetchScope::find(
+                                      gpu2, stateIface, "State")));
+        }
+        EXPECT_FALSE(
+            PrefetchScope::find(gpu2, stateIface, "State").has_value());
+    }
+    EXPECT_FALSE(PrefetchScope::find(gpu1, stateIface, "State").has_value());
+}
+
+TEST(AsyncReaderTest, AccessorReadsFromScope)
+{
+    const nlohmann::json json = {
+        {"type", "DBUS"},
+        {"object",
+         "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_[1-8]"},
+        {"interface", stateIface},
+        {"property", "State"}};
+    data_accessor::DataAccessor accessor(json);
+    device_id::PatternIndex secondGpu(2);
+
+    // a range needs a device to be read
+    EXPECT_FALSE(accessor.dbusReadRequest().has_value());
+    auto request = accessor.dbusReadRequest(&secondGpu);
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(gpu2, request->objectPath);
+    EXPECT_EQ("State", request->property);
+
+    PrefetchScope prefetched({*request},
+                             {PropertyVariant(std::string{"Enabled"})});
+    EXPECT_EQ("Enabled", accessor.read("GPU_SXM_2", &secondGpu));
+    EXPECT_EQ("Enabled", std::get<std::string>(
+                             dbus::readDbusProperty(gpu2, stateIface, "State")));
+}
+
+TEST(AsyncReaderTest, CoreApiResultDecodesReply)
+{
+    auto ret = dbus::coreApiResult(
+        1, "gpu.thermal.temperature.overTemperatureInfo",
+        {0, "Baseboard GPU over temperature info : 0001", {2, 1}});
+    EXPECT_EQ(0, std::get<int>(ret));
+    EXPECT_EQ("Baseboard GPU over temperature info : 0001",
+              std::get<std::string>(ret));
+    EXPECT_EQ((uint64_t{1} << 32) | 2, std::get<uint64_t>(ret));
+
+    ret = dbus::coreApiResult(1, "any", {5, "ignored", {2, 1}});
+    EXPECT_EQ(5, std::get<int>(ret));
+    EXPECT_EQ(0, std::get<uint64_t>(ret));
+}
+
+TEST(AsyncReaderTest, CoreApiReadsFromScope)
+{
+    const nlohmann::json json = {
+        {"type", "DeviceCoreAPI"},
+        {"property", "gpu.interrupt.powerGoodAbnormalChange"}};
+    data_accessor::DataAccessor accessor(json);
+    auto request = accessor.coreApiReadRequest("GPU_SXM_2");
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ("gpu.interrupt.powerGoodAbnormalChange", request->property);
+
+    const nlohmann::json dbusJson = {{"type", "DBUS"},
+                                     {"object", gpu2},
+                                     {"interface", stateIface},
+                                     {"property", "State"}};
+    data_accessor::DataAccessor dbusAccessor(dbusJson);
+    EXPECT_FALSE(dbusAccessor.coreApiReadRequest("GPU_SXM_2").has_value());
+
+    PrefetchScope prefetched(
+        {*request, {request->devId + 1, request->property}},
+        {dbus::RetCoreApi{0, "", 1}, dbus::RetCoreApi{3, "", 0}});
+    EXPECT_EQ("1", accessor.read("GPU_SXM_2"));
+    // failures are not kept, the synchronous call is made again
+    EXPECT_FALSE(PrefetchScope::findCoreApi(request->devId + 1,
+                                            request->property)
+                     .has_value());
+}
+
+TEST(AsyncReaderTest, CoreApiWithoutConnectionReadsSynchronously)
+{
+    auto values = dbus::AsyncReader::instance().readCoreApi(
+        {{1, "gpu.interrupt.powerGoodAbnormalChange"},
+         {2, "gpu.interrupt.powerGoodAbnormalChange"}});
+    ASSERT_EQ(2, values.size());
+    EXPECT_TRUE(values[0].has_value());
+    EXPECT_TRUE(values[1].has_value());
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dbus_connection.hpp"
+
+#include <cerrno>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::BusType;
+using dbus::ConnectionPool;
+
+TEST(ConnectionPoolTest, ReusesThreadConnection)
+{
+    auto& pool = ConnectionPool::instance();
+    pool.drop(BusType::defaultBus);
+    pool.drop(BusType::systemBus);
+    auto before = pool.stats();
+
+    auto first = pool.get();
+    auto second = dbus::connection();
+    auto system = pool.get(BusType::systemBus);
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, system);
+
+    auto after = pool.stats();
+    EXPECT_EQ(before.opened + 2, after.opened);
+    EXPECT_EQ(before.reused + 1, after.reused);
+    EXPECT_EQ(before.open + 2, after.open);
+}
+
+TEST(ConnectionPoolTest, ThreadsGetOwnConnections)
+{
+    auto& pool = ConnectionPool::instance();
+    auto* mine = pool.get().get();
+    auto before = pool.stats();
+
+    sdbusplus::bus::bus* theirs = nullptr;
+    std::thread thread([&pool, &theirs]() {
+        theirs = pool.get().get();
+        EXPECT_EQ(theirs, pool.get().get());
+    });
+    thread.join();
+    EXPECT_NE(mine, theirs);
+
+    auto after = pool.stats();
+    EXPECT_EQ(before.opened + 1, after.opened);
+    // closed when the thread exited
+    EXPECT_EQ(before.open, after.open);
+}
+
+TEST(ConnectionPoolTest, DropReconnects)
+{
+    auto& pool = ConnectionPool::instance();
+    pool.get();
+    auto before = pool.stats();
+
+    pool.drop();
+    auto dropped = pool.stats();
+    EXPECT_EQ(before.dropped + 1, dropped.dropped);
+    EXPECT_EQ(before.open - 1, dropped.open);
+
+    pool.get();
+    auto after = pool.stats();
+    EXPECT_EQ(before.opened + 1, after.opened);
+    EXPECT_EQ(before.open, after.open);
+
+    // nothing to drop twice
+    pool.drop();
+    pool.drop();
+    EXPECT_EQ(after.dropped + 1, pool.stats().dropped);
+}
+
+TEST(ConnectionPoolTest, DroppedConnectionOutlivesItsHolders)
+{
+    auto& pool = ConnectionPool::instance();
+    auto held = pool.get();
+    pool.drop();
+    auto fresh = pool.get();
+    EXPECT_NE(held, fresh);
+    // replaced, yet still alive for whoever held it when it went stale
+    EXPECT_EQ(1, held.use_count());
+    EXPECT_EQ(fresh, pool.get());
+    held.reset();
+    EXPECT_EQ(fresh, pool.get());
+}
+
+TEST(ConnectionPoolTest, ConnectionErrors)
+{
+    EXPECT_TRUE(ConnectionPool::isConnectionError(ECONNRESET));
+    EXPECT_TRUE(ConnectionPool::isConnectionError(ENOTCONN));
+    EXPECT_TRUE(ConnectionPool::isConnectionError(EPIPE));
+    EXPECT_FALSE(ConnectionPool::isConnectionError(0));
+    EXPECT_FALSE(ConnectionPool::isConnectionError(ENOENT));
+    EXPECT_FALSE(ConnectionPool::isConnectionError(ETIMEDOUT));
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dbus_accessor.hpp"
+#include "deadline.hpp"
+
+#include <sdbusplus/exception.hpp>
+
+#include <chrono>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::Deadline;
+using dbus::DeadlineScope;
+using dbus::Stage;
+using namespace std::chrono_literals;
+
+TEST(DeadlineTest, TimeoutFromTimeLeft)
+{
+    Deadline none;
+    EXPECT_FALSE(none.isSet());
+    EXPECT_FALSE(none.expired());
+    EXPECT_FALSE(none.timeout().has_value());
+    EXPECT_EQ(sdbusplus::SdBusDuration(5), *none.timeout(
+                                              sdbusplus::SdBusDuration(5)));
+
+    auto deadline = Deadline::after(10s);
+    EXPECT_FALSE(deadline.expired());
+    auto timeout = deadline.timeout();
+    ASSERT_TRUE(timeout.has_value());
+    EXPECT_LE(*timeout, sdbusplus::SdBusDuration(10'000'000));
+    EXPECT_GT(*timeout, sdbusplus::SdBusDuration(9'000'000));
+    // the earlier of the two
+    EXPECT_EQ(sdbusplus::SdBusDuration(5),
+              *deadline.timeout(sdbusplus::SdBusDuration(5)));
+
+    auto passed = Deadline::after(0ms, Deadline::Clock::now() - 1s);
+    EXPECT_TRUE(passed.expired());
+    EXPECT_EQ(sdbusplus::SdBusDuration(1), *passed.timeout());
+    EXPECT_FALSE(passed.atLeast(1s).expired());
+    EXPECT_FALSE(none.atLeast(1s).isSet());
+}
+
+TEST(DeadlineTest, EventBudget)
+{
+    auto budget = Deadline::eventBudget();
+    auto arrived = Deadline::Clock::now();
+    Deadline::setEventBudget(0ms);
+    EXPECT_FALSE(Deadline::forEvent(arrived).isSet());
+    Deadline::setEventBudget(100ms);
+    EXPECT_EQ(arrived + 100ms, *Deadline::forEvent(arrived).at());
+    Deadline::setEventBudget(budget);
+}
+
+TEST(DeadlineTest, ScopesNest)
+{
+    EXPECT_FALSE(DeadlineScope::current().isSet());
+    EXPECT_EQ(Stage::none, DeadlineScope::stage());
+    auto deadline = Deadline::after(10s);
+    {
+        DeadlineScope event(deadline, Stage::detection);
+        {
+            DeadlineScope handlers(Stage::handlers);
+            EXPECT_EQ(deadline.at(), DeadlineScope::current().at());
+            EXPECT_EQ(Stage::handlers, DeadlineScope::stage());
+        }
+        EXPECT_EQ(Stage::detection, DeadlineScope::stage());
+    }
+    EXPECT_FALSE(DeadlineScope::current().isSet());
+    EXPECT_EQ(Stage::none, DeadlineScope::stage());
+}
+
+TEST(DeadlineTest, NoCallPastTheDeadline)
+{
+    auto before = DeadlineScope::stats();
+    {
+        DeadlineScope event(Deadline::after(0ms, Deadline::Clock::now() - 1s),
+                            Stage::telemetry);
+        dbus::DelayedMethod method(
+            dbus::connection(), "xyz.openbmc_project.Test",
+            "/xyz/openbmc_project/test", "org.freedesktop.DBus.Properties",
+            "Get");
+        EXPECT_THROW(method.call(), sdbusplus::exception::SdBusError);
+    }
+    auto after = DeadlineScope::stats();
+    auto telemetry = static_cast<size_t>(Stage::telemetry);
+    EXPECT_EQ(before.expired[telemetry] + 1, after.expired[telemetry]);
+    EXPECT_EQ(before.timedOut[telemetry], after.timedOut[telemetry]);
+
+    // without a deadline the call is made
+    dbus::DelayedMethod method(dbus::connection(), "xyz.openbmc_project.Test",
+                               "/xyz/openbmc_project/test",
+                               "org.freedesktop.DBus.Properties", "Get");
+    EXPECT_NO_THROW(method.call());
+}
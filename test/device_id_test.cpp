@@ -20,6 +20,7 @@
 #include <charconv>
 #include <iostream>
 #include <list>
+#include <map>
 #include <ranges>
 #include <string>
 #include <string_view>
@@ -552,6 +553,91 @@ TEST(DeviceIdTest, DeviceIdPattern_match_double)
     EXPECT_TRUE(pat.isInjective());
 }
 
+TEST(DeviceIdTest, DeviceIdPattern_match_ambiguousDigits)
+{
+    // The value of the first bracket can't be told apart from the second one
+    // by the scan alone
+    DeviceIdPattern pat("[1-12][1-13]");
+    EXPECT_THAT(pat.match("11"), ElementsAre(PatternIndex(1, 1)));
+    EXPECT_THAT(pat.match("111"),
+                ElementsAre(PatternIndex(1, 11), PatternIndex(11, 1)));
+    EXPECT_THAT(pat.match("123"), ElementsAre(PatternIndex(12, 3)));
+    EXPECT_THAT(pat.match("1214"), ElementsAre());
+    EXPECT_THAT(pat.match("013"), ElementsAre());
+    EXPECT_FALSE(pat.matches("1"));
+}
+
+TEST(DeviceIdTest, DeviceIdPattern_match_sameAsDomainScan)
+{
+    const std::vector<std::string> patterns = {
+        "NVSwitch_[0-3]/Ports/NVLink_[0-39]",
+        "HSC_[0-3:8]",
+        "FPGA_SXM[0|1-8:0-7]_EROT_RECOV_L GPU_SXM_[0|1-8]",
+        "[1-2]_[51-52]",
+        "[0|1-2]_[0|3-4]_[2|5-6]",
+        "PCIeRetimer_[1-8:0-7]"};
+    for (const auto& str : patterns)
+    {
+        DeviceIdPattern pat(str);
+        std::map<std::string, std::vector<PatternIndex>> expected;
+        for (const auto& arg : pat.domain())
+        {
+            expected[pat.eval(arg)].push_back(arg);
+        }
+        for (const auto& [value, args] : expected)
+        {
+            EXPECT_TRUE(pat.matches(value)) << str << " " << value;
+            EXPECT_EQ(pat.match(value), args) << str << " " << value;
+            EXPECT_THAT(pat.match(value + "_"), ElementsAre()) << str;
+            EXPECT_THAT(pat.match(value.substr(1)), ElementsAre()) << str;
+        }
+    }
+}
+
+TEST(DeviceIdTest, PatternCache_hitsAndMisses)
+{
+    PatternCache cache;
+    auto pat = cache.get("GPU_SXM_[1-8]");
+    EXPECT_EQ(pat->pattern(), "GPU_SXM_[1-8]");
+    EXPECT_EQ(cache.get("GPU_SXM_[1-8]"), pat);
+    EXPECT_TRUE(cache.preload("NVSwitch_[0-3]"));
+    EXPECT_NE(cache.get("NVSwitch_[0-3]"), nullptr);
+    EXPECT_FALSE(cache.preload("GPU_SXM_[8-1]"));
+    EXPECT_THROW(cache.get("GPU_SXM_[8-1]"), std::runtime_error);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.size, 2);
+    cache.clear();
+    EXPECT_EQ(cache.stats().size, 0);
+    // handed out patterns outlive the cache entries
+    EXPECT_TRUE(pat->matches("GPU_SXM_8"));
+}
+
+TEST(DeviceIdTest, PatternCache_plainStringsNotInterned)
+{
+    PatternCache cache;
+    auto pat = cache.get("/xyz/openbmc_project/GPU_SXM_1");
+    EXPECT_TRUE(pat->matches("/xyz/openbmc_project/GPU_SXM_1"));
+    EXPECT_TRUE(cache.preload("GPU_SXM_1"));
+    cache.get("GPU_SXM_[1-8]");
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 0);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.size, 1);
+}
+
+TEST(DeviceIdTest, PatternCache_maxSize)
+{
+    PatternCache cache(1);
+    auto pat1 = cache.get("GPU_SXM_[1-8]");
+    auto pat2 = cache.get("NVSwitch_[0-3]");
+    EXPECT_TRUE(pat2->matches("NVSwitch_3"));
+    EXPECT_NE(cache.get("NVSwitch_[0-3]"), pat2);
+    EXPECT_EQ(cache.get("GPU_SXM_[1-8]"), pat1);
+    EXPECT_EQ(cache.stats().size, 1);
+}
+
 TEST(DeviceIdTest, DeviceIdPattern_dimDomain)
 {
     DeviceIdPattern pat("[1-3:11-13][4-7]");
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dispatch_index.hpp"
+#include "event_info.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace dispatch_index
+{
+
+static const auto eventInfoRaw = R"(
+ {
+  "GPU": [
+   {
+      "event": "Secure boot failure",
+      "error_id": "GPU_SECURE_BOOT_FAILURE-ERROR",
+      "device_type": "GPU_SXM_[1-8]",
+      "event_trigger": {
+        "type": "DBUS",
+        "object": "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_[1-8]",
+        "interface": "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+        "property": "MinSpeed",
+        "check": {
+          "equal": "0"
+        }
+      },
+      "accessor": {
+        "type": "CMDLINE",
+        "executable": "mctp-vdm-util-wrapper",
+        "arguments": "active_auth_status GPU_SXM_[1-8]",
+        "check": {
+          "equal": "6"
+        }
+      },
+      "recovery": {
+        "type": "DBUS",
+        "object": "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_[1-8]",
+        "interface": "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+        "property": "MinSpeed",
+        "check": {
+          "not_equal": "0"
+        }
+      },
+      "severity": "Critical",
+      "resolution": "None",
+      "trigger_count": 1,
+      "event_counter_reset": {
+        "type": "",
+        "metadata": ""
+      },
+      "redfish": {
+        "message_id": "ResourceEvent.1.0.ResourceErrorsDetected"
+      },
+      "telemetries": [],
+      "action": "",
+      "value_as_count": false
+    },
+    {
+      "event": "Recovery only",
+      "device_type": "GPU_SXM_[1-8]",
+      "event_trigger": {},
+      "accessor": {
+        "type": "CMDLINE",
+        "executable": "mctp-vdm-util-wrapper",
+        "arguments": "active_auth_status GPU_SXM_[1-8]"
+      },
+      "recovery": {
+        "type": "DBUS",
+        "object": "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_[1-8]",
+        "interface": "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+        "property": "MinSpeed"
+      },
+      "severity": "Critical",
+      "resolution": "None",
+      "trigger_count": 1,
+      "event_counter_reset": {
+        "type": "",
+        "metadata": ""
+      },
+      "redfish": {
+        "message_id": "ResourceEvent.1.0.ResourceErrorsDetected"
+      },
+      "telemetries": [],
+      "action": "",
+      "value_as_count": false
+    }
+  ]
+ }
+)";
+
+TEST(StringInternerTest, InternAndFind)
+{
+    StringInterner interner;
+    auto a = interner.intern("a");
+    auto b = interner.intern("b");
+    EXPECT_NE(a, b);
+    EXPECT_EQ(a, interner.intern("a"));
+    EXPECT_EQ(a, interner.find("a"));
+    EXPECT_EQ(b, interner.find(std::string_view("b")));
+    EXPECT_EQ(StringInterner::invalidId, interner.find("c"));
+    EXPECT_EQ("b", interner.str(b));
+    EXPECT_EQ(2, interner.size());
+}
+
+class DispatchIndexTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        event_info::loadFromJson(eventMap, propertyFilterSet, triggerView,
+                                 accessorView, recoveryView,
+                                 nlohmann::json::parse(eventInfoRaw));
+        ASSERT_TRUE(index.build(triggerView, recoveryView));
+    }
+
+    event_info::EventMap eventMap;
+    event_info::PropertyFilterSet propertyFilterSet;
+    event_info::EventTriggerView triggerView;
+    event_info::EventAccessorView accessorView;
+    event_info::EventRecoveryView recoveryView;
+    DispatchIndex index;
+};
+
+TEST_F(DispatchIndexTest, ExpandsDeviceRanges)
+{
+    EXPECT_TRUE(index.isBuilt());
+    // one key per GPU, the second event's CMDLINE trigger is not indexed
+    EXPECT_EQ(8, index.size());
+}
+
+TEST_F(DispatchIndexTest, FindsTriggerThenRecoveryEvents)
+{
+    const auto* entry = index.find(
+        "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_4",
+        "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig", "MinSpeed");
+    ASSERT_NE(nullptr, entry);
+    // the first event is listed once although it is both trigger and recovery
+    ASSERT_EQ(2, entry->events.size());
+    EXPECT_EQ("Secure boot failure", entry->events.at(0)->event);
+    EXPECT_EQ("Recovery only", entry->events.at(1)->event);
+
+    // built with the index, the callback only copies it
+    EXPECT_TRUE(entry->trigger.isValidDbusAccessor());
+    EXPECT_EQ("/xyz/openbmc_project/inventory/system/processors/GPU_SXM_4",
+              entry->trigger.getDbusObjectPath());
+    EXPECT_EQ("MinSpeed", entry->trigger.getProperty());
+}
+
+TEST_F(DispatchIndexTest, UnknownSignalsAreNotFound)
+{
+    EXPECT_EQ(nullptr,
+              index.find(
+                  "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_9",
+                  "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+                  "MinSpeed"));
+    EXPECT_EQ(nullptr,
+              index.find(
+                  "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1",
+                  "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+                  "MaxSpeed"));
+    EXPECT_EQ(nullptr,
+              index.find(
+                  "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1",
+                  "xyz.openbmc_project.Inventory.Item.Cpu",
+                  "MinSpeed"));
+}
+
+TEST_F(DispatchIndexTest, Clear)
+{
+    index.clear();
+    EXPECT_FALSE(index.isBuilt());
+    EXPECT_EQ(0, index.size());
+    EXPECT_EQ(nullptr,
+              index.find(
+                  "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1",
+                  "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig",
+                  "MinSpeed"));
+}
+
+} // namespace dispatch_index
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "event_counter.hpp"
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace event_counter
+{
+
+TEST(CounterStoreTest, CountsUpToTriggerCount)
+{
+    CounterStore store;
+    auto now = CounterStore::Clock::now();
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 0ms, now));
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 0ms, now + 1h));
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_2", 3, 0ms, now + 1h));
+    EXPECT_TRUE(store.hit("Event", "GPU_SXM_1", 3, 0ms, now + 2h));
+    // saturated, every further occurrence is reported
+    EXPECT_TRUE(store.hit("Event", "GPU_SXM_1", 3, 0ms, now + 3h));
+    EXPECT_EQ(3, store.get("Event", "GPU_SXM_1"));
+    EXPECT_EQ(1, store.get("Event", "GPU_SXM_2"));
+    EXPECT_EQ(0, store.get("Other", "GPU_SXM_1"));
+}
+
+TEST(CounterStoreTest, Decays)
+{
+    CounterStore store;
+    auto now = CounterStore::Clock::now();
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now));
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 5s));
+    EXPECT_DOUBLE_EQ(1.5, store.get("Event", "GPU_SXM_1"));
+    // one occurrence every window never adds up
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 60s));
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 70s));
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 80s));
+    EXPECT_DOUBLE_EQ(1, store.get("Event", "GPU_SXM_1"));
+    // a burst does
+    EXPECT_FALSE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 80s));
+    EXPECT_TRUE(store.hit("Event", "GPU_SXM_1", 3, 10s, now + 80s));
+}
+
+TEST(CounterStoreTest, SetResetAndSnapshot)
+{
+    CounterStore store;
+    store.set("Event", "GPU_SXM_1", 10);
+    store.set("Event", "GPU_SXM_2", 2);
+    EXPECT_EQ(2, store.size());
+    EXPECT_THAT(store.snapshot(),
+                UnorderedElementsAre(
+                    Field(&CounterEntry::device, "GPU_SXM_1"),
+                    Field(&CounterEntry::device, "GPU_SXM_2")));
+    store.reset("Event", "GPU_SXM_1");
+    EXPECT_EQ(0, store.get("Event", "GPU_SXM_1"));
+    EXPECT_EQ(1, store.size());
+    store.clear();
+    EXPECT_EQ(0, store.size());
+}
+
+TEST(CounterStoreTest, ConcurrentHits)
+{
+    CounterStore store;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&store]() {
+            for (int i = 0; i < 1000; ++i)
+            {
+                store.hit("Event", "GPU_SXM_" + std::to_string(i % 8), 100000,
+                          0ms);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+        EXPECT_EQ(500, store.get("Event", "GPU_SXM_" + std::to_string(i)));
+    }
+}
+
+} // namespace event_counter
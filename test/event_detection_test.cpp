@@ -139,7 +139,7 @@ TEST(EventLookupTest, TriggerAccessor)
 
     ev.device = "GPU";
     EXPECT_EQ(eventDetection.IsEvent(ev, ev.device), true);
-    EXPECT_EQ(ev.count[ev.device], 0);
+    EXPECT_EQ(eventDetection.eventCounters().get(ev.event, ev.device), 0);
 
     ev.valueAsCount = true;
     EXPECT_EQ(eventDetection.IsEvent(ev, ev.device, 10), true);
@@ -147,10 +147,10 @@ TEST(EventLookupTest, TriggerAccessor)
     ev.triggerCount = 20;
     EXPECT_EQ(eventDetection.IsEvent(ev, ev.device, 10), false);
 
-    ev.count[ev.device] = 10;
+    eventDetection.eventCounters().set(ev.event, ev.device, 10);
     ev.valueAsCount = false;
     EXPECT_EQ(eventDetection.IsEvent(ev, ev.device), false);
-    EXPECT_EQ(ev.count[ev.device], 11);
+    EXPECT_EQ(eventDetection.eventCounters().get(ev.event, ev.device), 11);
     ev.triggerCount = 0;
 
     nlohmann::json j3;
@@ -588,6 +588,176 @@ TEST(EventDetectionTest, PcQueueConcurrentStress)
     EXPECT_TRUE(expectedSet.empty());
 }
 
+TEST(EventDetectionTest, PcQueueWaitForDataWakesOnPush)
+{
+    // a consumer blocked in waitForData() must be woken by a push well
+    // before its timeout expires
+    PcQueueType queue(100);
+    PcDataType d;
+    EXPECT_FALSE(queue.waitForData(std::chrono::milliseconds(10)));
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_TRUE(queue.push(PcDataType{}));
+    });
+    EXPECT_TRUE(queue.waitForData(std::chrono::seconds(10)));
+    auto waited = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(waited, std::chrono::seconds(5));
+    EXPECT_TRUE(queue.pop(d));
+    producer.join();
+}
+
+TEST(EventDetectionTest, PcQueuePopBatch)
+{
+    PcQueueType queue(100);
+    nlohmann::json j;
+    j["type"] = "DBUS";
+    j["object"] =
+        "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1/Ports/NVLink_7";
+    j["interface"] = "xyz.openbmc_project.Inventory.Item.Port";
+    j["property"] = "RecoveryCount";
+
+    std::vector<std::shared_ptr<event_info::EventNode>> eventPtrs;
+    for (int i = 0; i < 10; i++)
+    {
+        data_accessor::PropertyValue pv(std::to_string(i));
+        data_accessor::DataAccessor acc(j, pv);
+        EXPECT_TRUE(queue.push(PcDataType{acc, eventPtrs}));
+    }
+
+    std::vector<PcDataType> batch;
+    EXPECT_EQ(4, queue.popBatch(batch, 4));
+    EXPECT_EQ(6, queue.popBatch(batch, 100));
+    EXPECT_EQ(0, queue.popBatch(batch, 100));
+    ASSERT_EQ(10, batch.size());
+    for (int i = 0; i < 10; i++)
+    {
+        // FIFO order is kept across batches
+        EXPECT_EQ(i, batch[i].accessor.getDataValue().getInteger());
+    }
+}
+
+static PcDataType makePcData(int value)
+{
+    nlohmann::json j;
+    j["type"] = "DBUS";
+    j["object"] =
+        "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1/Ports/NVLink_7";
+    j["interface"] = "xyz.openbmc_project.Inventory.Item.Port";
+    j["property"] = "RecoveryCount";
+    data_accessor::PropertyValue pv(std::to_string(value));
+    return PcDataType{data_accessor::DataAccessor(j, pv), {}};
+}
+
+TEST(EventDetectionTest, PcQueueOverflowDropNewest)
+{
+    PcQueueType queue(3, PcOverflowPolicy::dropNewest);
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(i < 3, queue.push(makePcData(i)));
+    }
+    EXPECT_EQ(2, queue.stats().droppedNewest);
+    EXPECT_EQ(0, queue.stats().droppedOldest);
+    EXPECT_EQ(0, queue.write_available());
+
+    PcDataType d;
+    EXPECT_TRUE(queue.pop(d));
+    EXPECT_EQ(0, d.accessor.getDataValue().getInteger());
+}
+
+TEST(EventDetectionTest, PcQueueOverflowDropOldest)
+{
+    PcQueueType queue(3, PcOverflowPolicy::dropOldest);
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_TRUE(queue.push(makePcData(i)));
+    }
+    EXPECT_EQ(0, queue.stats().droppedNewest);
+    EXPECT_EQ(2, queue.stats().droppedOldest);
+
+    PcDataType d;
+    for (int i = 2; i < 5; i++)
+    {
+        EXPECT_TRUE(queue.pop(d));
+        EXPECT_EQ(i, d.accessor.getDataValue().getInteger());
+    }
+    EXPECT_FALSE(queue.pop(d));
+}
+
+TEST(EventDetectionTest, PcQueueOverflowDropOldestConcurrent)
+{
+    // producers racing on a full queue must never spin forever, every
+    // push is either queued or counted as dropped
+    PcQueueType queue(4, PcOverflowPolicy::dropOldest);
+    std::atomic<size_t> accepted{0};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++)
+    {
+        producers.emplace_back([&queue, &accepted]() {
+            for (int i = 0; i < 500; i++)
+            {
+                if (queue.push(makePcData(i)))
+                {
+                    accepted++;
+                }
+            }
+        });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    auto stats = queue.stats();
+    EXPECT_EQ(2000, accepted.load() + stats.droppedNewest);
+
+    size_t remaining = 0;
+    PcDataType d;
+    while (queue.pop(d))
+    {
+        remaining++;
+    }
+    EXPECT_EQ(accepted.load(), remaining + stats.droppedOldest);
+    EXPECT_LE(remaining, 4);
+    // nothing left, a waiting consumer must not be told otherwise
+    EXPECT_FALSE(queue.waitForData(std::chrono::milliseconds(10)));
+}
+
+TEST(EventDetectionTest, PcQueueOverflowBlock)
+{
+    PcQueueType queue(2, PcOverflowPolicy::block,
+                      std::chrono::milliseconds(20));
+    EXPECT_TRUE(queue.push(makePcData(0)));
+    EXPECT_TRUE(queue.push(makePcData(1)));
+    // nobody pops, the push times out
+    EXPECT_FALSE(queue.push(makePcData(2)));
+    EXPECT_EQ(1, queue.stats().blockTimeouts);
+
+    PcQueueType blocking(2, PcOverflowPolicy::block, std::chrono::seconds(10));
+    EXPECT_TRUE(blocking.push(makePcData(0)));
+    EXPECT_TRUE(blocking.push(makePcData(1)));
+    std::thread consumer([&blocking]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        PcDataType d;
+        EXPECT_TRUE(blocking.pop(d));
+    });
+    // blocks until the consumer frees a slot
+    EXPECT_TRUE(blocking.push(makePcData(2)));
+    consumer.join();
+    EXPECT_EQ(0, blocking.stats().blockTimeouts);
+    EXPECT_EQ(1, blocking.stats().blockedPushes);
+}
+
+TEST(EventDetectionTest, PcQueueOverflowPolicyFromString)
+{
+    EXPECT_EQ(PcOverflowPolicy::dropNewest,
+              pcOverflowPolicyFromString("drop-newest"));
+    EXPECT_EQ(PcOverflowPolicy::dropOldest,
+              pcOverflowPolicyFromString("drop-oldest"));
+    EXPECT_EQ(PcOverflowPolicy::block, pcOverflowPolicyFromString("block"));
+    EXPECT_THROW(pcOverflowPolicyFromString("drop-all"), std::runtime_error);
+}
+
 TEST(EventDetectionTest,  CreateEventFromFailedCmdLineSecureBoot)
 {
    auto   secureBootEventInfo =
@@ -38,6 +38,23 @@ TEST(JsonSchemaTest, Default)
     */
 }
 
+TEST(JsonSchemaTest, CmdlineRangeInvocation)
+{
+    auto accessor = nlohmann::json::parse(R"({
+        "type": "CMDLINE",
+        "executable": "mctp-vdm-util-wrapper",
+        "arguments": "AP0_BOOTCOMPLETE_TIMEOUT GPU[0-7]",
+        "invocation": "range",
+        "check": {"equal": "1"}
+    })");
+    json_proc::ProblemsCollector problems;
+    EXPECT_TRUE(eventing::dataAccessorSchema()->check(accessor, problems));
+    EXPECT_TRUE(problems.empty());
+
+    accessor["invocation"] = "device";
+    EXPECT_FALSE(eventing::dataAccessorSchema()->check(accessor, problems));
+}
+
 TEST(EventTest, LoadJson)
 {
     nlohmann::json j;
@@ -341,3 +358,30 @@ TEST(EventInfoTest, EventInfo_loadFrom1)
     EXPECT_NO_THROW(event.getCategories());
     EXPECT_EQ(event.getCategories(), std::vector<event_info::EventCategory>{});
 }
+
+TEST(EventInfoTest, EventInfo_loadFromDecay)
+{
+    nlohmann::json js = event_GPU_VRFailure();
+    js["event_counter_reset"] = {{"type", "decay"}, {"metadata", "60000"}};
+    event_info::EventNode event;
+    EXPECT_NO_THROW(event.loadFrom(js));
+    EXPECT_EQ(event.counterDecayWindow, std::chrono::minutes(1));
+
+    js["event_counter_reset"]["metadata"] = 5000;
+    EXPECT_NO_THROW(event.loadFrom(js));
+    EXPECT_EQ(event.counterDecayWindow, std::chrono::seconds(5));
+
+    // malformed windows are logged and the counter does not decay
+    for (const auto& metadata :
+         {nlohmann::json("1 minute"), nlohmann::json(""), nlohmann::json(-1),
+          nlohmann::json("99999999999999999999999")})
+    {
+        js["event_counter_reset"]["metadata"] = metadata;
+        EXPECT_NO_THROW(event.loadFrom(js)) << metadata;
+        EXPECT_EQ(event.counterDecayWindow, std::chrono::milliseconds(0))
+            << metadata;
+    }
+    js["event_counter_reset"].erase("metadata");
+    EXPECT_NO_THROW(event.loadFrom(js));
+    EXPECT_EQ(event.counterDecayWindow, std::chrono::milliseconds(0));
+}
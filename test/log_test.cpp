@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "log.hpp"
+
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+/** what formatRecord() makes of what log() would capture */
+template <typename... Args>
+std::string lazy(const char* fmt, Args&&... args)
+{
+    LogRecord record{};
+    record.fmt = fmt;
+    EXPECT_TRUE((record.capture(args) && ...));
+    return formatRecord(record);
+}
+
+template <typename... Args>
+std::string eager(const char* fmt, Args&&... args)
+{
+    char buffer[1024];
+    formatTo(buffer, sizeof(buffer), fmt, args...);
+    return buffer;
+}
+
+std::vector<std::string> lines(const std::string& path)
+{
+    std::ifstream file(path);
+    std::vector<std::string> result;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        result.push_back(line);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(LogTest, LazyFormattingAsPrintf)
+{
+#define EXPECT_SAME_FORMAT(fmt, ...)                                           \
+    EXPECT_EQ(eager(fmt, ##__VA_ARGS__), lazy(fmt, ##__VA_ARGS__))
+
+    EXPECT_SAME_FORMAT("plain 100%% text\n");
+    EXPECT_SAME_FORMAT("[%s:%d][%s]: %zu left\n", __FILE__, __LINE__,
+                       __func__, size_t(42));
+    EXPECT_SAME_FORMAT("%5d|%-5d|%05d|%+d|%x|%#X|%o", 42, -42, 42, 42, 255,
+                       255, 8);
+    EXPECT_SAME_FORMAT("%u %hhu %hd %lu %llu %lld", -1, 300, 70000,
+                       (unsigned long)-1, (unsigned long long)-1, -1LL);
+    EXPECT_SAME_FORMAT("%.2f %10.3e %g %Lf", 3.14159, 1234.5, 0.5f, 2.5L);
+    EXPECT_SAME_FORMAT("%c%c %-6s| %.3s %*d %.*s", 'o', 'k', "left", "abcdef",
+                       6, 7, 2, "xyz");
+    EXPECT_SAME_FORMAT("%p %s", (void*)0x1234, (const char*)nullptr);
+    char array[16] = "in an array";
+    EXPECT_SAME_FORMAT("%s|%s", array, static_cast<char*>(nullptr));
+
+    // the string is copied when captured, not when formatted
+    LogRecord record{};
+    record.fmt = "%s";
+    {
+        std::string temporary("gone once formatted");
+        ASSERT_TRUE(record.capture(temporary.c_str()));
+        temporary.assign(temporary.size(), 'x');
+    }
+    EXPECT_EQ("gone once formatted", formatRecord(record));
+
+    // too large for the record, formatted by the caller instead
+    std::string large(LOG_RECORD_SIZE, 'a');
+    EXPECT_FALSE(record.capture(large.c_str()));
+#undef EXPECT_SAME_FORMAT
+}
+
+TEST(LogTest, AsyncKeepsCallOrder)
+{
+    auto path = ::testing::TempDir() + "async_log";
+    {
+        Log log(path);
+        auto level = log.getLevel();
+        log.setLevel(LogLevel::error);
+        log.setAsync(true);
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < 4; ++thread)
+        {
+            threads.emplace_back([&log, thread]() {
+                for (int message = 0; message < 50; ++message)
+                {
+                    log.log(LogLevel::error, "thread %d message %d %s\n",
+                            thread, message, std::to_string(message).c_str());
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        log.setAsync(false);
+        log.setLevel(level);
+        EXPECT_EQ(0, log.droppedMessages());
+    }
+
+    std::vector<int> next(4, 0);
+    size_t count = 0;
+    for (const auto& line : lines(path))
+    {
+        int thread = -1;
+        int message = -1;
+        auto text = line.substr(line.find("]E") + 2);
+        ASSERT_EQ(2, sscanf(text.c_str(), "thread %d message %d", &thread,
+                            &message))
+            << line;
+        EXPECT_EQ(next[thread]++, message);
+        EXPECT_THAT(text, ::testing::EndsWith(" " + std::to_string(message)));
+        count++;
+    }
+    EXPECT_EQ(200, count);
+}
+
+TEST(LogTest, AsyncCountsDrops)
+{
+    auto path = ::testing::TempDir() + "async_log_drops";
+    uint64_t dropped = 0;
+    {
+        Log log(path);
+        auto level = log.getLevel();
+        log.setLevel(LogLevel::error);
+        EXPECT_TRUE(log.enabled(LogLevel::error));
+        EXPECT_FALSE(log.enabled(LogLevel::debug));
+        log.setAsync(true, 4);
+        for (int message = 0; message < 100; ++message)
+        {
+            log.log(LogLevel::error, "message %d\n", message);
+        }
+        log.setAsync(false);
+        log.setLevel(level);
+        dropped = log.droppedMessages();
+    }
+
+    size_t written = 0;
+    bool reported = dropped == 0;
+    for (const auto& line : lines(path))
+    {
+        if (line.find("messages dropped") != std::string::npos)
+        {
+            reported = true;
+        }
+        else
+        {
+            written++;
+        }
+    }
+    EXPECT_EQ(100, written + dropped);
+    EXPECT_TRUE(reported);
+}
+
+TEST(LogTest, AsyncFlushesOnCrash)
+{
+    auto path = ::testing::TempDir() + "async_log_crash";
+    EXPECT_EXIT(
+        {
+            Log log(path);
+            log.setLevel(LogLevel::error);
+            log.setAsync(true);
+            log.flushOnCrash();
+            log.log(LogLevel::error, "before the crash %d %s\n", -42, "text");
+            std::string large(LOG_RECORD_SIZE, 'a');
+            log.log(LogLevel::error, "too large %s\n", large.c_str());
+            ::abort();
+        },
+        ::testing::KilledBySignal(SIGABRT), "");
+
+    bool signal = false;
+    bool captured = false;
+    bool formatted = false;
+    for (const auto& line : lines(path))
+    {
+        signal |= line.find("[log]: signal " + std::to_string(SIGABRT)) !=
+                  std::string::npos;
+        captured |= line.find("]Ebefore the crash %d %s <- -42 \"text\"") !=
+                        std::string::npos ||
+                    line.find("]Ebefore the crash -42 text") !=
+                        std::string::npos;
+        formatted |= line.find("]Etoo large aaaa") != std::string::npos;
+    }
+    EXPECT_TRUE(signal);
+    EXPECT_TRUE(captured);
+    EXPECT_TRUE(formatted);
+}
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "dbus_accessor.hpp"
+#include "object_tree.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::ObjectTree;
+using ::testing::ElementsAre;
+
+static const std::string inventory = "/xyz/openbmc_project/inventory/system";
+static const std::string healthIface =
+    "xyz.openbmc_project.State.Decorator.Health";
+static const std::string accIface =
+    "xyz.openbmc_project.Inventory.Item.Accelerator";
+static const std::string gpuMgr = "xyz.openbmc_project.GpuMgr";
+static const std::string inventoryMgr = "xyz.openbmc_project.Inventory.Manager";
+
+class ObjectTreeTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        tree = std::make_shared<ObjectTree>();
+        tree->load(
+            {{inventory + "/chassis/HGX_GPU_SXM_1",
+              {{inventoryMgr, {healthIface}}}},
+             {inventory + "/chassis/HGX_GPU_SXM_1/PCIeDevices/GPU_SXM_1",
+              {{gpuMgr, {healthIface}}}},
+             {inventory + "/processors/GPU_SXM_1",
+              {{gpuMgr, {accIface, healthIface}}}},
+             {inventory + "/processors/GPU_SXM_2", {{gpuMgr, {accIface}}}},
+             {inventory + "/processorsX", {{gpuMgr, {accIface}}}}},
+            {{":1.10", {gpuMgr}}, {":1.11", {inventoryMgr}}});
+    }
+
+    std::shared_ptr<ObjectTree> tree;
+};
+
+TEST_F(ObjectTreeTest, SubTreeAndDepth)
+{
+    EXPECT_THAT(tree->getSubTreePaths(inventory + "/processors", 0),
+                ElementsAre(inventory + "/processors/GPU_SXM_1",
+                            inventory + "/processors/GPU_SXM_2"));
+    EXPECT_THAT(tree->getSubTreePaths(inventory + "/chassis", 1),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1"));
+    EXPECT_EQ(2, tree->getSubTreePaths(inventory + "/chassis/", 0).size());
+    EXPECT_EQ(5, tree->getSubTreePaths("/", 0).size());
+    EXPECT_TRUE(tree->getSubTreePaths(inventory + "/fabrics", 0).empty());
+}
+
+TEST_F(ObjectTreeTest, InterfacesMatchAny)
+{
+    EXPECT_THAT(tree->getSubTreePaths(inventory, 0, {healthIface}),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1",
+                            inventory + "/chassis/HGX_GPU_SXM_1/PCIeDevices/"
+                                        "GPU_SXM_1",
+                            inventory + "/processors/GPU_SXM_1"));
+    EXPECT_EQ(5,
+              tree->getSubTreePaths("/", 0, {healthIface, accIface}).size());
+
+    auto object =
+        tree->getObject(inventory + "/processors/GPU_SXM_1", {healthIface});
+    ASSERT_EQ(1, object.size());
+    EXPECT_EQ(gpuMgr, object.begin()->first);
+    EXPECT_TRUE(tree->getObject(inventory + "/nothing").empty());
+}
+
+TEST_F(ObjectTreeTest, InterfacesAddedAndRemoved)
+{
+    const auto gpu3 = inventory + "/processors/GPU_SXM_3";
+    tree->interfacesAdded(gpu3, ":1.10", {accIface});
+    EXPECT_EQ(3, tree->getSubTreePaths(inventory + "/processors", 0).size());
+    EXPECT_EQ(gpuMgr, tree->getObject(gpu3).begin()->first);
+
+    tree->interfacesRemoved(gpu3, ":1.10", {accIface});
+    EXPECT_EQ(2, tree->getSubTreePaths(inventory + "/processors", 0).size());
+
+    tree->interfacesRemoved(inventory + "/processors/GPU_SXM_1", ":1.10",
+                            {healthIface});
+    EXPECT_EQ(2, tree->getSubTreePaths(inventory, 0, {healthIface}).size());
+
+    auto stats = tree->stats();
+    EXPECT_EQ(3, stats.updates);
+    EXPECT_EQ(0, stats.refreshes);
+}
+
+TEST_F(ObjectTreeTest, ServiceGoingAwayDropsItsObjects)
+{
+    tree->nameOwnerChanged(gpuMgr, ":1.10", "");
+    EXPECT_THAT(tree->getSubTreePaths("/", 0),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1"));
+    EXPECT_EQ(0, tree->stats().refreshes);
+}
+
+TEST_F(ObjectTreeTest, UnknownSenderReloads)
+{
+    tree->interfacesAdded(inventory + "/processors/GPU_SXM_3", ":1.99",
+                          {accIface});
+    // reloaded from the (empty, in the unit tests) ObjectMapper
+    EXPECT_TRUE(tree->getSubTreePaths("/", 0).empty());
+    EXPECT_EQ(1, tree->stats().refreshes);
+}
+
+TEST_F(ObjectTreeTest, CachingObjectMapperUsesTree)
+{
+    dbus::CachingObjectMapper om(tree);
+    EXPECT_THAT(om.getAllDevIdObjPaths("GPU_SXM_1", healthIface),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1",
+                            inventory + "/chassis/HGX_GPU_SXM_1/PCIeDevices/"
+                                        "GPU_SXM_1",
+                            inventory + "/processors/GPU_SXM_1"));
+    EXPECT_THAT(om.getPrimaryDevIdPaths("GPU_SXM_1"),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1"));
+    EXPECT_EQ(gpuMgr,
+              om.getManager(inventory + "/processors/GPU_SXM_2", accIface));
+    EXPECT_EQ(3, om.getSubtree(inventory + "/processors", 0).size() +
+                     om.getSubtree(inventory + "/chassis", 1).size());
+}
+
+TEST_F(ObjectTreeTest, PathsNamedFollowUpdates)
+{
+    EXPECT_THAT(tree->getPathsNamed({"GPU_SXM_1"}),
+                ElementsAre(inventory + "/chassis/HGX_GPU_SXM_1/PCIeDevices/"
+                                        "GPU_SXM_1",
+                            inventory + "/processors/GPU_SXM_1"));
+    EXPECT_THAT(tree->getPathsNamed({"GPU_SXM_1", "GPU_SXM_2"}, {accIface}),
+                ElementsAre(inventory + "/processors/GPU_SXM_1",
+                            inventory + "/processors/GPU_SXM_2"));
+
+    const auto endpoint =
+        inventory + "/fabrics/HGX_NVLinkFabric_0/Endpoints/GPU_SXM_1";
+    tree->interfacesAdded(endpoint, ":1.10", {healthIface});
+    EXPECT_EQ(3, tree->getPathsNamed({"GPU_SXM_1"}).size());
+
+    tree->interfacesRemoved(endpoint, ":1.10", {healthIface});
+    EXPECT_EQ(2, tree->getPathsNamed({"GPU_SXM_1"}).size());
+
+    tree->nameOwnerChanged(gpuMgr, ":1.10", "");
+    EXPECT_TRUE(tree->getPathsNamed({"GPU_SXM_1", "GPU_SXM_2"}).empty());
+    EXPECT_EQ(1, tree->getPathsNamed({"HGX_GPU_SXM_1"}).size());
+}
+
+TEST_F(ObjectTreeTest, DevIdWithSubDevice)
+{
+    const auto port = inventory + "/chassis/HGX_PCIeSwitch_0/Down_3";
+    tree->interfacesAdded(port, ":1.10", {healthIface});
+    dbus::CachingObjectMapper om(tree);
+    EXPECT_THAT(om.getAllDevIdObjPaths("PCIeSwitch_0/Down_3"),
+                ElementsAre(port));
+    EXPECT_TRUE(om.getAllDevIdObjPaths("PCIeSwitch_1/Down_3").empty());
+}
+
+TEST_F(ObjectTreeTest, UntrackedChangesKeepTree)
+{
+    const auto fan = inventory + "/fans/Fan_0";
+    tree->nameOwnerChanged(":1.20", "", ":1.20");
+    tree->nameOwnerChanged("xyz.openbmc_project.FanMgr", "", ":1.20");
+    tree->interfacesRemoved(inventory + "/nothing", ":1.99", {healthIface});
+    EXPECT_EQ(0, tree->stats().updates);
+
+    tree->interfacesAdded(fan, ":1.20", {healthIface});
+    EXPECT_EQ("xyz.openbmc_project.FanMgr",
+              tree->getObject(fan).begin()->first);
+    EXPECT_EQ(6, tree->getSubTreePaths("/", 0).size());
+    EXPECT_EQ(0, tree->stats().refreshes);
+}
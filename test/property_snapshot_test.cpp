@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "async_reader.hpp"
+#include "property_snapshot.hpp"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::PrefetchScope;
+using dbus::PropertyRequest;
+using dbus::PropertySnapshot;
+
+static const std::string processors =
+    "/xyz/openbmc_project/inventory/system/processors";
+static const std::string gpu1 = processors + "/GPU_SXM_1";
+static const std::string gpu2 = processors + "/GPU_SXM_2";
+static const std::string stateIface =
+    "xyz.openbmc_project.State.Decorator.OperationalStatus";
+
+TEST(PropertySnapshotTest, ManagedObjectsAndValues)
+{
+    PropertySnapshot snapshot;
+    snapshot.add(
+        {{gpu1,
+          {{stateIface,
+            {{"State", PropertyVariant(std::string{"Enabled"})},
+             {"Functional", PropertyVariant(true)}}}}},
+         {gpu2,
+          {{stateIface, {{"State", PropertyVariant(std::string{"Absent"})}}}}}});
+    EXPECT_EQ(3, snapshot.size());
+
+    auto values = snapshot.values({{gpu2, stateIface, "State"},
+                                   {gpu2, stateIface, "Functional"},
+                                   {gpu1, stateIface, "Functional"}});
+    ASSERT_EQ(3, values.size());
+    EXPECT_EQ("Absent", std::get<std::string>(values[0]));
+    EXPECT_TRUE(isInvalidVariant(values[1]));
+    EXPECT_TRUE(std::get<bool>(values[2]));
+}
+
+TEST(PropertySnapshotTest, ClosestManagerAbove)
+{
+    const std::vector<std::string> managers{
+        "/", "/xyz/openbmc_project/inventory", processors};
+    EXPECT_EQ(processors, PropertySnapshot::managerOf(gpu1, managers));
+    EXPECT_EQ("/xyz/openbmc_project/inventory",
+              PropertySnapshot::managerOf(processors, managers));
+    EXPECT_EQ("/", PropertySnapshot::managerOf("/xyz/openbmc_project/inventoryX",
+                                               managers));
+    EXPECT_EQ("", PropertySnapshot::managerOf(gpu1, {gpu1, processors + "X"}));
+}
+
+TEST(PropertySnapshotTest, ManagedObjectsOnlyForAGoodShare)
+{
+    EXPECT_FALSE(PropertySnapshot::worthManagedObjects(
+        SNAPSHOT_MIN_MANAGED_OBJECTS - 1, SNAPSHOT_MIN_MANAGED_OBJECTS - 1));
+    EXPECT_TRUE(PropertySnapshot::worthManagedObjects(8, 8));
+    EXPECT_TRUE(PropertySnapshot::worthManagedObjects(8, 32));
+    EXPECT_FALSE(PropertySnapshot::worthManagedObjects(8, 2000));
+    // a tree not listing the objects yet does not rule the manager out
+    EXPECT_TRUE(PropertySnapshot::worthManagedObjects(8, 0));
+}
+
+TEST(PropertySnapshotTest, NothingServedWithoutServices)
+{
+    auto before = PropertySnapshot::stats();
+    auto snapshot = PropertySnapshot::take({{gpu1, stateIface, "State"}});
+    EXPECT_EQ(0, snapshot.size());
+
+    auto after = PropertySnapshot::stats();
+    EXPECT_EQ(before.snapshots + 1, after.snapshots);
+    EXPECT_EQ(before.requested + 1, after.requested);
+    EXPECT_EQ(before.served, after.served);
+}
+
+TEST(PropertySnapshotTest, NestedScopeSkipsWhatOuterHolds)
+{
+    PrefetchScope outer({{gpu1, stateIface, "State"}},
+                        {PropertyVariant(std::string{"Enabled"})});
+    auto before = PropertySnapshot::stats();
+    {
+        PrefetchScope inner({{gpu1, stateIface, "State"}},
+                            PrefetchScope::Mode::bulk);
+        EXPECT_EQ("Enabled", std::get<std::string>(*PrefetchScope::find(
+                                 gpu1, stateIface, "State")));
+    }
+    // nothing left to fetch, no snapshot taken
+    EXPECT_EQ(before.snapshots, PropertySnapshot::stats().snapshots);
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "data_accessor.hpp"
+#include "property_store.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::PropertyStore;
+using namespace std::chrono_literals;
+
+static const std::string gpu1 =
+    "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1";
+static const std::string stateIface =
+    "xyz.openbmc_project.State.Decorator.OperationalStatus";
+
+class PropertyStoreTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        store.clear();
+    }
+
+    void TearDown() override
+    {
+        store.clear();
+    }
+
+    PropertyStore& store = PropertyStore::instance();
+};
+
+TEST_F(PropertyStoreTest, OnlyTrackedObjectsAreKept)
+{
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"Enabled"})}});
+    EXPECT_FALSE(store.find(gpu1, stateIface, "State").has_value());
+
+    store.track(gpu1, stateIface);
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"Enabled"})}});
+    auto stored = store.find(gpu1, stateIface, "State");
+    ASSERT_TRUE(stored.has_value());
+    EXPECT_EQ("Enabled", std::get<std::string>(stored->value));
+    EXPECT_EQ(1, stored->version);
+    EXPECT_FALSE(store.find(gpu1, stateIface, "Functional").has_value());
+
+    auto stats = store.stats();
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(1, stats.updates);
+    EXPECT_EQ(1, stats.size);
+}
+
+TEST_F(PropertyStoreTest, VersionCountsChanges)
+{
+    store.track(gpu1, stateIface);
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"A"})}});
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"A"})}});
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"B"})}});
+    EXPECT_EQ(2, store.find(gpu1, stateIface, "State")->version);
+}
+
+TEST_F(PropertyStoreTest, SignalWinsOverSlowerRead)
+{
+    store.track(gpu1, stateIface);
+    auto readStart = PropertyStore::Clock::now();
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"Disabled"})}});
+    // the read started before the signal, it got the older value
+    store.refresh(gpu1, stateIface, "State",
+                  PropertyVariant(std::string{"Enabled"}), readStart);
+    EXPECT_EQ("Disabled", std::get<std::string>(
+                              store.find(gpu1, stateIface, "State")->value));
+
+    store.refresh(gpu1, stateIface, "State",
+                  PropertyVariant(std::string{"Enabled"}),
+                  PropertyStore::Clock::now());
+    EXPECT_EQ("Enabled", std::get<std::string>(
+                             store.find(gpu1, stateIface, "State")->value));
+}
+
+TEST_F(PropertyStoreTest, OnlySignalFedValuesAreServed)
+{
+    store.track(gpu1, stateIface);
+    // seeded or read, but its changes may not be emitted
+    store.refresh(gpu1, stateIface, "Functional", PropertyVariant(true),
+                  PropertyStore::Clock::now());
+    EXPECT_FALSE(store.find(gpu1, stateIface, "Functional").has_value());
+    EXPECT_EQ(1, store.stats().misses);
+
+    store.update(gpu1, stateIface, {{"Functional", PropertyVariant(false)}});
+    store.refresh(gpu1, stateIface, "Functional", PropertyVariant(true),
+                  PropertyStore::Clock::now());
+    auto stored = store.find(gpu1, stateIface, "Functional");
+    ASSERT_TRUE(stored.has_value());
+    EXPECT_TRUE(std::get<bool>(stored->value));
+}
+
+TEST_F(PropertyStoreTest, StaleValuesAreNotServed)
+{
+    store.track(gpu1, stateIface);
+    store.setMaxAge(1ms);
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"A"})}});
+    std::this_thread::sleep_for(5ms);
+    EXPECT_FALSE(store.find(gpu1, stateIface, "State").has_value());
+    EXPECT_EQ(1, store.stats().stale);
+}
+
+TEST_F(PropertyStoreTest, AccessorReadsFromStore)
+{
+    const nlohmann::json json = {{"type", "DBUS"},
+                                 {"object", gpu1},
+                                 {"interface", stateIface},
+                                 {"property", "State"}};
+    data_accessor::DataAccessor accessor(json);
+    store.track(gpu1, stateIface);
+    store.update(gpu1, stateIface,
+                 {{"State", PropertyVariant(std::string{"Enabled"})}});
+    EXPECT_EQ("Enabled", accessor.read());
+}
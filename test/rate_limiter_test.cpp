@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "rate_limiter.hpp"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::RateLimit;
+using dbus::RateLimiter;
+using namespace std::chrono_literals;
+
+static const std::string gpuMgr = "xyz.openbmc_project.GpuMgr";
+static const std::string mapper = "xyz.openbmc_project.ObjectMapper";
+
+class RateLimiterTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        limiter.clear();
+    }
+
+    void TearDown() override
+    {
+        limiter.clear();
+    }
+
+    static std::chrono::steady_clock::time_point in(
+        std::chrono::milliseconds duration)
+    {
+        return std::chrono::steady_clock::now() + duration;
+    }
+
+    RateLimiter& limiter = RateLimiter::instance();
+};
+
+TEST_F(RateLimiterTest, UnlimitedByDefault)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+    }
+    auto stats = limiter.stats().at(gpuMgr);
+    EXPECT_EQ(100, stats.calls);
+    EXPECT_EQ(0, stats.timedOut);
+    EXPECT_EQ(0, stats.inFlight);
+}
+
+TEST_F(RateLimiterTest, BurstThenRate)
+{
+    limiter.setLimit(gpuMgr, RateLimit{50.0, 2, 0});
+    EXPECT_TRUE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+    EXPECT_TRUE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+    // the bucket is empty, the next token comes in 20ms
+    EXPECT_FALSE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(limiter.acquire(gpuMgr, in(1s)).has_value());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 10ms);
+
+    auto stats = limiter.stats().at(gpuMgr);
+    EXPECT_EQ(3, stats.calls);
+    EXPECT_EQ(1, stats.timedOut);
+    EXPECT_GE(stats.waited, 1);
+    EXPECT_GT(stats.maxWaitUs, 0);
+}
+
+TEST_F(RateLimiterTest, ConcurrencyLimitPerService)
+{
+    limiter.setLimit(gpuMgr, RateLimit{0.0, 1, 1});
+    {
+        auto permit = limiter.acquire(gpuMgr);
+        EXPECT_EQ(1, limiter.stats().at(gpuMgr).inFlight);
+        EXPECT_FALSE(limiter.acquire(gpuMgr, in(5ms)).has_value());
+        // other services are not throttled
+        EXPECT_TRUE(limiter.acquire(mapper, in(0ms)).has_value());
+    }
+    EXPECT_TRUE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+}
+
+TEST_F(RateLimiterTest, ReleasedSlotWakesWaiter)
+{
+    limiter.setLimit(gpuMgr, RateLimit{0.0, 1, 1});
+    auto permit = std::make_unique<RateLimiter::Permit>(
+        limiter.acquire(gpuMgr));
+    std::thread releaser([&permit]() {
+        std::this_thread::sleep_for(10ms);
+        permit.reset();
+    });
+    EXPECT_TRUE(limiter.acquire(gpuMgr, in(5s)).has_value());
+    releaser.join();
+    EXPECT_EQ(1, limiter.stats().at(gpuMgr).waited);
+}
+
+TEST_F(RateLimiterTest, DefaultLimitAppliesToOthers)
+{
+    limiter.setLimit(mapper, RateLimit{});
+    limiter.setDefaultLimit(RateLimit{0.0, 1, 1});
+    auto permit = limiter.acquire(gpuMgr);
+    EXPECT_FALSE(limiter.acquire(gpuMgr, in(0ms)).has_value());
+    auto first = limiter.acquire(mapper);
+    EXPECT_TRUE(limiter.acquire(mapper, in(0ms)).has_value());
+}
+
+TEST_F(RateLimiterTest, Parse)
+{
+    auto [service, limit] = RateLimiter::parse(gpuMgr + "=20:5:2");
+    EXPECT_EQ(gpuMgr, service);
+    EXPECT_DOUBLE_EQ(20.0, limit.rate);
+    EXPECT_EQ(5, limit.burst);
+    EXPECT_EQ(2, limit.maxConcurrent);
+
+    auto [all, defaults] = RateLimiter::parse("*=0.5");
+    EXPECT_EQ("*", all);
+    EXPECT_EQ(1, defaults.burst);
+    EXPECT_EQ(0, defaults.maxConcurrent);
+
+    EXPECT_THROW(RateLimiter::parse(gpuMgr), std::invalid_argument);
+    EXPECT_THROW(RateLimiter::parse(gpuMgr + "=1:2:3:4"),
+                 std::invalid_argument);
+    EXPECT_THROW(RateLimiter::parse(gpuMgr + "=fast"), std::invalid_argument);
+    EXPECT_THROW(RateLimiter::parse(gpuMgr + "=1:0"), std::invalid_argument);
+}
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "service_cache.hpp"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using dbus::ServiceCache;
+
+static const std::string gpu0 =
+    "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_1";
+static const std::string gpu1 =
+    "/xyz/openbmc_project/inventory/system/processors/GPU_SXM_2";
+static const std::string cpuIface =
+    "xyz.openbmc_project.Inventory.Item.Accelerator";
+static const std::string stateIface =
+    "xyz.openbmc_project.State.Decorator.OperationalStatus";
+static const std::string gpuMgr = "xyz.openbmc_project.GpuMgr";
+static const std::string gpuOob = "xyz.openbmc_project.GpuOobRecovery";
+
+class ServiceCacheTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        cache.setEnabled(true);
+        cache.clear();
+    }
+
+    void TearDown() override
+    {
+        cache.clear();
+        cache.setEnabled(false);
+    }
+
+    ServiceCache& cache = ServiceCache::instance();
+};
+
+TEST_F(ServiceCacheTest, HitsAfterInsert)
+{
+    auto before = cache.stats();
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+    cache.insert(gpu0, cpuIface, gpuMgr, cache.generation());
+    EXPECT_EQ(gpuMgr, cache.find(gpu0, cpuIface).value_or(""));
+    EXPECT_FALSE(cache.find(gpu0, stateIface).has_value());
+
+    auto after = cache.stats();
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.misses + 2, after.misses);
+    EXPECT_EQ(1, after.size);
+    EXPECT_GT(after.hitRatio(), 0.0);
+}
+
+TEST_F(ServiceCacheTest, NameOwnerChangedDropsService)
+{
+    cache.insert(gpu0, cpuIface, gpuMgr, cache.generation());
+    cache.insert(gpu1, cpuIface, gpuMgr, cache.generation());
+    cache.insert(gpu0, stateIface, gpuOob, cache.generation());
+    auto before = cache.stats();
+
+    cache.invalidateService(gpuMgr);
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+    EXPECT_FALSE(cache.find(gpu1, cpuIface).has_value());
+    EXPECT_EQ(gpuOob, cache.find(gpu0, stateIface).value_or(""));
+
+    auto after = cache.stats();
+    EXPECT_EQ(before.invalidations + 2, after.invalidations);
+    EXPECT_EQ(1, after.size);
+}
+
+TEST_F(ServiceCacheTest, UnknownUniqueNameChangesNothing)
+{
+    cache.insert(gpu0, cpuIface, ":1.42", cache.generation());
+    auto generation = cache.generation();
+
+    // a short lived client, eg. busctl run by a CMDLINE wrapper
+    cache.invalidateService(":1.977");
+    EXPECT_EQ(generation, cache.generation());
+    cache.insert(gpu1, cpuIface, gpuMgr, generation);
+    EXPECT_EQ(gpuMgr, cache.find(gpu1, cpuIface).value_or(""));
+
+    cache.invalidateService(":1.42");
+    EXPECT_NE(generation, cache.generation());
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+    EXPECT_EQ(1, cache.stats().size);
+}
+
+TEST_F(ServiceCacheTest, InterfacesChangedDropsPath)
+{
+    cache.insert(gpu0, cpuIface, gpuMgr, cache.generation());
+    cache.insert(gpu0, stateIface, gpuOob, cache.generation());
+    cache.insert(gpu1, cpuIface, gpuMgr, cache.generation());
+
+    cache.invalidatePath(gpu0);
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+    EXPECT_FALSE(cache.find(gpu0, stateIface).has_value());
+    EXPECT_EQ(gpuMgr, cache.find(gpu1, cpuIface).value_or(""));
+    EXPECT_EQ(1, cache.stats().size);
+}
+
+TEST_F(ServiceCacheTest, StaleAnswerIsNotStored)
+{
+    auto generation = cache.generation();
+    // signal arrived while the ObjectMapper was being asked
+    cache.invalidateService(gpuMgr);
+    cache.insert(gpu0, cpuIface, gpuMgr, generation);
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+}
+
+TEST_F(ServiceCacheTest, DisabledCacheAlwaysMisses)
+{
+    cache.setEnabled(false);
+    cache.insert(gpu0, cpuIface, gpuMgr, cache.generation());
+    EXPECT_FALSE(cache.find(gpu0, cpuIface).has_value());
+    EXPECT_EQ(0, cache.stats().size);
+}
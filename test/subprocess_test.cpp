@@ -0,0 +1,306 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "subprocess.hpp"
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using subprocess::Memo;
+using subprocess::Runner;
+using namespace std::chrono_literals;
+
+TEST(SubprocessTest, SplitsLikeAShell)
+{
+    EXPECT_THAT(Runner::split("  a  'b c' \"d \\\"e\\\"\" f\\ g "),
+                ::testing::ElementsAre("a", "b c", "d \"e\"", "f g"));
+    EXPECT_THAT(Runner::split("x''"), ::testing::ElementsAre("x"));
+    EXPECT_THAT(Runner::split("''"), ::testing::ElementsAre(""));
+    EXPECT_TRUE(Runner::split(" \t ").empty());
+}
+
+TEST(SubprocessTest, OutputAndExitCode)
+{
+    auto& runner = Runner::instance();
+    auto before = runner.stats()["/bin/echo"];
+    auto result = runner.run("/bin/echo hello world", 5s);
+    EXPECT_EQ(0, result.exitCode);
+    EXPECT_EQ("hello world\n", result.output);
+    EXPECT_EQ(before.spawns + 1, runner.stats()["/bin/echo"].spawns);
+
+    EXPECT_EQ(3, runner.run("sh -c 'exit 3'", 5s).exitCode);
+}
+
+TEST(SubprocessTest, LargeOutputDoesNotBlock)
+{
+    auto result =
+        Runner::instance().run("head -c 1000000 /dev/zero", 5s);
+    EXPECT_EQ(0, result.exitCode);
+    EXPECT_EQ(1000000, result.output.size());
+}
+
+TEST(SubprocessTest, KilledAtTimeout)
+{
+    auto& runner = Runner::instance();
+    auto before = runner.stats()["sleep"];
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(runner.run("sleep 5", 100ms), std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+    auto after = runner.stats()["sleep"];
+    EXPECT_EQ(before.timeouts + 1, after.timeouts);
+    EXPECT_GE(after.maxUs, 100000);
+}
+
+TEST(SubprocessTest, ExitSeenWithoutPollingTick)
+{
+#ifdef SYS_pidfd_open
+    int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, ::getpid(), 0));
+#else
+    int pidfd = -1;
+#endif
+    if (pidfd < 0)
+    {
+        GTEST_SKIP() << "no pidfd, the exit is polled";
+    }
+    ::close(pidfd);
+    auto& runner = Runner::instance();
+    auto before = runner.stats()["true"];
+    EXPECT_EQ(0, runner.run("true", 5s).exitCode);
+    auto after = runner.stats()["true"];
+    EXPECT_EQ(before.spawns + 1, after.spawns);
+    // woken up by the exit, not by a timeout of the wait
+    EXPECT_EQ(before.exitPolls, after.exitPolls);
+}
+
+TEST(SubprocessTest, MissingExecutable)
+{
+    auto& runner = Runner::instance();
+    auto before = runner.stats()["/bin/_binary_does_not_exist"];
+    EXPECT_THROW(runner.run("/bin/_binary_does_not_exist", 1s),
+                 std::runtime_error);
+    auto after = runner.stats()["/bin/_binary_does_not_exist"];
+    EXPECT_EQ(before.failures + 1, after.failures);
+    EXPECT_EQ(before.spawns, after.spawns);
+    EXPECT_THROW(runner.run("  ", 1s), std::runtime_error);
+}
+
+namespace
+{
+
+/** a wrapper printing its args, in co-process mode if @c supported */
+std::string writeWrapper(const std::string& name, bool supported)
+{
+    auto path = ::testing::TempDir() + name;
+    {
+        std::ofstream script(path);
+        script << "#!/bin/sh\n";
+        if (supported)
+        {
+            script << "if [ \"$1\" = -coprocess ]; then\n"
+                      "  echo 'COPROCESS 1'\n"
+                      "  while IFS= read -r request; do\n"
+                      "    [ -z \"$request\" ] && { printf '\\036%d\\n' 0;"
+                      " continue; }\n"
+                      "    eval \"set -- $request\"\n"
+                      "    [ \"$1\" = die ] && exit 1\n"
+                      "    [ \"$1\" = hang ] && sleep 5\n"
+                      "    [ \"$1\" = partial ] && { printf partial;"
+                      " printf '\\036%d\\n' 7; continue; }\n"
+                      "    echo \"served $*\"\n"
+                      "    printf '\\036%d\\n' $#\n"
+                      "  done\n"
+                      "  exit 0\n"
+                      "fi\n";
+        }
+        script << "echo \"spawned $*\"\n"
+                  "exit $#\n";
+    }
+    ::chmod(path.c_str(), 0755);
+    return path;
+}
+
+} // namespace
+
+TEST(SubprocessTest, CoprocessServesRuns)
+{
+    auto& runner = Runner::instance();
+    auto wrapper = writeWrapper("coprocess_wrapper", true);
+    runner.enableCoprocess(wrapper);
+
+    auto result = runner.run(wrapper + " a 'b c' \"it's\"", 5s);
+    EXPECT_EQ(3, result.exitCode);
+    EXPECT_EQ("served a b c it's\n", result.output);
+    result = runner.run(wrapper + " x", 5s);
+    EXPECT_EQ(1, result.exitCode);
+    EXPECT_EQ("served x\n", result.output);
+
+    auto stats = runner.stats()[wrapper];
+    EXPECT_EQ(0, stats.spawns);
+    EXPECT_EQ(2, stats.coprocessRequests);
+    EXPECT_EQ(1, stats.coprocessStarts);
+}
+
+TEST(SubprocessTest, CoprocessLineProtocolEdges)
+{
+    auto& runner = Runner::instance();
+    auto wrapper = writeWrapper("edges_wrapper", true);
+    runner.enableCoprocess(wrapper);
+
+    // the separator right after output without a trailing newline
+    auto result = runner.run(wrapper + " partial", 5s);
+    EXPECT_EQ(7, result.exitCode);
+    EXPECT_EQ("partial", result.output);
+    // an argument spanning lines would be split into two requests
+    result = runner.run(wrapper + " 'a\nb'", 5s);
+    EXPECT_EQ("spawned a\nb\n", result.output);
+    EXPECT_EQ("served c\n", runner.run(wrapper + " c", 5s).output);
+
+    auto stats = runner.stats()[wrapper];
+    EXPECT_EQ(1, stats.spawns);
+    EXPECT_EQ(2, stats.coprocessRequests);
+    EXPECT_EQ(1, stats.coprocessStarts);
+}
+
+TEST(SubprocessTest, CoprocessRestartedAfterDying)
+{
+    auto& runner = Runner::instance();
+    auto wrapper = writeWrapper("dying_wrapper", true);
+    runner.enableCoprocess(wrapper);
+
+    // the run the co-process died on is made by fork/exec
+    auto result = runner.run(wrapper + " die", 5s);
+    EXPECT_EQ("spawned die\n", result.output);
+    EXPECT_EQ("served again\n", runner.run(wrapper + " again", 5s).output);
+
+    auto stats = runner.stats()[wrapper];
+    EXPECT_EQ(1, stats.spawns);
+    EXPECT_EQ(1, stats.coprocessRequests);
+    EXPECT_EQ(2, stats.coprocessStarts);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(runner.run(wrapper + " hang", 100ms), std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 2s);
+    EXPECT_EQ(1, runner.stats()[wrapper].timeouts);
+    EXPECT_EQ("served later\n", runner.run(wrapper + " later", 5s).output);
+}
+
+TEST(SubprocessTest, CoprocessUnsupportedFallsBack)
+{
+    auto& runner = Runner::instance();
+    auto wrapper = writeWrapper("plain_wrapper", false);
+    runner.enableCoprocess(wrapper);
+
+    EXPECT_EQ("spawned a\n", runner.run(wrapper + " a", 5s).output);
+    EXPECT_EQ("spawned b\n", runner.run(wrapper + " b", 5s).output);
+
+    auto stats = runner.stats()[wrapper];
+    EXPECT_EQ(2, stats.spawns);
+    EXPECT_EQ(0, stats.coprocessRequests);
+    // not tried again before COPROCESS_RETRY_MS
+    EXPECT_EQ(1, stats.coprocessStarts);
+}
+
+namespace
+{
+
+/** lines of @c path, one per run of a command appending to it */
+size_t countRuns(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(file, line))
+    {
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(SubprocessTest, MemoRunsIdenticalCommandsOnce)
+{
+    auto& memo = Memo::instance();
+    auto counter = ::testing::TempDir() + "memo_runs";
+    std::remove(counter.c_str());
+    auto command = "sh -c 'echo run >> " + counter + "; echo value'";
+
+    auto before = memo.stats();
+    EXPECT_EQ("value\n", memo.run(command, 5s).output);
+    EXPECT_EQ("value\n", memo.run(command, 5s).output);
+    EXPECT_EQ(1, countRuns(counter));
+    // the command line as run is the key
+    memo.run(command + " other", 5s);
+    EXPECT_EQ(2, countRuns(counter));
+    auto after = memo.stats();
+    EXPECT_EQ(before.runs + 2, after.runs);
+    EXPECT_EQ(before.hits + 1, after.hits);
+}
+
+TEST(SubprocessTest, MemoSharesARunInProgress)
+{
+    auto counter = ::testing::TempDir() + "memo_concurrent_runs";
+    std::remove(counter.c_str());
+    auto command =
+        "sh -c 'echo run >> " + counter + "; sleep 0.2; echo value'";
+
+    std::vector<std::future<subprocess::Result>> reads;
+    for (int i = 0; i < 4; ++i)
+    {
+        reads.push_back(std::async(std::launch::async, [&command]() {
+            return Memo::instance().run(command, 5s);
+        }));
+    }
+    for (auto& read : reads)
+    {
+        EXPECT_EQ("value\n", read.get().output);
+    }
+    EXPECT_EQ(1, countRuns(counter));
+}
+
+TEST(SubprocessTest, MemoTtl)
+{
+    auto& memo = Memo::instance();
+    auto ttl = memo.ttl();
+    auto counter = ::testing::TempDir() + "memo_ttl_runs";
+    std::remove(counter.c_str());
+    auto command = "sh -c 'echo run >> " + counter + "'";
+
+    memo.setTtl(50ms);
+    memo.run(command, 5s);
+    std::this_thread::sleep_for(100ms);
+    memo.run(command, 5s);
+    EXPECT_EQ(2, countRuns(counter));
+
+    memo.setTtl(0ms);
+    memo.run(command, 5s);
+    memo.run(command, 5s);
+    EXPECT_EQ(4, countRuns(counter));
+    memo.setTtl(ttl);
+
+    // failures are not kept
+    EXPECT_THROW(memo.run("sleep 5", 50ms), std::runtime_error);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(memo.run("sleep 5", 50ms), std::runtime_error);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+}
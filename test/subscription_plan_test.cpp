@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "subscription_plan.hpp"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using subscription_plan::SubscriptionPlan;
+
+static const std::string processors =
+    "/xyz/openbmc_project/inventory/system/processors";
+static const std::string cpuIface =
+    "xyz.openbmc_project.Inventory.Item.Cpu.OperatingConfig";
+static const std::string stateIface = "xyz.openbmc_project.State.Decorator."
+                                      "OperationalStatus";
+
+TEST(SubscriptionPlanTest, GroupsSiblingsUnderNamespace)
+{
+    SubscriptionPlan plan;
+    for (int i = 1; i <= 8; ++i)
+    {
+        plan.add(processors + "/GPU_SXM_" + std::to_string(i), cpuIface);
+    }
+    plan.add(processors + "/GPU_SXM_1", cpuIface); // duplicate
+    plan.add("/xyz/openbmc_project/sensors/temperature/HGX_Chassis_0_Temp",
+             stateIface);
+
+    const auto& rules = plan.plan();
+    ASSERT_EQ(2, rules.size());
+    EXPECT_EQ(9, plan.subscriptions());
+    EXPECT_EQ(7, plan.savedRules());
+
+    EXPECT_TRUE(rules[0].isNamespace);
+    EXPECT_EQ(processors, rules[0].path);
+    EXPECT_EQ(cpuIface, rules[0].interface);
+    EXPECT_EQ(8, rules[0].objects.size());
+
+    EXPECT_FALSE(rules[1].isNamespace);
+    EXPECT_EQ("/xyz/openbmc_project/sensors/temperature/HGX_Chassis_0_Temp",
+              rules[1].path);
+}
+
+TEST(SubscriptionPlanTest, InterfacesAreNotMerged)
+{
+    SubscriptionPlan plan;
+    plan.add(processors + "/GPU_SXM_1", cpuIface);
+    plan.add(processors + "/GPU_SXM_2", stateIface);
+
+    const auto& rules = plan.plan();
+    ASSERT_EQ(2, rules.size());
+    EXPECT_FALSE(rules[0].isNamespace);
+    EXPECT_FALSE(rules[1].isNamespace);
+    EXPECT_EQ(0, plan.savedRules());
+}
+
+TEST(SubscriptionPlanTest, NeverSubscribesRootNamespace)
+{
+    SubscriptionPlan plan;
+    plan.add("/a", cpuIface);
+    plan.add("/b", cpuIface);
+
+    const auto& rules = plan.plan();
+    ASSERT_EQ(2, rules.size());
+    EXPECT_FALSE(rules[0].isNamespace);
+    EXPECT_FALSE(rules[1].isNamespace);
+}
+
+TEST(SubscriptionPlanTest, MinGroupSize)
+{
+    SubscriptionPlan plan;
+    plan.add(processors + "/GPU_SXM_1", cpuIface);
+    plan.add(processors + "/GPU_SXM_2", cpuIface);
+
+    EXPECT_EQ(2, plan.plan(3).size());
+    EXPECT_EQ(1, plan.plan(2).size());
+    EXPECT_EQ(1, plan.savedRules());
+}
+
+TEST(SubscriptionPlanTest, FiltersSignalsOutsideThePlan)
+{
+    SubscriptionPlan plan;
+    plan.add(processors + "/GPU_SXM_1", cpuIface);
+    plan.add(processors + "/GPU_SXM_2", cpuIface);
+    plan.plan();
+
+    EXPECT_TRUE(plan.wants(processors + "/GPU_SXM_1", cpuIface));
+    // delivered by the namespace rule but never subscribed
+    EXPECT_FALSE(plan.wants(processors + "/GPU_SXM_3", cpuIface));
+    EXPECT_FALSE(plan.wants(processors + "/GPU_SXM_1/Ports/0", cpuIface));
+    EXPECT_FALSE(plan.wants(processors + "/GPU_SXM_1", stateIface));
+    EXPECT_EQ(3, plan.unwanted());
+
+    plan.clear();
+    EXPECT_FALSE(plan.wants(processors + "/GPU_SXM_1", cpuIface));
+    EXPECT_EQ(0, plan.subscriptions());
+    EXPECT_TRUE(plan.rules().empty());
+}
+
+TEST(SubscriptionPlanTest, GroupsOnlyALargeShareOfDescendants)
+{
+    SubscriptionPlan plan;
+    plan.add(processors + "/GPU_SXM_1", cpuIface);
+    plan.add(processors + "/GPU_SXM_2", cpuIface);
+
+    // two of three: grouped
+    auto few = [](const std::string&, const std::string&) -> size_t {
+        return 3;
+    };
+    ASSERT_EQ(1, plan.plan(2, few).size());
+    EXPECT_TRUE(plan.rules()[0].isNamespace);
+
+    // two of eight, each grouped signal would come with three unwanted ones
+    auto many = [](const std::string& parent,
+                   const std::string& interface) -> size_t {
+        EXPECT_EQ(processors, parent);
+        EXPECT_EQ(cpuIface, interface);
+        return 8;
+    };
+    ASSERT_EQ(2, plan.plan(2, many).size());
+    EXPECT_FALSE(plan.rules()[0].isNamespace);
+    EXPECT_FALSE(plan.rules()[1].isNamespace);
+    EXPECT_EQ(0, plan.savedRules());
+}
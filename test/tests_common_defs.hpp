@@ -19,7 +19,7 @@ class DummyObjectMapper : public dbus::ObjectMapper<DummyObjectMapper>
 
   public:
     std::vector<std::string>
-        getSubTreePathsImpl(sdbusplus::bus::bus& bus,
+        getSubTreePathsImpl(const dbus::BusPtr& bus,
                             const std::string& subtree, int depth,
                             const std::vector<std::string>& interfaces);
 };
@@ -397,6 +397,48 @@ TEST(UtilMatchRegexString, DoublePatternDoesNotMatch)
     EXPECT_NE(match, true);
 }
 
+TEST(RegexCache, CompilesOnce)
+{
+    RegexCache cache(2);
+    auto first = cache.get("GPU[0-9]+");
+    auto second = cache.get("GPU[0-9]+");
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_TRUE(std::regex_match("GPU12", *first));
+    auto stats = cache.stats();
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(1, stats.size);
+
+    EXPECT_THROW(cache.get("GPU[0-"), std::regex_error);
+    EXPECT_FALSE(cache.preload("GPU[0-"));
+    EXPECT_EQ(1, cache.stats().size);
+
+    // past the limit compiled but not kept
+    EXPECT_TRUE(cache.preload("a+"));
+    EXPECT_TRUE(cache.preload("b+"));
+    EXPECT_EQ(2, cache.stats().size);
+    EXPECT_TRUE(std::regex_match("bb", *cache.get("b+")));
+    EXPECT_EQ(2, cache.stats().size);
+}
+
+TEST(RegexScanners, SameAsTheRegexes)
+{
+    const std::string rangeRegex{".*(\\[[0-9]*\\-*[0-9]*\\]).*"};
+    const std::string deviceRegex{".*([0-9]+)$|.*([0-9]+)\\-.*"};
+    for (const std::string str :
+         {"", "GPU", "GPU[0-7]", "[1-8]", "[]", "a[] b", "x[0-3]/y[4-5]z",
+          "GPU[0-7]-ERoT", "[a-1]", "a[1-2", "a[1--2]", "[[1]", "GPU2",
+          "GPU5-ERoT", "NVSwitch12", "GPU-5", "ERoT_GPU5-a-b", "5-", "-",
+          "x1-2-y", "HGX_GPU_SXM_[1-8]/PCIeDevices/GPU_SXM_()",
+          "GPU\xc3\xa9[0-7]", "\xff-", "a[\xb2]"})
+    {
+        EXPECT_EQ(matchedRegx(str, rangeRegex), lastRangeSpecification(str))
+            << str;
+        EXPECT_EQ(matchedRegx(str, deviceRegex), deviceRangeDigit(str))
+            << str;
+    }
+}
+
 using namespace util::file_util;
 
 TEST(writeJson2File, WriteFileOK)
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * NVIDIA CORPORATION and its licensors retain all intellectual property
+ * and proprietary rights in and to this software, related documentation
+ * and any modifications thereto.  Any use, reproduction, disclosure or
+ * distribution of this software and related documentation without an express
+ * license agreement from NVIDIA CORPORATION is strictly prohibited.
+ */
+
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(WorkerPoolTest, RunsAllTasks)
+{
+    std::atomic<int> done{0};
+    {
+        WorkerPool pool(3, 100);
+        EXPECT_EQ(3, pool.workers());
+        for (int i = 0; i < 100; ++i)
+        {
+            EXPECT_TRUE(pool.submit([&done]() { done++; }));
+        }
+        // the destructor drains the queues
+    }
+    EXPECT_EQ(100, done.load());
+}
+
+TEST(WorkerPoolTest, RejectsWhenQueueStaysFull)
+{
+    WorkerPool pool(1, 1, 10ms);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    ASSERT_TRUE(pool.submit([&started, released]() {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    // the worker is busy, one task fits in the queue, the next one doesn't
+    EXPECT_TRUE(pool.submit([]() {}));
+    EXPECT_FALSE(pool.submit([]() {}));
+    auto stats = pool.stats();
+    EXPECT_EQ(1, stats.queueDepth);
+    EXPECT_EQ(1, stats.rejected);
+    EXPECT_EQ(2, stats.submitted);
+    release.set_value();
+    pool.shutdown();
+    stats = pool.stats();
+    EXPECT_EQ(0, stats.queueDepth);
+    EXPECT_EQ(2, stats.completed);
+    EXPECT_EQ(1, stats.maxQueueDepth);
+}
+
+TEST(WorkerPoolTest, ShutdownWithoutDrainDropsQueuedTasks)
+{
+    WorkerPool pool(1, 10, 10ms);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    std::atomic<int> done{0};
+    ASSERT_TRUE(pool.submit([&started, released]() {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_TRUE(pool.submit([&done]() { done++; }));
+    }
+    auto stopped = std::async(std::launch::async,
+                              [&pool]() { pool.shutdown(false); });
+    EXPECT_EQ(std::future_status::timeout, stopped.wait_for(10ms));
+    release.set_value();
+    stopped.wait();
+    EXPECT_EQ(0, done.load());
+    EXPECT_EQ(5, pool.stats().rejected);
+    EXPECT_FALSE(pool.submit([]() {}));
+}
+
+TEST(WorkerPoolTest, IdleWorkersStealQueuedTasks)
+{
+    WorkerPool pool(2, 10);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    std::atomic<int> done{0};
+    // Tasks submitted by a worker go to its own queue, the other worker can
+    // only get them by stealing
+    ASSERT_TRUE(pool.submit([&]() {
+        started.set_value();
+        for (int i = 0; i < 4; ++i)
+        {
+            pool.submit([&done]() { done++; });
+        }
+        released.wait();
+    }));
+    started.get_future().wait();
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (done.load() < 4 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(4, done.load());
+    EXPECT_EQ(4, pool.stats().stolen);
+    release.set_value();
+}
+
+TEST(WorkerPoolTest, TaskExceptionsDoNotKillWorkers)
+{
+    std::atomic<int> done{0};
+    {
+        WorkerPool pool(1, 10);
+        pool.submit([]() { throw std::runtime_error("failed"); });
+        pool.submit([&done]() { done++; });
+    }
+    EXPECT_EQ(1, done.load());
+}
+
+TEST(WorkerPoolTest, LanesKeepOrderAndRunInParallel)
+{
+    std::mutex mutex;
+    std::map<std::string, std::vector<int>> order;
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+    {
+        WorkerPool pool(4, 1000);
+        for (int i = 0; i < 50; ++i)
+        {
+            for (const auto* device : {"GPU_SXM_1", "GPU_SXM_2", "NVSwitch_0"})
+            {
+                EXPECT_TRUE(pool.submit(device, [&, device, i]() {
+                    int now = ++running;
+                    int prev = maxRunning.load();
+                    while (now > prev &&
+                           !maxRunning.compare_exchange_weak(prev, now))
+                    {}
+                    std::this_thread::sleep_for(100us);
+                    {
+                        std::lock_guard lock(mutex);
+                        order[device].push_back(i);
+                    }
+                    running--;
+                }));
+            }
+        }
+    }
+    ASSERT_EQ(3, order.size());
+    for (const auto& [device, indexes] : order)
+    {
+        ASSERT_EQ(50, indexes.size()) << device;
+        EXPECT_TRUE(std::is_sorted(indexes.begin(), indexes.end())) << device;
+    }
+    // at most one task per lane at a time
+    EXPECT_LE(maxRunning.load(), 3);
+}
+
+TEST(WorkerPoolTest, LaneRunsOneTaskAtATime)
+{
+    WorkerPool pool(2, 10);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    std::atomic<bool> secondRan{false};
+    ASSERT_TRUE(pool.submit("GPU_SXM_1", [&started, released]() {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    ASSERT_TRUE(pool.submit("GPU_SXM_1", [&secondRan]() { secondRan = true; }));
+    // a free worker exists, yet the second task waits for the first one
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(secondRan.load());
+    auto stats = pool.stats();
+    EXPECT_EQ(1, stats.lanes);
+    EXPECT_EQ(1, stats.laneQueueDepth);
+    release.set_value();
+    pool.shutdown();
+    EXPECT_TRUE(secondRan.load());
+    EXPECT_EQ(0, pool.stats().lanes);
+}
+
+TEST(WorkerPoolTest, RejectedLaneHeadRejectsItsQueuedTasks)
+{
+    WorkerPool pool(1, 1, 1s);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    ASSERT_TRUE(pool.submit([&started, released]() {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    // the worker is busy and its queue full, the head of the lane waits
+    // for space until it is rejected
+    ASSERT_TRUE(pool.submit([]() {}));
+    std::atomic<int> ran{0};
+    auto head = std::async(std::launch::async, [&pool, &ran]() {
+        return pool.submit("GPU_SXM_1", [&ran]() { ran++; });
+    });
+    // the lane exists once the head waits in submit()
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (pool.stats().lanes == 0 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_EQ(1, pool.stats().lanes);
+    // queued behind the head, within the lane capacity
+    EXPECT_TRUE(pool.submit("GPU_SXM_1", [&ran]() { ran++; }));
+    EXPECT_EQ(1, pool.stats().laneQueueDepth);
+
+    EXPECT_FALSE(head.get());
+    auto stats = pool.stats();
+    EXPECT_EQ(0, stats.lanes);
+    EXPECT_EQ(0, stats.laneQueueDepth);
+    EXPECT_EQ(2, stats.rejected);
+
+    release.set_value();
+    // the lane capacity is free again
+    EXPECT_TRUE(pool.submit("GPU_SXM_1", [&ran]() { ran++; }));
+    pool.shutdown();
+    EXPECT_EQ(1, ran.load());
+    EXPECT_EQ(0, pool.stats().laneQueueDepth);
+}
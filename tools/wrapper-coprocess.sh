@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+
+# Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+#
+#  NVIDIA CORPORATION and its licensors retain all intellectual property
+#  and proprietary rights in and to this software, related documentation
+#  and any modifications thereto.  Any use, reproduction, disclosure or
+#  distribution of this software and related documentation without an express
+#  license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+# Co-process mode of the wrappers, sourced by a wrapper started as
+# "<wrapper> -coprocess"; the wrapper defines main(), one run of it.
+#
+# Protocol, see subprocess::Coprocess in nvidia-monitor-eventing:
+# "COPROCESS 1" once ready, then one run per line of single-quoted args on
+# stdin, answered by its output followed by a line of the record separator
+# (0x1e) and its exit code. An empty line is a health check.
+
+coprocess()
+{
+    echo "COPROCESS 1"
+    local request
+    while IFS= read -r request
+    do
+        if [ -z "$request" ]; then
+            printf '\036%d\n' 0
+            continue
+        fi
+        # a subshell, the exits of a run end it and not the co-process, and
+        # the globals it sets do not leak into the next run
+        eval "set -- $request"
+        ( main "$@" ) </dev/null
+        printf '\036%d\n' $?
+    done
+    return 0
+}